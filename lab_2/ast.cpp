@@ -7,327 +7,398 @@
 #include <cstdarg>
 #include <cstring>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 
 #include "ast.hpp"
 
-NodeAST* CreateNodeAST(NodeTypeEnum nodetype, const char* opValue, NodeAST* left, NodeAST* right)
+/* A new block of the given size, at the given place in the block list */
+static char* NewArenaBlock(TNodeArena& arena, size_t size, size_t position)
 {
-  NodeAST* a;
+  char* block;
   try
   {
-    a = new NodeAST;
+    block = new char[size];
+    arena.blocks.insert(arena.blocks.begin() + position, block);
   }
   catch (std::bad_alloc& ba)
   {
     perror("out of space");
     exit(0);
   }
-  a->nodetype = nodetype;
-  strcpy(a->opValue, opValue);
-  a->valueType = left->valueType;
-  a->left = left;
-  a->right = right;
-  return a;
+  return block;
 }
 
-NodeAST* CreateNumberNode(double doubleValue)
+static void InitNodeArena(TNodeArena& arena)
 {
-  TNumericValueNode* a;
-  try
-  {
-    a = new TNumericValueNode;
-  }
-  catch (std::bad_alloc& ba)
-  {
-    perror("out of space");
-    exit(0);
-  }
+  arena.blocks.clear();
+  arena.next = arena.end = NULL;
+}
 
-  a->nodetype = typeConst;
-  a->valueType = typeDouble;
-  a->dNumber = doubleValue;
+static void ResetNodeArena(TNodeArena& arena)
+{
+  if (arena.blocks.empty())
+    return;
+  for (auto i = 1u; i < arena.blocks.size(); ++i)
+    delete[] arena.blocks[i];
+  arena.blocks.resize(1);
+  arena.next = arena.blocks[0];
+  arena.end = arena.blocks[0] + NODE_ARENA_BLOCK_SIZE;
+}
 
-  return reinterpret_cast<NodeAST *>(a);
+static void ReleaseNodeArena(TNodeArena& arena)
+{
+  for (auto i = 0u; i < arena.blocks.size(); ++i)
+    delete[] arena.blocks[i];
+  InitNodeArena(arena);
 }
 
-NodeAST* CreateNumberNode(int integerValue)
+static void* AllocateArenaSpace(TNodeArena& arena, size_t size)
 {
-  TNumericValueNode* a;
-  try
-  {
-    a = new TNumericValueNode;
-  }
-  catch (std::bad_alloc& ba)
+  const size_t alignment = alignof(std::max_align_t);
+  if (size > SIZE_MAX / 2)
   {
+    /* e.g. an array of negative size */
+    errno = ENOMEM;
     perror("out of space");
     exit(0);
   }
+  /* an empty array still gets its own space, array nodes are never NULL */
+  size = (std::max<size_t>(size, 1) + alignment - 1) & ~(alignment - 1);
+
+  if (size > (size_t) (arena.end - arena.next))
+  {
+    /* a large array gets a block of its own, the current one goes on;
+       blocks[0] always stays the first regular block */
+    if (!arena.blocks.empty() && size > NODE_ARENA_BLOCK_SIZE / 4)
+      return NewArenaBlock(arena, size, 1);
+    arena.next = NewArenaBlock(arena, std::max<size_t>(size, NODE_ARENA_BLOCK_SIZE), arena.blocks.size());
+    arena.end = arena.next + std::max<size_t>(size, NODE_ARENA_BLOCK_SIZE);
+  }
+  void* space = arena.next;
+  arena.next += size;
+  return space;
+}
 
-  a->nodetype = typeConst;
-  a->valueType = typeInt;
-  a->iNumber = integerValue;
-  return reinterpret_cast<NodeAST *>(a);
+void InitAst(TAst& tree)
+{
+  InitNodeArena(tree.arrays);
+  tree.openLists = 0;
+  tree.variables = NULL;
+  ResetAst(tree);
 }
 
-NodeAST* CreateNumberNode(char charValue)
+void ResetAst(TAst& tree)
 {
-  TNumericValueNode* a;
+  TNode none;
+  memset(&none, 0, sizeof(none));
   try
   {
-    a = new TNumericValueNode;
+    tree.nodes.assign(1, none);
   }
   catch (std::bad_alloc& ba)
   {
     perror("out of space");
     exit(0);
   }
+  tree.children.clear();
+  tree.openLists = 0;
+  ResetNodeArena(tree.arrays);
+}
 
-  a->nodetype = typeConst;
-  a->valueType = typeChar;
-  a->cNumber = charValue;
-  return reinterpret_cast<NodeAST *>(a);
+void ReleaseAst(TAst& tree)
+{
+  std::vector<TNode>().swap(tree.nodes);
+  std::vector<TNodeIndex>().swap(tree.children);
+  std::vector<std::vector<TNodeIndex> >().swap(tree.lists);
+  tree.openLists = 0;
+  tree.variables = NULL;
+  ReleaseNodeArena(tree.arrays);
 }
 
-NodeAST* CreateNumberNode(bool boolValue)
+void* AllocateArray(TAst& tree, size_t size)
 {
-  TNumericValueNode* a;
+  void* space = AllocateArenaSpace(tree.arrays, size);
+  memset(space, 0, size);
+  return space;
+}
+
+/* A node of the given kind with every field zero, returns its index */
+static TNodeIndex NewNode(TAst& tree, NodeTypeEnum nodetype, SubexpressionValueTypeEnum valueType)
+{
+  if (tree.nodes.size() > UINT32_MAX - 1)
+  {
+    errno = ENOMEM;
+    perror("out of space");
+    exit(0);
+  }
+  TNode node;
+  memset(&node, 0, sizeof(node));
+  node.nodetype = nodetype;
+  node.valueType = valueType;
   try
   {
-    a = new TNumericValueNode;
+    tree.nodes.push_back(node);
   }
   catch (std::bad_alloc& ba)
   {
     perror("out of space");
     exit(0);
   }
+  return (TNodeIndex) tree.nodes.size() - 1;
+}
 
-  a->nodetype = typeConst;
-  a->valueType = typeBool;
-  a->bNumber = boolValue;
-  return reinterpret_cast<NodeAST *>(a);
+const TSymbolTableRecord* NodeSymbol(const TAst& tree, TNodeIndex a)
+{
+  TSymbolId symbol = tree.nodes[a].first;
+  return NO_SYMBOL != symbol ? &SymbolRecord(tree.variables, symbol) : NULL;
 }
 
-NodeAST* CreateNumberNode(double* doubleArrayValue)
+static const char* const g_OperatorTexts[] =
 {
-  TNumericValueNode* a;
-  try
-  {
-    a = new TNumericValueNode;
-  }
-  catch (std::bad_alloc& ba)
+  "", "+", "-", "*", "/", "<", ">", "<=", ">=", "==", "!=", "-", "td"
+};
+
+TOperatorEnum OperatorFromText(const char* text)
+{
+  for (int op = opAdd; op < opNegate; ++op)
   {
-    perror("out of space");
-    exit(0);
+    if (0 == strcmp(text, g_OperatorTexts[op]))
+      return (TOperatorEnum) op;
   }
+  return opNone;
+}
 
-  a->nodetype = typeConst;
-  a->valueType = typeDoubleArray;
-  a->dArrayNumber = doubleArrayValue;
+const char* OperatorText(TOperatorEnum op)
+{
+  return g_OperatorTexts[op];
+}
 
-  return reinterpret_cast<NodeAST *>(a);
+TNodeIndex CreateNodeAST(TAst& tree, NodeTypeEnum nodetype, TOperatorEnum op, TNodeIndex left, TNodeIndex right)
+{
+  /* a comparison gives int 1 or 0 whatever its operands, a conversion
+     gives a double */
+  SubexpressionValueTypeEnum valueType = NodeValueType(tree, left);
+  if (typeBinaryOp == nodetype && op >= opLess && op <= opNotEqual)
+    valueType = typeInt;
+  else if (typeUnaryOp == nodetype && opToDouble == op)
+    valueType = typeDouble;
+  TNodeIndex a = NewNode(tree, nodetype, valueType);
+  tree.nodes[a].op = op;
+  tree.nodes[a].first = left;
+  tree.nodes[a].second = right;
+  return a;
 }
 
-NodeAST* CreateNumberNode(int* integerArrayValue)
+TNodeIndex CreateNumberNode(TAst& tree, double doubleValue)
 {
-  TNumericValueNode* a;
-  try
-  {
-    a = new TNumericValueNode;
-  }
-  catch (std::bad_alloc& ba)
-  {
-    perror("out of space");
-    exit(0);
-  }
+  TNodeIndex a = NewNode(tree, typeConst, typeDouble);
+  tree.nodes[a].first = NOT_POOLED;
+  tree.nodes[a].dNumber = doubleValue;
+  return a;
+}
 
-  a->nodetype = typeConst;
-  a->valueType = typeIntArray;
-  a->iArrayNumber = integerArrayValue;
-  return reinterpret_cast<NodeAST *>(a);
+TNodeIndex CreateNumberNode(TAst& tree, int integerValue)
+{
+  TNodeIndex a = NewNode(tree, typeConst, typeInt);
+  tree.nodes[a].first = NOT_POOLED;
+  tree.nodes[a].iNumber = integerValue;
+  return a;
 }
 
-NodeAST* CreateNumberNode(char* charArrayValue)
+TNodeIndex CreateNumberNode(TAst& tree, char charValue)
 {
-  TNumericValueNode* a;
-  try
-  {
-    a = new TNumericValueNode;
-  }
-  catch (std::bad_alloc& ba)
-  {
-    perror("out of space");
-    exit(0);
-  }
+  TNodeIndex a = NewNode(tree, typeConst, typeChar);
+  tree.nodes[a].first = NOT_POOLED;
+  tree.nodes[a].cNumber = charValue;
+  return a;
+}
 
-  a->nodetype = typeConst;
-  a->valueType = typeCharArray;
-  a->cArrayNumber = charArrayValue;
-  return reinterpret_cast<NodeAST *>(a);
+TNodeIndex CreateNumberNode(TAst& tree, bool boolValue)
+{
+  TNodeIndex a = NewNode(tree, typeConst, typeBool);
+  tree.nodes[a].first = NOT_POOLED;
+  tree.nodes[a].bNumber = boolValue;
+  return a;
 }
 
-NodeAST* CreateNumberNode(bool* boolArrayValue)
+TNodeIndex CreateNumberNode(TAst& tree, double* doubleArrayValue)
 {
-  TNumericValueNode* a;
-  try
-  {
-    a = new TNumericValueNode;
-  }
-  catch (std::bad_alloc& ba)
-  {
-    perror("out of space");
-    exit(0);
-  }
+  TNodeIndex a = NewNode(tree, typeConst, typeDoubleArray);
+  tree.nodes[a].first = NOT_POOLED;
+  tree.nodes[a].dArrayNumber = doubleArrayValue;
+  return a;
+}
+
+TNodeIndex CreateNumberNode(TAst& tree, int* integerArrayValue)
+{
+  TNodeIndex a = NewNode(tree, typeConst, typeIntArray);
+  tree.nodes[a].first = NOT_POOLED;
+  tree.nodes[a].iArrayNumber = integerArrayValue;
+  return a;
+}
+
+TNodeIndex CreateNumberNode(TAst& tree, char* charArrayValue)
+{
+  TNodeIndex a = NewNode(tree, typeConst, typeCharArray);
+  tree.nodes[a].first = NOT_POOLED;
+  tree.nodes[a].cArrayNumber = charArrayValue;
+  return a;
+}
+
+TNodeIndex CreateNumberNode(TAst& tree, bool* boolArrayValue)
+{
+  TNodeIndex a = NewNode(tree, typeConst, typeBoolArray);
+  tree.nodes[a].first = NOT_POOLED;
+  tree.nodes[a].bArrayNumber = boolArrayValue;
+  return a;
+}
+
+TNodeIndex CreateControlFlowNode(TAst& tree, NodeTypeEnum nodetype, TNodeIndex condition,
+                                 TNodeIndex trueBranch, TNodeIndex elseBranch
+                                )
+{
+  TNodeIndex a = NewNode(tree, nodetype, typeInt);
+  tree.nodes[a].first = condition;
+  tree.nodes[a].second = trueBranch;
+  tree.nodes[a].third = elseBranch;
+  return a;
+}
+
+TNodeIndex CreateJumpNode(TAst& tree, TJumpEnum jump)
+{
+  TNodeIndex a = NewNode(tree, typeJumpStatement, typeInt);
+  tree.nodes[a].op = jump;
+  return a;
+}
 
-  a->nodetype = typeConst;
-  a->valueType = typeBoolArray;
-  a->bArrayNumber = boolArrayValue;
-  return reinterpret_cast<NodeAST *>(a);
+TNodeIndex CreateLoopNode(TAst& tree, TLoopEnum loop, TNodeIndex condition,
+                          TNodeIndex body, TNodeIndex step)
+{
+  TNodeIndex a = CreateControlFlowNode(tree, typeWhileStatement, condition, body, step);
+  tree.nodes[a].op = loop;
+  return a;
 }
 
-NodeAST* CreateControlFlowNode(NodeTypeEnum nodetype, NodeAST* condition,
-			      NodeAST* trueBranch, NodeAST* elseBranch
-			      )
+TNodeIndex CreateReferenceNode(TAst& tree, TSymbolId symbol)
 {
-  TControlFlowNode* a;
+  /* a bad reference is an int, its error has been reported */
+  SubexpressionValueTypeEnum valueType = typeInt;
+  if (NO_SYMBOL != symbol)
+    valueType = SymbolRecord(tree.variables, symbol).valueType;
+  TNodeIndex a = NewNode(tree, typeIdentifier, valueType);
+  tree.nodes[a].first = symbol;
+  return a;
+}
+
+TNodeIndex CreateAssignmentNode(TAst& tree, TSymbolId symbol, TNodeIndex rightValue)
+{
+  TNodeIndex a = NewNode(tree, typeAssignmentOp, typeInt);
+  tree.nodes[a].first = symbol;
+  tree.nodes[a].second = rightValue;
+  return a;
+}
+
+TNodeIndex CreateListNode(TAst& tree, TNodeIndex statement)
+{
+  TNodeIndex a = NewNode(tree, typeList, typeInt);
   try
   {
-    a = new TControlFlowNode;
+    if (tree.openLists == tree.lists.size())
+      tree.lists.push_back(std::vector<TNodeIndex>());
   }
   catch (std::bad_alloc& ba)
   {
     perror("out of space");
     exit(0);
   }
-
-  a->nodetype = nodetype;
-  a->condition = condition;
-  a->trueBranch = trueBranch;
-  a->elseBranch = elseBranch;
-  return reinterpret_cast<NodeAST *>(a);
+  tree.lists[tree.openLists].clear();
+  /* an open list refers to its statements by its place on the stack */
+  tree.nodes[a].first = tree.openLists++;
+  return AppendListNode(tree, a, statement);
 }
 
-NodeAST* CreateReferenceNode(TSymbolTableElementPtr symbol)
+TNodeIndex AppendListNode(TAst& tree, TNodeIndex list, TNodeIndex statement)
 {
-  TSymbolTableReference* a;
   try
   {
-    a = new TSymbolTableReference;
+    tree.lists[tree.nodes[list].first].push_back(statement);
   }
   catch (std::bad_alloc& ba)
   {
     perror("out of space");
     exit(0);
   }
-  a->nodetype = typeIdentifier;
-  a->variable = symbol;
-  a->valueType = symbol->table->data[symbol->index].valueType;
-
-  return reinterpret_cast<NodeAST *>(a);
+  ++tree.nodes[list].second;
+  return list;
 }
 
-NodeAST* CreateAssignmentNode(TSymbolTableElementPtr symbol, NodeAST* rightValue)
+TNodeIndex CloseListNode(TAst& tree, TNodeIndex list)
 {
-  TAssignmentNode* a;
+  if (NO_NODE == list)
+    return NO_NODE;
+  std::vector<TNodeIndex>& statements = tree.lists[tree.nodes[list].first];
+  tree.openLists = tree.nodes[list].first;
+  if (statements.size() == 1)
+    return statements[0];
+  tree.nodes[list].first = (TNodeIndex) tree.children.size();
   try
   {
-    a = new TAssignmentNode;
+    tree.children.insert(tree.children.end(), statements.begin(), statements.end());
   }
   catch (std::bad_alloc& ba)
   {
     perror("out of space");
     exit(0);
   }
-
-  a->nodetype = typeAssignmentOp;
-  a->variable = symbol;
-  a->value = rightValue;
-  
-  return reinterpret_cast<NodeAST *>(a);
+  return list;
 }
 
-void FreeAST(NodeAST* a)
-{
-  if(NULL == a)
-    return;
-  switch(a->nodetype)
-  {
-  /* a pair of subtrees */
-  case typeBinaryOp:
-  case typeList:
-    FreeAST(a->right);
-
-    /* the only subtree */
-  case typeUnaryOp:
-  case typeInput:
-  case typeOutput:
-    FreeAST(a->left);
-
-    /* Terminal node */
-  case typeConst:
-  case typeIdentifier:
-  case typeJumpStatement:
-  case typeFunctionStatment:
-    break;
-  case typeAssignmentOp:
-    delete ((TAssignmentNode *)a)->value;
-    break;
-  case typeIfStatement:
-  case typeWhileStatement:
-    delete ((TControlFlowNode *)a)->condition;
-    if( ((TControlFlowNode *)a)->trueBranch)
-	  FreeAST( ((TControlFlowNode *)a)->trueBranch);
-    if( ((TControlFlowNode *)a)->elseBranch)
-	  FreeAST( ((TControlFlowNode *)a)->elseBranch);
-    break;
 
-  default: std::cout << "internal error: free bad node " << a->nodetype << std::endl;
-  }	  
-  
-  delete a; /* Free the node itself */
-}
-
-
-void WriteXml(NodeAST *a, int level, std::ofstream &xml)
+void WriteXml(const TAst& tree, TNodeIndex a, int level, std::ofstream &xml)
 {
     try
     {
-        if (a == NULL)
+        if (NO_NODE == a)
         {
             return;
         }
+        const TNode& node = tree.nodes[a];
 
-        switch (a->nodetype)
+        switch (node.nodetype)
         {
 
             case typeConst:
-                switch (a->valueType)
+                switch (node.valueType)
                 {
                     case typeInt:
-                        xml << std::string(2 * (level), ' ') << "<value name=\"INT\">" << ((TNumericValueNode *)a)->iNumber << "</value>\n";
+                        xml << std::string(2 * (level), ' ') << "<value name=\"INT\">" << node.iNumber << "</value>\n";
                         break;
                     case typeDouble:
-                        xml << std::string(2 * (level), ' ') << "<value name=\"DOUBLE\">" << ((TNumericValueNode *)a)->dNumber << "</value>\n";
+                        xml << std::string(2 * (level), ' ') << "<value name=\"DOUBLE\">" << node.dNumber << "</value>\n";
                         break;
                     case typeChar:
-                        xml << std::string(2 * (level), ' ') << "<value name=\"STRING\">" << (((TNumericValueNode *)a)->cNumber) << "</value>\n";
+                        xml << std::string(2 * (level), ' ') << "<value name=\"STRING\">" << (node.cNumber) << "</value>\n";
                         break;
                     case typeBool:
-                        xml << std::string(2 * (level), ' ') << "<value name=\"BOOL\">" << ((TNumericValueNode *)a)->bNumber << "</value>\n";
+                        xml << std::string(2 * (level), ' ') << "<value name=\"BOOL\">" << node.bNumber << "</value>\n";
                         break;
                     case typeIntArray:
-                        xml << std::string(2 * (level), ' ') << "<value name=\"INT ARRAY\">" << ((TNumericValueNode *)a)->iArrayNumber << "</value>\n";
+                        xml << std::string(2 * (level), ' ') << "<value name=\"INT ARRAY\">" << node.iArrayNumber << "</value>\n";
                         break;
                     case typeDoubleArray:
-                        xml << std::string(2 * (level), ' ') << "<value name=\"DOUBLE\">" << ((TNumericValueNode *)a)->dArrayNumber << "</value>\n";
+                        xml << std::string(2 * (level), ' ') << "<value name=\"DOUBLE\">" << node.dArrayNumber << "</value>\n";
                         break;
                     case typeCharArray:
-                        xml << std::string(2 * (level), ' ') << "<value name=\"STRING\">" << *(((TNumericValueNode *)a)->cArrayNumber) << "</value>\n";
+                        xml << std::string(2 * (level), ' ') << "<value name=\"STRING\">" << *(node.cArrayNumber) << "</value>\n";
                         break;
                     case typeBoolArray:
-                        xml << std::string(2 * (level), ' ') << "<value name=\"BOOL\">" << ((TNumericValueNode *)a)->bArrayNumber << "</value>\n";
+                        xml << std::string(2 * (level), ' ') << "<value name=\"BOOL\">" << node.bArrayNumber << "</value>\n";
                         break;
                         
                     default:
@@ -340,11 +411,11 @@ void WriteXml(NodeAST *a, int level, std::ofstream &xml)
 
             case typeIdentifier:
             {
-                TSymbolTableElementPtr tmp = ((TSymbolTableReference *)a)->variable;
+                const TSymbolTableRecord* tmp = NodeSymbol(tree, a);
                 std::string name = "";
                 if (NULL != tmp)
                 {
-                    name = *(tmp->table->data[tmp->index].name);
+                    name = tmp->identifier->name;
                 }
                 else
                 {
@@ -358,10 +429,10 @@ void WriteXml(NodeAST *a, int level, std::ofstream &xml)
             /* binary operator */
             case typeBinaryOp:
                 xml << std::string(2 * level, ' ') << "<node type=\"binary_op\">\n";
-                xml << std::string(2 * (level + 1), ' ') << "<value name=\"OP\">" << a->opValue << "</value>\n";
+                xml << std::string(2 * (level + 1), ' ') << "<value name=\"OP\">" << OperatorText((TOperatorEnum) node.op) << "</value>\n";
 
-                WriteXml(a->left, level + 1, xml);
-                WriteXml(a->right, level + 1, xml);
+                WriteXml(tree, node.first, level + 1, xml);
+                WriteXml(tree, node.second, level + 1, xml);
 
                 xml << std::string(2 * level, ' ') << "</node>\n";
                 
@@ -369,20 +440,22 @@ void WriteXml(NodeAST *a, int level, std::ofstream &xml)
 
             /* Expression or statement list */
             case typeList:
+            {
                 xml << std::string(2 * level, ' ') << "<node type=\"stmt_list\">\n";
 
-                WriteXml(a->left, level + 1, xml);
-                WriteXml(a->right, level + 1, xml);
+                for (auto i = 0u; i < node.second; ++i)
+                    WriteXml(tree, tree.children[node.first + i], level + 1, xml);
 
                 xml << std::string(2 * level, ' ') << "</node>\n";
                 break;
+            }
 
             /* unary arithmetice operator */
             case typeUnaryOp:
                 xml << std::string(2 * level, ' ') << "<node type=\"UNOP\">\n";
-                xml << std::string(2 * (level + 1), ' ') << "<value name=\"OP\">" << a->opValue << "</value>\n";
+                xml << std::string(2 * (level + 1), ' ') << "<value name=\"OP\">" << OperatorText((TOperatorEnum) node.op) << "</value>\n";
 
-                WriteXml(a->left, level + 1, xml);
+                WriteXml(tree, node.first, level + 1, xml);
 
                 xml << std::string(2 * level, ' ') << "</node>\n";
 
@@ -391,39 +464,39 @@ void WriteXml(NodeAST *a, int level, std::ofstream &xml)
             /* Assignment node */
             case typeAssignmentOp:
             {
-                TSymbolTableElementPtr tmp = ((TAssignmentNode *)a)->variable;
+                const TSymbolTableRecord* tmp = NodeSymbol(tree, a);
 
                 xml << std::string(2 * (level), ' ') << "<value name=\"OP\">" << "=" << "</value>\n";
 
                 if (NULL != tmp)
                 {
-                    xml << std::string(2 * (level), ' ') << "<value name=\"VARIABLE\">" << *(tmp->table->data[tmp->index].name) << "</value>\n";
+                    xml << std::string(2 * (level), ' ') << "<value name=\"VARIABLE\">" << tmp->identifier->name << "</value>\n";
                 }
                 else
                 {
                     xml << std::string(2 * (level), ' ') << "<value name=\"VARIABLE\">" << "(bad reference)" << "</value>\n";
                 }
-                WriteXml(((TAssignmentNode *)a)->value, level, xml);
+                WriteXml(tree, node.second, level, xml);
                 return;
             }
 
             case typeIfStatement:
                 xml << std::string(2 * level, ' ') << "<node type=\"IF\">\n";
                 xml << std::string(2 * level, ' ') << "<node type=\"CONDITION\" >\n";
-                WriteXml(((TControlFlowNode *)a)->condition, level, xml);
+                WriteXml(tree, node.first, level, xml);
                 xml << std::string(2 * level, ' ') << "</node>\n";
 
-                if (((TControlFlowNode *)a)->trueBranch)
+                if (node.second)
                 {
                     xml << std::string(2 * level, ' ') << "<node type=\"IF_TRUE\" >\n";
-                    WriteXml(((TControlFlowNode *)a)->trueBranch, level + 1, xml);
+                    WriteXml(tree, node.second, level + 1, xml);
                     xml << std::string(2 * level, ' ') << "</node>\n";
                 }
 
-                if (((TControlFlowNode *)a)->elseBranch)
+                if (node.third)
                 {
                     xml << std::string(2 * level, ' ') << "<node type=\"IF_FALSE\" >\n";
-                    WriteXml(((TControlFlowNode *)a)->elseBranch, level + 1, xml);
+                    WriteXml(tree, node.third, level + 1, xml);
                     xml << std::string(2 * level, ' ') << "</node>\n";
                 }
                 xml << std::string(2 * level, ' ') << "</node>\n";
@@ -433,13 +506,20 @@ void WriteXml(NodeAST *a, int level, std::ofstream &xml)
             case typeWhileStatement:
                 xml << std::string(2 * level, ' ') << "<node type=\"LOOP\">\n";
                 xml << std::string(2 * level, ' ') << "<node type=\"CONDITION\">\n";
-                WriteXml(((TControlFlowNode *)a)->condition, level, xml);
+                WriteXml(tree, node.first, level, xml);
                 xml << std::string(2 * level, ' ') << "</node>\n";
 
-                if (((TControlFlowNode *)a)->trueBranch)
+                if (node.second)
                 {
                     xml << std::string(2 * level, ' ') << "<node type=\"LOOP_BODY\">\n";
-                    WriteXml(((TControlFlowNode *)a)->trueBranch, level + 1, xml);
+                    WriteXml(tree, node.second, level + 1, xml);
+                    xml << std::string(2 * level, ' ') << "</node>\n";
+                }
+
+                if (node.third)
+                {
+                    xml << std::string(2 * level, ' ') << "<node type=\"LOOP_STEP\">\n";
+                    WriteXml(tree, node.third, level + 1, xml);
                     xml << std::string(2 * level, ' ') << "</node>\n";
                 }
                 xml << std::string(2 * level, ' ') << "</node>\n";
@@ -448,13 +528,13 @@ void WriteXml(NodeAST *a, int level, std::ofstream &xml)
             
             case typeInput:
                 xml << std::string(2 * level, ' ') << "<node type=\"INPUT\">\n";
-                WriteXml(a->left, level + 1, xml);
+                WriteXml(tree, node.first, level + 1, xml);
                 xml << std::string(2 * level, ' ') << "</node>\n";
                 break;
             
             case typeOutput:
                 xml << std::string(2 * level, ' ') << "<node type=\"OUTPUT\">\n";
-                WriteXml(a->left, level + 1, xml);
+                WriteXml(tree, node.first, level + 1, xml);
                 xml << std::string(2 * level, ' ') << "</node>\n";
                 break;
             
@@ -464,7 +544,7 @@ void WriteXml(NodeAST *a, int level, std::ofstream &xml)
             
             case typeFunctionStatment:
                 xml << std::string(2 * level, ' ') << "<node type=\"FUNC\">\n";
-                WriteXml(((TControlFlowNode *)a)->trueBranch, level + 1, xml);
+                WriteXml(tree, node.second, level + 1, xml);
                 xml << std::string(2 * level, ' ') << "</node>\n";
                 break;
         }
@@ -475,132 +555,152 @@ void WriteXml(NodeAST *a, int level, std::ofstream &xml)
 }
 
 /* AST dump */
-void PrintAST(NodeAST* a, int level)
+void PrintAST(const TAst& tree, TNodeIndex a, int level, std::ostream& out)
 {
-  std::cout << std::string (2 * level, ' '); /* indent to this level */
+  out << std::string (2 * level, ' '); /* indent to this level */
   ++level;
 
-  if (NULL == a)
+  if (NO_NODE == a)
   {
-    std::cout << "NULL" << std::endl;
+    out << "NULL" << std::endl;
     return;
   }
+  const TNode& node = tree.nodes[a];
 
-  switch(a->nodetype)
+  switch(node.nodetype)
   {
     /* Numeric literal node */
   case typeConst:
-    if(typeDouble == ((TNumericValueNode *)a)->valueType)
-      std::cout << "dnumber " << ((TNumericValueNode *)a)->dNumber << std::endl;
-    else if(typeInt == ((TNumericValueNode *)a)->valueType)
-      std::cout << "inumber " << ((TNumericValueNode *)a)->iNumber << std::endl;
-    else if(typeChar == ((TNumericValueNode *)a)->valueType)
-      std::cout << "cnumber " << ((TNumericValueNode *)a)->cNumber << std::endl;
-    else if(typeBool == ((TNumericValueNode *)a)->valueType)
-      std::cout << "bnumber " << ((TNumericValueNode *)a)->bNumber << std::endl;
-    else if(typeDoubleArray == ((TNumericValueNode *)a)->valueType)
-      std::cout << "darraynumber " << ((TNumericValueNode *)a)->dArrayNumber << std::endl;
-    else if(typeIntArray == ((TNumericValueNode *)a)->valueType)
-      std::cout << "iarraynumber " << ((TNumericValueNode *)a)->iArrayNumber << std::endl;
-    else if(typeCharArray == ((TNumericValueNode *)a)->valueType)
-      std::cout << "carraynumber " << ((TNumericValueNode *)a)->cArrayNumber << std::endl;
-    else if(typeBoolArray == ((TNumericValueNode *)a)->valueType)
-      std::cout << "barraynumber " << ((TNumericValueNode *)a)->bArrayNumber << std::endl;
+    if(typeDouble == node.valueType)
+      out << "dnumber " << node.dNumber << std::endl;
+    else if(typeInt == node.valueType)
+      out << "inumber " << node.iNumber << std::endl;
+    else if(typeChar == node.valueType)
+      out << "cnumber " << node.cNumber << std::endl;
+    else if(typeBool == node.valueType)
+      out << "bnumber " << node.bNumber << std::endl;
+    else if(typeDoubleArray == node.valueType)
+      out << "darraynumber " << node.dArrayNumber << std::endl;
+    else if(typeIntArray == node.valueType)
+      out << "iarraynumber " << node.iArrayNumber << std::endl;
+    else if(typeCharArray == node.valueType)
+      out << "carraynumber " << node.cArrayNumber << std::endl;
+    else if(typeBoolArray == node.valueType)
+      out << "barraynumber " << node.bArrayNumber << std::endl;
     else
-      std::cout << "bad constant" << std::endl;
+      out << "bad constant" << std::endl;
     break;
 
   case typeJumpStatement:
-    std::cout << "goto" << std::endl;
+    out << "goto" << std::endl;
     break;
 
   /* Symtable reference node */
   case typeIdentifier:
   {
-    TSymbolTableElementPtr tmp = ((TSymbolTableReference *)a)->variable;
-    std::cout << "ref ";
+    const TSymbolTableRecord* tmp = NodeSymbol(tree, a);
+    out << "ref ";
     if (NULL != tmp)
-      std::cout << *(tmp->table->data[tmp->index].name);
+      out << tmp->identifier->name;
     else
-      std::cout << "(bad reference)";
-    std::cout << std::endl;
+      out << "(bad reference)";
+    out << std::endl;
   }
   break;
 
-    /* Expression node */
+    /* Statement list node */
   case typeList:
+  {
+    out << "list " << node.second << std::endl;
+    for (auto i = 0u; i < node.second; ++i)
+      PrintAST(tree, tree.children[node.first + i], level, out);
+    return;
+  }
+
+    /* Expression node */
   case typeBinaryOp:
-    std::cout << "binop " << a->opValue << std::endl;
-    PrintAST(a->left, level);
-    PrintAST(a->right, level);
+    out << "binop " << OperatorText((TOperatorEnum) node.op) << std::endl;
+    PrintAST(tree, node.first, level, out);
+    PrintAST(tree, node.second, level, out);
     return;
 
   /* Unary operator node */
   case typeUnaryOp: 
-    std::cout << "unop " << a->opValue << std::endl;
-    PrintAST(a->left, level);
+    out << "unop " << OperatorText((TOperatorEnum) node.op) << std::endl;
+    PrintAST(tree, node.first, level, out);
     return;
   case typeInput:
-    std::cout << "input" << std::endl;
-    PrintAST(a->left, level);
+    out << "input" << std::endl;
+    PrintAST(tree, node.first, level, out);
     return;
   case typeOutput:
-    std::cout << "echa" << std::endl;
-    PrintAST(a->left, level);
+    out << "echa" << std::endl;
+    PrintAST(tree, node.first, level, out);
     return;
   case typeReturn:
-    std::cout << "return Expression" << std::endl;
-    PrintAST(a->left, level);
+    out << "return Expression" << std::endl;
+    PrintAST(tree, node.first, level, out);
     return;
     /* Assignment node */
   case typeAssignmentOp:
   {
-    TSymbolTableElementPtr tmp = ((TAssignmentNode *)a)->variable;
-    std::cout << "= ";
+    const TSymbolTableRecord* tmp = NodeSymbol(tree, a);
+    out << "= ";
     if (NULL != tmp)
-      std::cout << *(tmp->table->data[tmp->index].name);
+      out << tmp->identifier->name;
     else
-      std::cout << "(bad reference)";
-    std::cout << std::endl;
-    PrintAST( ((TAssignmentNode *)a)->value, level);
+      out << "(bad reference)";
+    out << std::endl;
+    PrintAST(tree,  node.second, level, out);
     return;
   }
   /* Control flow node - if */
   case typeIfStatement:
-    std::cout << "flow - if" << std::endl;
-    PrintAST( ((TControlFlowNode *)a)->condition, level);
-    if( ((TControlFlowNode *)a)->trueBranch)
+    out << "flow - if" << std::endl;
+    PrintAST(tree,  node.first, level, out);
+    if( node.second)
     {
-      std::cout << std::string (2 * level, ' ');
-      std::cout << "true-branch" << std::endl;
-      PrintAST( ((TControlFlowNode *)a)->trueBranch, level + 1);
+      out << std::string (2 * level, ' ');
+      out << "true-branch" << std::endl;
+      PrintAST(tree,  node.second, level + 1, out);
     }
-    if( ((TControlFlowNode *)a)->elseBranch)
+    if( node.third)
     {
-      std::cout << std::string (2 * level, ' ');
-      std::cout << "false-branch" << std::endl;
-      PrintAST( ((TControlFlowNode *)a)->elseBranch, level + 1);
+      out << std::string (2 * level, ' ');
+      out << "false-branch" << std::endl;
+      PrintAST(tree,  node.third, level + 1, out);
     }
     return;
     /* Control flow node - func */
   case typeFunctionStatment:
-    std::cout << "flow - func" << std::endl;
-    PrintAST( ((TControlFlowNode *)a)->trueBranch, level);
+    out << "flow - func" << std::endl;
+    PrintAST(tree,  node.second, level, out);
     return;
 
-  /* Control flow node - while */
+  /* Control flow node - while, do or for */
   case typeWhileStatement:
-    std::cout << "flow - while" << std::endl;
-    PrintAST( ((TControlFlowNode *)a)->condition, level);
-    if( ((TControlFlowNode *)a)->trueBranch)
+    if (loopDo == node.op)
+      out << "flow - do" << std::endl;
+    else if (loopFor == node.op)
+      out << "flow - for" << std::endl;
+    else
+      out << "flow - while" << std::endl;
+    PrintAST(tree,  node.first, level, out);
+    if( node.second)
+    {
+      out << std::string (2 * level, ' ');
+      out << "loop-body" << std::endl;
+      PrintAST(tree,  node.second, level + 1, out);
+    }
+    if( node.third)
     {
-      std::cout << std::string (2 * level, ' ');
-      std::cout << "loop-body" << std::endl;
-      PrintAST( ((TControlFlowNode *)a)->trueBranch, level + 1);
+      out << std::string (2 * level, ' ');
+      out << "loop-step" << std::endl;
+      PrintAST(tree,  node.third, level + 1, out);
     }
     return;
 		      
-  default: std::cout << "bad node " << a->nodetype << std::endl;
+  default: out << "bad node " << (int) node.nodetype << std::endl;
     return;
   }
 }
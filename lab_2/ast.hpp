@@ -3,7 +3,11 @@
 #ifndef _ABSTRACT_SYNTAX_TREE_HPP
 #define _ABSTRACT_SYNTAX_TREE_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
 #include <string>
+#include <vector>
 #include "subexpression.hpp"
 
 typedef enum
@@ -15,7 +19,7 @@ typedef enum
     typeIdentifier,        /* variable name */
     typeIfStatement,       /* IfStatement */
     typeWhileStatement,    /* WhileStatement */
-    typeJumpStatement,     /* Break or Continue statement */
+    typeJumpStatement,     /* Break, Continue or Return statement */
     typeList,              /* Expression or statement list */
     typeInput,             /* Input*/
     typeOutput,            /* Output*/
@@ -24,32 +28,86 @@ typedef enum
 } NodeTypeEnum;
 
 
-/* AST node declaration */
-/* Each node has to have a given type attribute */
-
-typedef struct TAbstractSyntaxTreeNode
+/* Operators of typeBinaryOp and typeUnaryOp nodes */
+typedef enum
+{
+    opNone,
+    opAdd,                 /* + */
+    opSubtract,            /* - */
+    opMultiply,            /* * */
+    opDivide,              /* / */
+    opLess,                /* < */
+    opGreater,             /* > */
+    opLessEqual,           /* <= */
+    opGreaterEqual,        /* >= */
+    opEqual,               /* == */
+    opNotEqual,            /* != */
+    opNegate,              /* unary - */
+    opToDouble             /* td, int to double conversion */
+} TOperatorEnum;
+
+/* Statements of typeJumpStatement nodes */
+typedef enum
 {
-  NodeTypeEnum nodetype;
-  SubexpressionValueTypeEnum valueType;
-  char opValue[3];
-  struct TAbstractSyntaxTreeNode* left;
-  struct TAbstractSyntaxTreeNode* right;
-} NodeAST;
+    jumpBreak,
+    jumpContinue,
+    jumpReturn
+} TJumpEnum;
 
-typedef struct
+/* Loops of typeWhileStatement nodes */
+typedef enum
 {
-  NodeTypeEnum nodetype;        /* IfStatement or WhileStatement node */
-  NodeAST* condition;  /* Condition expression */
-  NodeAST* trueBranch; /* true branch statement */
-  NodeAST* elseBranch; /* (optional) false branch statement */
-} TControlFlowNode;
+    loopWhile,
+    loopDo,                /* the body runs once before the first test */
+    loopFor                /* the step runs after the body and on continue */
+} TLoopEnum;
+
+/* Handle of a node: its index in the node vector of its tree. Index 0
+   is never a node and stands for no node. */
+typedef uint32_t TNodeIndex;
 
+#define NO_NODE 0
+
+/* Pool index of a constant that is not pooled */
+#define NOT_POOLED UINT32_MAX
+
+/* AST node declaration */
+/* Every node kind has the same fixed-size record; what the fields hold
+   depends on nodetype:
+     typeBinaryOp      op, first = left, second = right operand
+     typeUnaryOp       op, first = operand
+     typeInput, typeOutput, typeReturn
+                       first = operand
+     typeConst         first = index in the constant pool (or NOT_POOLED),
+                       the value in the union
+     typeIdentifier    first = symbol
+     typeJumpStatement op = TJumpEnum
+     typeAssignmentOp  first = symbol, second = value
+     typeIfStatement, typeFunctionStatment
+                       first = condition, second = true branch,
+                       third = else branch
+     typeWhileStatement
+                       op = TLoopEnum, first = condition, second = body,
+                       third = step of a for loop; the initialization of
+                       a for loop is the statement before it
+     typeList          first = position of the statements in the children
+                       of the tree, second = their count
+   Symbols are declarations of the variables of the tree, NO_SYMBOL is a
+   bad reference. */
 typedef struct
 {
-  NodeTypeEnum nodetype;			/* Type K */
-  SubexpressionValueTypeEnum valueType;
+  uint8_t nodetype;      /* NodeTypeEnum */
+  uint8_t valueType;     /* SubexpressionValueTypeEnum of an expression */
+  uint8_t op;            /* TOperatorEnum */
+  uint8_t reserved;
+  TNodeIndex first;
   union
   {
+    struct
+    {
+      TNodeIndex second;
+      TNodeIndex third;
+    };
     int    iNumber;
     double dNumber;
     char   cNumber;
@@ -59,50 +117,95 @@ typedef struct
     char*   cArrayNumber;
     bool*   bArrayNumber;
   };
-} TNumericValueNode;
+} TNode;
+
+static_assert(sizeof(TNode) == 16, "AST nodes are 16 bytes");
 
 #ifndef _SYMBOL_TABLE_HPP
 #include "symtable.hpp"
 #endif
 
+/* Bump-pointer storage for the array constants of a tree, released all
+   at once */
 typedef struct
 {
-  NodeTypeEnum nodetype;
-  SubexpressionValueTypeEnum valueType;
-  TSymbolTableElementPtr variable;
-} TSymbolTableReference;
+  std::vector<char*> blocks;   /* blocks[0] is kept for reuse by a reset */
+  char* next;                  /* free space of the current block */
+  char* end;
+} TNodeArena;
 
+#define NODE_ARENA_BLOCK_SIZE (256 * 1024)
+
+/* The AST of a compilation: nodes refer to each other by index, so the
+   whole tree is a few contiguous vectors */
 typedef struct
 {
-  NodeTypeEnum nodetype;
-  TSymbolTableElementPtr variable;
-  NodeAST* value;
-} TAssignmentNode;
+  std::vector<TNode> nodes;                   /* nodes[0] is a placeholder */
+  std::vector<TNodeIndex> children;           /* statements of the closed lists */
+  /* statements of the lists being parsed, innermost last; the vectors
+     past openLists are kept for reuse */
+  std::vector<std::vector<TNodeIndex> > lists;
+  unsigned openLists;
+  TNodeArena arrays;
+  /* declarations the symbols of the nodes refer to */
+  const TSymbolTable* variables;
+} TAst;
+
+void InitAst(TAst& tree);
+/* Frees every node, keeps the memory for the next tree and the
+   variables */
+void ResetAst(TAst& tree);
+/* Frees every node and all the memory */
+void ReleaseAst(TAst& tree);
+/* Zeroed storage of an array constant, lives as long as the tree; an
+   empty array has some too */
+void* AllocateArray(TAst& tree, size_t size);
+
+inline SubexpressionValueTypeEnum NodeValueType(const TAst& tree, TNodeIndex a)
+{
+  return (SubexpressionValueTypeEnum) tree.nodes[a].valueType;
+}
+
+/* Operator of a RELOP or MULOPERATOR token */
+TOperatorEnum OperatorFromText(const char* text);
+const char* OperatorText(TOperatorEnum op);
 
 /* AST procedures declaration */
-NodeAST* CreateNodeAST(NodeTypeEnum cmptype, const char* opValue,
-					   NodeAST* left, NodeAST* right);
-NodeAST* CreateNumberNode(double doubleValue);
-NodeAST* CreateNumberNode(int integerValue);
-NodeAST* CreateNumberNode(bool boolValue);
-NodeAST* CreateNumberNode(char charValue);
-NodeAST* CreateNumberNode(double* doubleArrayValue);
-NodeAST* CreateNumberNode(int* integerArrayValue);
-NodeAST* CreateNumberNode(bool* boolArrayValue);
-NodeAST* CreateNumberNode(char* charArrayValue);
-
-
-NodeAST* CreateControlFlowNode(NodeTypeEnum Nodetype, NodeAST* condition,
-                               NodeAST* trueBranch, NodeAST* elseBranch
-                              );
-NodeAST* CreateReferenceNode(TSymbolTableElementPtr symbol);
-NodeAST* CreateAssignmentNode(TSymbolTableElementPtr symbol, NodeAST* rightValue);
-
-/* Freeing AST node from memory space */
-void FreeAST(NodeAST *);
-
-void WriteXml(NodeAST *a, int level, std::ofstream &xml);
+TNodeIndex CreateNodeAST(TAst& tree, NodeTypeEnum cmptype, TOperatorEnum op,
+                         TNodeIndex left, TNodeIndex right);
+TNodeIndex CreateNumberNode(TAst& tree, double doubleValue);
+TNodeIndex CreateNumberNode(TAst& tree, int integerValue);
+TNodeIndex CreateNumberNode(TAst& tree, bool boolValue);
+TNodeIndex CreateNumberNode(TAst& tree, char charValue);
+TNodeIndex CreateNumberNode(TAst& tree, double* doubleArrayValue);
+TNodeIndex CreateNumberNode(TAst& tree, int* integerArrayValue);
+TNodeIndex CreateNumberNode(TAst& tree, bool* boolArrayValue);
+TNodeIndex CreateNumberNode(TAst& tree, char* charArrayValue);
+
+
+TNodeIndex CreateControlFlowNode(TAst& tree, NodeTypeEnum Nodetype, TNodeIndex condition,
+                                 TNodeIndex trueBranch, TNodeIndex elseBranch
+                                );
+TNodeIndex CreateJumpNode(TAst& tree, TJumpEnum jump);
+TNodeIndex CreateLoopNode(TAst& tree, TLoopEnum loop, TNodeIndex condition,
+                          TNodeIndex body, TNodeIndex step);
+/* Symbols are declarations of tree.variables */
+TNodeIndex CreateReferenceNode(TAst& tree, TSymbolId symbol);
+TNodeIndex CreateAssignmentNode(TAst& tree, TSymbolId symbol, TNodeIndex rightValue);
+
+/* Statement lists are built flat, one statement at a time; lists are
+   closed in the reverse order they are created, as nested blocks are */
+TNodeIndex CreateListNode(TAst& tree, TNodeIndex statement);
+TNodeIndex AppendListNode(TAst& tree, TNodeIndex list, TNodeIndex statement);
+/* The complete list, or its statement alone if there is only one */
+TNodeIndex CloseListNode(TAst& tree, TNodeIndex list);
+
+/* Declaration of an identifier or assignment node, NULL for a bad
+   reference */
+const TSymbolTableRecord* NodeSymbol(const TAst& tree, TNodeIndex a);
+
+void WriteXml(const TAst& tree, TNodeIndex a, int level, std::ofstream &xml);
 /* AST node dump */
-void PrintAST(NodeAST* aTree, int level);
+void PrintAST(const TAst& tree, TNodeIndex aTree, int level, std::ostream& out = std::cout);
 
 #endif
@@ -0,0 +1,1211 @@
+/*
+* Front end micro-benchmarks (make bench): scanning with the flex and the
+* hand-written scanners, parsing, symbol table, XML output and AST
+* teardown over synthetic programs of growing size and on about 100 MB
+* of source, with and without -pipeline, streamed parses of growing
+* length, and the interpreter over loops of growing length.
+* Throughput, allocations, peak RSS and, where the machine has hardware
+* counters, instructions per cycle and branch misses go to a JSON report.
+* With -superinstructions it instead times the candidates of make
+* superinstructions on the corpus programs.
+*/
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <malloc.h>
+#if defined __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+#include "simpl-driver.hpp"
+#include "interpreter.hpp"
+#include "bytecode.hpp"
+#include "regvm.hpp"
+#include "jit.hpp"
+#include "symtable.hpp"
+
+/* Runs of every stage, the best one is reported */
+#define BENCH_REPEATS 3
+
+/* Runs of a corpus program with and without a superinstruction that time
+   it for make superinstructions */
+#define SUPERINSTRUCTION_PAIRS 15
+
+/* Variables declared by every synthetic program */
+#define BENCH_VARIABLES 100
+
+/* Statements of the large input, about 100 MB of source */
+#define BENCH_LARGE_STATEMENTS 2700000
+
+/* Peak RSS a streamed parse may add for ten times as many statements */
+#define BENCH_STREAM_SLACK_KB 1024
+
+/* Allocations made through operator new since the start, and how many
+   of them have been deleted */
+static std::atomic<unsigned long> g_Allocations(0);
+static std::atomic<unsigned long> g_AllocatedBytes(0);
+static std::atomic<unsigned long> g_Releases(0);
+
+void* operator new(size_t size)
+{
+    g_Allocations.fetch_add(1, std::memory_order_relaxed);
+    g_AllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (NULL == p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    if (NULL != p)
+        g_Releases.fetch_add(1, std::memory_order_relaxed);
+    free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+// Allocations not deleted yet.
+static long LiveAllocations()
+{
+    return (long) (g_Allocations.load() - g_Releases.load());
+}
+
+typedef struct
+{
+    std::string name;
+    long size;              /* statements of the program */
+    double seconds;         /* best run */
+    double bytes;           /* source bytes processed, 0 if not applicable */
+    long items;             /* tokens, nodes or operations processed */
+    unsigned long allocations;
+    unsigned long allocatedBytes;
+    long peakRssKb;
+    long leakedAllocations; /* left by the runs once their driver is gone */
+    unsigned long dispatches; /* instructions a virtual machine executed */
+    long instructions;      /* hardware counters of the best run, -1 if unknown */
+    long cycles;
+    long branchMisses;
+} TBenchResult;
+
+/* Hardware counters of the user space of this thread, as perf stat
+   counts them; -1 where the machine or the kernel does not give one */
+static int g_InstructionCounter = -1;
+static int g_CycleCounter = -1;
+static int g_BranchMissCounter = -1;
+
+static int OpenCounter(unsigned long config)
+{
+#if defined __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    (void) config;
+    return -1;
+#endif
+}
+
+static void OpenCounters()
+{
+#if defined __linux__
+    g_InstructionCounter = OpenCounter(PERF_COUNT_HW_INSTRUCTIONS);
+    g_CycleCounter = OpenCounter(PERF_COUNT_HW_CPU_CYCLES);
+    g_BranchMissCounter = OpenCounter(PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+}
+
+static void StartCounter(int fd)
+{
+#if defined __linux__
+    if (fd >= 0)
+    {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+static long StopCounter(int fd)
+{
+#if defined __linux__
+    long long count;
+    if (fd >= 0)
+    {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) == (ssize_t) sizeof(count))
+            return (long) count;
+    }
+#endif
+    (void) fd;
+    return -1;
+}
+
+// Peak resident set size in kB; VmHWM is reset by ResetPeakRss where the
+// kernel allows it, the process-wide maximum is reported otherwise.
+static long PeakRssKb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (0 == line.compare(0, 6, "VmHWM:"))
+            return atol(line.c_str() + 6);
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static void ResetPeakRss()
+{
+    std::ofstream clear("/proc/self/clear_refs");
+    clear << "5";
+}
+
+// A program of declarations followed by statements assignments, if/else
+// and while loops in turn.
+static std::string GenerateProgram(long statements)
+{
+    std::ostringstream out;
+    for (int i = 0; i < BENCH_VARIABLES; ++i)
+        out << "int v" << i << " = " << i << "\n";
+    for (long i = 0; i < statements; ++i)
+    {
+        long a = i % BENCH_VARIABLES, b = (i * 7) % BENCH_VARIABLES, c = (i * 3) % BENCH_VARIABLES;
+        switch (i % 4)
+        {
+        case 0:
+        case 1:
+            out << "v" << a << " = v" << b << " + " << i % 1000 << " * (v" << c << " - 3)\n";
+            break;
+        case 2:
+            out << "if (v" << a << " > v" << b << ")\n{\n    v" << c << " = v" << c << " / 2\n}\n"
+                << "else\n{\n    echa(v" << a << ")\n}\n";
+            break;
+        case 3:
+            out << "while (v" << a << " < " << i % 1000 << ")\n{\n    v" << a << " = v" << a << " + 1\n}\n";
+            break;
+        }
+    }
+    return out.str();
+}
+
+// As many declarations in a single scope, each initialised from earlier
+// ones, so that most of the work is looking names up.
+static std::string GenerateDeclarations(long declarations)
+{
+    std::ostringstream out;
+    out << "int d0 = 0\n";
+    for (long i = 1; i < declarations; ++i)
+        out << "int d" << i << " = d" << (i * 7919 + 13) % i << " + d" << i / 2 << "\n";
+    return out.str();
+}
+
+// Assignments whose right-hand sides are mostly literal arithmetic.
+static std::string GenerateConstantExpressions(long statements)
+{
+    std::ostringstream out;
+    for (int i = 0; i < BENCH_VARIABLES; ++i)
+        out << "int v" << i << " = " << i << "\n";
+    out << "float f = 0.5\n";
+    for (long i = 0; i < statements; ++i)
+    {
+        long a = i % BENCH_VARIABLES, b = (i * 7) % BENCH_VARIABLES;
+        switch (i % 3)
+        {
+        case 0:
+            out << "v" << a << " = " << i % 1000 << " * 4 - 2 * (3 + v" << b << ")\n";
+            break;
+        case 1:
+            out << "echa(-(" << i % 1000 << " / 7) < 60 * 60)\n";
+            break;
+        case 2:
+            out << "f = f * 2.0 + 1.5 / 3.0\n";
+            break;
+        }
+    }
+    return out.str();
+}
+
+// Integer arithmetic in a loop of the given length.
+static std::string GenerateArithmeticLoop(long iterations, std::string& expected)
+{
+    std::ostringstream out;
+    out << "int i = 0\nint s = 0\nwhile (i < " << iterations << ")\n{\n"
+        << "    s = s + i * 3 - i / 7\n    i = i + 1\n}\necha(s)\n";
+    // ints wrap around
+    unsigned sum = 0;
+    for (long i = 0; i < iterations; ++i)
+        sum = sum + (unsigned) (i * 3) - (unsigned) (i / 7);
+    expected = std::to_string((int) sum) + "\n";
+    return out.str();
+}
+
+// A loop left by break, with a continue on every other iteration.
+static std::string GenerateBranchLoop(long iterations, std::string& expected)
+{
+    std::ostringstream out;
+    out << "int i = 0\nint odd = 0\nint even = 0\nwhile (1 == 1)\n{\n    i = i + 1\n"
+        << "    if (i > " << iterations << ")\n    {\n        break\n    }\n"
+        << "    if (i - i / 2 * 2 == 1)\n    {\n        odd = odd + i\n        continue\n    }\n"
+        << "    even = even + 1\n}\necha(odd)\necha(even)\n";
+    unsigned odd = 0;
+    long even = 0;
+    for (long i = 1; i <= iterations; ++i)
+    {
+        if (i % 2 == 1)
+            odd += (unsigned) i;
+        else
+            ++even;
+    }
+    expected = std::to_string((int) odd) + "\n" + std::to_string(even) + "\n";
+    return out.str();
+}
+
+// Nested loops over doubles.
+static std::string GenerateFloatLoop(long iterations, std::string& expected)
+{
+    std::ostringstream out;
+    out << "float x = 0.0\nint i = 0\nwhile (i < " << iterations / 10 << ")\n{\n"
+        << "    int j = 0\n    while (j < 10)\n    {\n        x = x * 0.999 + 0.5\n"
+        << "        if (x > 100.0)\n        {\n            x = x - 100.0\n        }\n"
+        << "        j = j + 1\n    }\n    i = i + 1\n}\necha(x)\n";
+    double x = 0.0;
+    for (long i = 0; i < iterations / 10 * 10; ++i)
+    {
+        x = x * 0.999 + 0.5;
+        if (x > 100.0)
+            x = x - 100.0;
+    }
+    std::ostringstream value;
+    value << x << "\n";
+    expected = value.str();
+    return out.str();
+}
+
+// Write the program to a temporary file, returns its name or "" on failure.
+static std::string WriteProgram(const std::string& text, long& bytes)
+{
+    char name[] = "/tmp/simpl-bench-XXXXXX";
+    int fd = mkstemp(name);
+    if (fd < 0)
+    {
+        perror("mkstemp");
+        return "";
+    }
+    bytes = (long) text.size();
+    const char* p = text.data();
+    size_t left = text.size();
+    while (left > 0)
+    {
+        ssize_t written = write(fd, p, left);
+        if (written <= 0)
+        {
+            perror("write");
+            close(fd);
+            unlink(name);
+            return "";
+        }
+        p += written;
+        left -= written;
+    }
+    close(fd);
+    return name;
+}
+
+// Counters of one run of a stage, kept if the run is the fastest so far.
+class TStageTimer
+{
+public:
+    TStageTimer(TBenchResult& result) : best(result)
+    {
+        ResetPeakRss();
+        allocations = g_Allocations.load();
+        allocatedBytes = g_AllocatedBytes.load();
+        StartCounter(g_InstructionCounter);
+        StartCounter(g_CycleCounter);
+        StartCounter(g_BranchMissCounter);
+        start = std::chrono::steady_clock::now();
+    }
+
+    void stop(long items)
+    {
+        auto end = std::chrono::steady_clock::now();
+        long instructions = StopCounter(g_InstructionCounter);
+        long cycles = StopCounter(g_CycleCounter);
+        long branchMisses = StopCounter(g_BranchMissCounter);
+        double seconds = std::chrono::duration<double>(end - start).count();
+        if (best.seconds < 0 || seconds < best.seconds)
+        {
+            best.seconds = seconds;
+            best.items = items;
+            best.allocations = g_Allocations.load() - allocations;
+            best.allocatedBytes = g_AllocatedBytes.load() - allocatedBytes;
+            best.peakRssKb = PeakRssKb();
+            best.instructions = instructions;
+            best.cycles = cycles;
+            best.branchMisses = branchMisses;
+        }
+    }
+
+private:
+    TBenchResult& best;
+    unsigned long allocations;
+    unsigned long allocatedBytes;
+    std::chrono::steady_clock::time_point start;
+};
+
+static TBenchResult NewResult(const std::string& name, long size, double bytes)
+{
+    TBenchResult r;
+    r.name = name;
+    r.size = size;
+    r.seconds = -1;
+    r.bytes = bytes;
+    r.items = 0;
+    r.allocations = 0;
+    r.allocatedBytes = 0;
+    r.peakRssKb = 0;
+    r.leakedAllocations = 0;
+    r.dispatches = 0;
+    r.instructions = -1;
+    r.cycles = -1;
+    r.branchMisses = -1;
+    return r;
+}
+
+static long CountNodes(const TAst& tree, TNodeIndex a)
+{
+    if (NO_NODE == a)
+        return 0;
+    const TNode& node = tree.nodes[a];
+    switch (node.nodetype)
+    {
+    case typeIfStatement:
+    case typeWhileStatement:
+    case typeFunctionStatment:
+        return 1 + CountNodes(tree, node.first) + CountNodes(tree, node.second) + CountNodes(tree, node.third);
+    case typeList:
+    {
+        long count = 1;
+        for (auto i = 0u; i < node.second; ++i)
+            count += CountNodes(tree, tree.children[node.first + i]);
+        return count;
+    }
+    case typeAssignmentOp:
+        return 1 + CountNodes(tree, node.second);
+    case typeIdentifier:
+    case typeConst:
+        return 1;
+    default:
+        return 1 + CountNodes(tree, node.first) + CountNodes(tree, node.second);
+    }
+}
+
+// Scan with both scanners, then parse, dump and free one program with a
+// driver of its own.
+static void BenchProgramRun(const std::string& filename, TBenchResult& flexLex, TBenchResult& lex,
+                            TBenchResult& parse, TBenchResult& xml, TBenchResult& teardown)
+{
+    Simpl_driver driver;
+    {
+        TStageTimer timer(flexLex);
+        long tokens = driver.lex(filename);
+        timer.stop(tokens);
+    }
+    driver.fast_scanning = true;
+    {
+        TStageTimer timer(lex);
+        long tokens = driver.lex(filename);
+        timer.stop(tokens);
+    }
+
+    driver.keep_ast = true;
+    driver.ast = NO_NODE;
+    {
+        TStageTimer timer(parse);
+        int failed = driver.parse(filename);
+        timer.stop(failed ? 0 : 1);
+    }
+    if (NO_NODE == driver.ast)
+    {
+        std::cerr << filename << ": the synthetic program does not parse" << std::endl;
+        exit(1);
+    }
+    long nodes = CountNodes(driver.tree, driver.ast);
+    parse.items = nodes;
+
+    {
+        std::ofstream sink("/dev/null");
+        TStageTimer timer(xml);
+        WriteXml(driver.tree, driver.ast, 0, sink);
+        sink.flush();
+        timer.stop(nodes);
+    }
+
+    {
+        TStageTimer timer(teardown);
+        ResetAst(driver.tree);
+        timer.stop(nodes);
+    }
+    DestroyUserVariableTable(driver.ast_symbols);
+    driver.ast = NO_NODE;
+    driver.ast_symbols = NULL;
+}
+
+// Scan, parse, dump and free the program a few times over.
+static void BenchProgram(const std::string& filename, long size, double bytes,
+                         std::vector<TBenchResult>& results)
+{
+    TBenchResult flexLex = NewResult("lex_flex", size, bytes);
+    TBenchResult lex = NewResult("lex", size, bytes);
+    TBenchResult parse = NewResult("parse", size, bytes);
+    TBenchResult xml = NewResult("write_xml", size, 0);
+    TBenchResult teardown = NewResult("free_ast", size, 0);
+
+    for (int run = 0; run < BENCH_REPEATS; ++run)
+    {
+        long live = LiveAllocations();
+        BenchProgramRun(filename, flexLex, lex, parse, xml, teardown);
+        // everything the driver made has gone with it
+        parse.leakedAllocations += LiveAllocations() - live;
+    }
+
+    std::cerr << "bench: lex of " << size << " statements, the hand-written scanner "
+              << flexLex.seconds / lex.seconds << "x as fast as flex" << std::endl;
+    results.push_back(flexLex);
+    results.push_back(lex);
+    results.push_back(parse);
+    results.push_back(xml);
+    results.push_back(teardown);
+}
+
+// Mark the nodes of the tree under a.
+static void MarkNodes(const TAst& tree, TNodeIndex a, std::vector<bool>& reached)
+{
+    if (NO_NODE == a)
+        return;
+    reached[a] = true;
+    const TNode& node = tree.nodes[a];
+    switch (node.nodetype)
+    {
+    case typeIfStatement:
+    case typeWhileStatement:
+    case typeFunctionStatment:
+        MarkNodes(tree, node.first, reached);
+        MarkNodes(tree, node.second, reached);
+        MarkNodes(tree, node.third, reached);
+        return;
+    case typeList:
+        for (auto i = 0u; i < node.second; ++i)
+            MarkNodes(tree, tree.children[node.first + i], reached);
+        return;
+    case typeAssignmentOp:
+        MarkNodes(tree, node.second, reached);
+        return;
+    case typeIdentifier:
+    case typeConst:
+        return;
+    default:
+        MarkNodes(tree, node.first, reached);
+        MarkNodes(tree, node.second, reached);
+        return;
+    }
+}
+
+// Nodes of the node vector neither in the tree under a nor pooled.
+static long CountUnreachable(const TAst& tree, const TConstantPool& pool, TNodeIndex a)
+{
+    std::vector<bool> reached(tree.nodes.size(), false);
+    MarkNodes(tree, a, reached);
+    for (TNodeIndex constant : pool.constants)
+        reached[constant] = true;
+    long unreachable = 0;
+    for (bool r : reached)
+        unreachable += !r;
+    return unreachable;
+}
+
+// Statements a streamed parse handed over, instead of printing them.
+static long g_StreamedStatements = 0;
+
+static void CountStatement(TNodeIndex, Simpl_driver&)
+{
+    ++g_StreamedStatements;
+}
+
+// Stream top-level blocks that each declare two variables, size of them
+// and ten times as many: every statement and its declarations are freed
+// once parsed, so the longer stream must not reach a higher peak RSS.
+static void BenchStreaming(long size, std::vector<TBenchResult>& results)
+{
+    TBenchResult streams[2] = {NewResult("stream_blocks_short", size, 0),
+                               NewResult("stream_blocks", size, 0)};
+    for (int i = 0; i < 2; ++i)
+    {
+        long blocks = i > 0 ? size * 10 : size;
+        long bytes = 0;
+        std::string filename;
+        {
+            std::string text;
+            for (long b = 0; b < blocks; ++b)
+                text += "{ int x = 1 int y = x }\n";
+            filename = WriteProgram(text, bytes);
+        }
+        if (filename.empty())
+            exit(1);
+        streams[i].bytes = bytes;
+        for (int run = 0; run < BENCH_REPEATS; ++run)
+        {
+            // what earlier stages freed must not hide what this one takes
+            malloc_trim(0);
+            Simpl_driver driver;
+            driver.streaming = true;
+            // a mapped file would count in RSS as a whole, read it as stdin is
+            driver.mmap_input = false;
+            driver.statement_handler = CountStatement;
+            g_StreamedStatements = 0;
+            TStageTimer timer(streams[i]);
+            int failed = driver.parse(filename);
+            timer.stop(g_StreamedStatements);
+            if (failed || g_StreamedStatements != blocks)
+            {
+                std::cerr << filename << ": streamed " << g_StreamedStatements << " of "
+                          << blocks << " blocks" << std::endl;
+                exit(1);
+            }
+        }
+        unlink(filename.c_str());
+    }
+    if (streams[1].peakRssKb > streams[0].peakRssKb + BENCH_STREAM_SLACK_KB)
+    {
+        std::cerr << "bench: streaming " << size * 10 << " blocks peaked at " << streams[1].peakRssKb
+                  << " kB, " << size << " at " << streams[0].peakRssKb << " kB" << std::endl;
+        exit(1);
+    }
+    results.push_back(streams[0]);
+    results.push_back(streams[1]);
+}
+
+// Scan and parse about 100 MB of source, parsing with the scanner on the
+// parser's thread and then on a lexer thread of its own (-pipeline).
+static void BenchLargeInput(std::vector<TBenchResult>& results)
+{
+    long bytes = 0;
+    std::string filename = WriteProgram(GenerateProgram(BENCH_LARGE_STATEMENTS), bytes);
+    if (filename.empty())
+        exit(1);
+    TBenchResult flexLex = NewResult("lex_flex", BENCH_LARGE_STATEMENTS, bytes);
+    TBenchResult lex = NewResult("lex", BENCH_LARGE_STATEMENTS, bytes);
+    TBenchResult parse = NewResult("parse", BENCH_LARGE_STATEMENTS, bytes);
+    TBenchResult pipelined = NewResult("parse_pipeline", BENCH_LARGE_STATEMENTS, bytes);
+    for (int run = 0; run < BENCH_REPEATS; ++run)
+    {
+        Simpl_driver driver;
+        {
+            TStageTimer timer(flexLex);
+            timer.stop(driver.lex(filename));
+        }
+        driver.fast_scanning = true;
+        {
+            TStageTimer timer(lex);
+            timer.stop(driver.lex(filename));
+        }
+        for (int i = 0; i < 2; ++i)
+        {
+            driver.pipelined = i > 0;
+            TStageTimer timer(driver.pipelined ? pipelined : parse);
+            int failed = driver.parse(filename);
+            timer.stop(failed ? 0 : 1);
+            if (failed)
+            {
+                std::cerr << filename << ": the large program does not parse" << std::endl;
+                exit(1);
+            }
+        }
+    }
+    unlink(filename.c_str());
+    std::cerr << "bench: " << bytes / 1000000 << " MB of source, scanning " << lex.bytes / lex.seconds / 1e6
+              << " MB/s (flex " << flexLex.bytes / flexLex.seconds / 1e6 << "), parsing "
+              << parse.bytes / parse.seconds / 1e6 << " MB/s, pipelined " << pipelined.bytes / pipelined.seconds / 1e6
+              << " MB/s" << std::endl;
+    results.push_back(flexLex);
+    results.push_back(lex);
+    results.push_back(parse);
+    results.push_back(pipelined);
+}
+
+// Fold a parsed program, then parse it folding as it goes; both must
+// take out as many nodes, and what they count as freed or unreachable
+// must be so.
+static void BenchFolding(long size, std::vector<TBenchResult>& results)
+{
+    long bytes = 0;
+    std::string filename = WriteProgram(GenerateConstantExpressions(size), bytes);
+    if (filename.empty())
+        exit(1);
+    TBenchResult fold = NewResult("fold_constants", size, 0);
+    TBenchResult parse = NewResult("parse_folding", size, bytes);
+    for (int run = 0; run < BENCH_REPEATS; ++run)
+    {
+        long live = LiveAllocations();
+        TFoldCount folded = {0, 0};
+        {
+            Simpl_driver driver;
+            driver.fast_scanning = true;
+            driver.keep_ast = true;
+            if (driver.parse(filename) || NO_NODE == driver.ast)
+            {
+                std::cerr << filename << ": the synthetic program does not parse" << std::endl;
+                exit(1);
+            }
+            long nodes = CountNodes(driver.tree, driver.ast);
+            long length = driver.tree.nodes.size();
+            long constants = driver.constants.constants.size();
+            long unreachable = CountUnreachable(driver.tree, driver.constants, driver.ast);
+            {
+                TStageTimer timer(fold);
+                driver.ast = FoldConstants(driver.tree, driver.constants, driver.ast, folded);
+                timer.stop(nodes);
+            }
+            // the only nodes folding adds are new pooled constants
+            long added = driver.constants.constants.size() - constants;
+            if ((long) driver.tree.nodes.size() != length - folded.removed + added
+                || CountUnreachable(driver.tree, driver.constants, driver.ast) != unreachable + folded.unreachable)
+            {
+                std::cerr << filename << ": folding freed " << folded.removed << " and left "
+                          << folded.unreachable << " nodes unreachable, but the node vector went from "
+                          << length << " to " << driver.tree.nodes.size() << " with "
+                          << CountUnreachable(driver.tree, driver.constants, driver.ast) - unreachable
+                          << " more unreachable" << std::endl;
+                exit(1);
+            }
+            DestroyUserVariableTable(driver.ast_symbols);
+        }
+        {
+            Simpl_driver driver;
+            driver.fast_scanning = true;
+            driver.folding_constants = true;
+            TStageTimer timer(parse);
+            int failed = driver.parse(filename);
+            long parsed = driver.folded_nodes.removed + driver.folded_nodes.unreachable;
+            timer.stop(failed ? 0 : parsed);
+            if (parsed != folded.removed + folded.unreachable)
+            {
+                std::cerr << filename << ": the parser folded " << parsed
+                          << " nodes, the pass " << folded.removed + folded.unreachable << std::endl;
+                exit(1);
+            }
+        }
+        parse.leakedAllocations += LiveAllocations() - live;
+    }
+    unlink(filename.c_str());
+    results.push_back(fold);
+    results.push_back(parse);
+}
+
+// Parse a program of declarations only; with hashed scopes the time
+// grows linearly with their number.
+static void BenchDeclarations(long size, std::vector<TBenchResult>& results)
+{
+    long bytes = 0;
+    std::string filename = WriteProgram(GenerateDeclarations(size), bytes);
+    if (filename.empty())
+        exit(1);
+    TBenchResult parse = NewResult("parse_declarations", size, bytes);
+    for (int run = 0; run < BENCH_REPEATS; ++run)
+    {
+        long live = LiveAllocations();
+        {
+            Simpl_driver driver;
+            driver.fast_scanning = true;
+            TStageTimer timer(parse);
+            int failed = driver.parse(filename);
+            timer.stop(failed ? 0 : size);
+        }
+        parse.leakedAllocations += LiveAllocations() - live;
+    }
+    unlink(filename.c_str());
+    results.push_back(parse);
+}
+
+// Declare names in a chain of nested scopes, as the parser does for
+// blocks, look them up from the innermost one and close the scopes.
+static void BenchSymbolTable(long size, std::vector<TBenchResult>& results)
+{
+    const int depth = 8;
+    TIdentifierTable identifiers;
+    std::vector<const TIdentifier*> names;
+    for (long i = 0; i < size; ++i)
+    {
+        std::string name = "s" + std::to_string(i);
+        names.push_back(InternIdentifier(identifiers, name.data(), name.size()));
+    }
+
+    TBenchResult insert = NewResult("symtab_insert", size, 0);
+    TBenchResult lookup = NewResult("symtab_lookup", size, 0);
+    TBenchResult exitScopes = NewResult("symtab_exit", size, 0);
+    for (int run = 0; run < BENCH_REPEATS; ++run)
+    {
+        TSymbolTable* table = CreateSymbolTable();
+
+        {
+            /* an eighth of the names per scope, going inwards */
+            TStageTimer timer(insert);
+            for (long i = 0; i < size; ++i)
+            {
+                if (i > 0 && 0 == i % ((size + depth - 1) / depth))
+                    EnterScope(table);
+                DeclareSymbol(table, names[i], typeInt);
+            }
+            timer.stop(size);
+        }
+
+        {
+            /* every name from the innermost scope, most live further out */
+            TStageTimer timer(lookup);
+            long found = 0;
+            for (long i = 0; i < size; ++i)
+            {
+                if (NO_SYMBOL != LookupSymbolRecursive(table, names[i]))
+                    ++found;
+            }
+            timer.stop(found);
+        }
+
+        {
+            TStageTimer timer(exitScopes);
+            while (ExitScope(table))
+                ;
+            timer.stop(size);
+        }
+        DestroyUserVariableTable(table);
+    }
+    ClearIdentifierTable(identifiers);
+    results.push_back(insert);
+    results.push_back(lookup);
+    results.push_back(exitScopes);
+}
+
+// A run of an execution stage must succeed and print what is expected.
+static void CheckRun(const std::string& filename, const std::string& stage, bool ok,
+                     const std::string& printed, const std::string& error, const std::string& expected)
+{
+    if (!ok || printed != expected)
+    {
+        std::cerr << filename << ": " << stage << " printed '" << printed << "' "
+                  << error << ", expected '" << expected << "'" << std::endl;
+        exit(1);
+    }
+}
+
+// Times the tree-walker, its steps are the items; returns the share of
+// the operators it evaluated that were not specialized.
+static double BenchInterpreter(TBenchResult& stage, const TAst& tree, TNodeIndex program,
+                               const std::string& filename, const std::string& expected, bool specializing)
+{
+    double unspecializedShare = 0;
+    for (int i = 0; i < BENCH_REPEATS; ++i)
+    {
+        std::istringstream in;
+        std::ostringstream out;
+        TInterpreter vm;
+        InitInterpreter(vm, tree, in, out);
+        vm.specializing = specializing;
+        TStageTimer timer(stage);
+        bool ok = RunProgram(vm, program);
+        timer.stop(vm.steps);
+        CheckRun(filename, stage.name, ok, out.str(), vm.error, expected);
+        unspecializedShare = vm.operations > 0 ? (double) vm.unspecialized / vm.operations : 0;
+    }
+    return unspecializedShare;
+}
+
+// Times the stack machine running the bytecode, counting items a run.
+static void BenchStack(TBenchResult& stage, const TBytecode& bytecode, const std::string& filename,
+                       const std::string& expected, long items)
+{
+    for (int i = 0; i < BENCH_REPEATS; ++i)
+    {
+        std::istringstream in;
+        std::ostringstream out;
+        TStackMachine vm;
+        InitStackMachine(vm, bytecode, in, out);
+        TStageTimer timer(stage);
+        bool ok = RunBytecode(vm);
+        timer.stop(items);
+        CheckRun(filename, stage.name, ok, out.str(), vm.error, expected);
+        stage.dispatches = vm.dispatches;
+    }
+}
+
+// Each superinstruction the program uses, alone, against none.
+static void BenchSuperinstructions(const std::string& name, const TAst& tree, TNodeIndex program,
+                                   const std::string& filename, const std::string& expected,
+                                   const TBenchResult& unfused)
+{
+    for (unsigned k = 0; k < opcodeCount - FIRST_SUPERINSTRUCTION; ++k)
+    {
+        TBytecode bytecode;
+        CompileBytecode(bytecode, tree, program, 1u << k);
+        bool used = false;
+        for (const TInstruction& instruction : bytecode.code)
+            used = used || FIRST_SUPERINSTRUCTION + k == instruction.opcode;
+        if (!used)
+            continue;
+        TBenchResult fused = NewResult(name, unfused.size, 0);
+        BenchStack(fused, bytecode, filename, expected, unfused.items);
+        std::cerr << "bench: " << name << ", " << OpcodeName(FIRST_SUPERINSTRUCTION + k) << " alone "
+                  << unfused.seconds / fused.seconds << "x the stack machine without superinstructions, "
+                  << (double) fused.dispatches / fused.items << " dispatches a statement" << std::endl;
+    }
+}
+
+// Interpret a program on the tree-walker, the stack machine and the
+// register machine, which must all print what is expected; the items are
+// the statements the tree-walker executed, so the stages of the engines
+// compare directly.
+static void BenchRun(const std::string& name, const std::string& text, const std::string& expected,
+                     long size, std::vector<TBenchResult>& results)
+{
+    long bytes = 0;
+    std::string filename = WriteProgram(text, bytes);
+    if (filename.empty())
+        exit(1);
+    TBenchResult run = NewResult(name, size, 0);
+    TBenchResult unspecialized = NewResult(name + "_unspecialized", size, 0);
+    TBenchResult stack = NewResult(name + "_stack", size, 0);
+    TBenchResult unfused = NewResult(name + "_stack_unfused", size, 0);
+    TBenchResult registers = NewResult(name + "_register", size, 0);
+    TBenchResult native = NewResult(name + "_jit", size, 0);
+    Simpl_driver driver;
+    driver.fast_scanning = true;
+    driver.keep_ast = true;
+    if (driver.parse(filename) || NO_NODE == driver.ast)
+    {
+        std::cerr << filename << ": the synthetic program does not parse" << std::endl;
+        exit(1);
+    }
+    double unspecializedShare = BenchInterpreter(run, driver.tree, driver.ast, filename, expected, true);
+    BenchInterpreter(unspecialized, driver.tree, driver.ast, filename, expected, false);
+    TBytecode bytecode;
+    CompileBytecode(bytecode, driver.tree, driver.ast);
+    BenchStack(stack, bytecode, filename, expected, run.items);
+    CompileBytecode(bytecode, driver.tree, driver.ast, 0);
+    BenchStack(unfused, bytecode, filename, expected, run.items);
+    TJitCode jit;
+    bool compiled = CompileJit(jit, bytecode);
+    for (int i = 0; compiled && i < BENCH_REPEATS; ++i)
+    {
+        std::istringstream in;
+        std::ostringstream out;
+        TStackMachine vm;
+        InitStackMachine(vm, bytecode, in, out);
+        TStageTimer timer(native);
+        bool ok = RunJit(vm, jit);
+        timer.stop(run.items);
+        CheckRun(filename, native.name, ok, out.str(), vm.error, expected);
+    }
+    ReleaseJit(jit);
+    TRegisterCode code;
+    CompileRegisterCode(code, driver.tree, driver.ast);
+    for (int i = 0; i < BENCH_REPEATS; ++i)
+    {
+        std::istringstream in;
+        std::ostringstream out;
+        TRegisterMachine vm;
+        InitRegisterMachine(vm, code, in, out);
+        TStageTimer timer(registers);
+        bool ok = RunRegisterCode(vm);
+        timer.stop(run.items);
+        CheckRun(filename, registers.name, ok, out.str(), vm.error, expected);
+        registers.dispatches = vm.dispatches;
+    }
+    std::cerr << "bench: " << name << " of " << size << " statements, specializing makes the tree-walker "
+              << unspecialized.seconds / run.seconds << "x as fast, " << unspecializedShare * 100
+              << "% of its operators left unspecialized" << std::endl;
+    std::cerr << "bench: " << name << " of " << size << " statements, stack machine "
+              << run.seconds / stack.seconds << "x the tree-walker, "
+              << (double) stack.dispatches / run.items << " dispatches a statement; register machine "
+              << run.seconds / registers.seconds << "x, "
+              << (double) registers.dispatches / run.items << " dispatches a statement" << std::endl;
+    std::cerr << "bench: " << name << ", superinstructions make the stack machine "
+              << unfused.seconds / stack.seconds << "x as fast, "
+              << (double) unfused.dispatches / run.items << " dispatches a statement without them" << std::endl;
+    if (compiled)
+        std::cerr << "bench: " << name << ", JIT " << run.seconds / native.seconds << "x the tree-walker, "
+                  << stack.seconds / native.seconds << "x the stack machine" << std::endl;
+    BenchSuperinstructions(unfused.name, driver.tree, driver.ast, filename, expected, unfused);
+    DestroyUserVariableTable(driver.ast_symbols);
+    driver.ast_symbols = NULL;
+    unlink(filename.c_str());
+    results.push_back(run);
+    results.push_back(unspecialized);
+    results.push_back(stack);
+    results.push_back(unfused);
+    results.push_back(registers);
+    if (compiled)
+        results.push_back(native);
+}
+
+// The execution stages, loops of ten times the size.
+static void BenchExecution(long size, std::vector<TBenchResult>& results)
+{
+    std::string expected;
+    std::string text = GenerateArithmeticLoop(size * 10, expected);
+    BenchRun("run_arithmetic", text, expected, size, results);
+    text = GenerateBranchLoop(size * 10, expected);
+    BenchRun("run_branches", text, expected, size, results);
+    text = GenerateFloatLoop(size * 10, expected);
+    BenchRun("run_float", text, expected, size, results);
+}
+
+// Parse a corpus program, keeping its tree in the driver.
+static bool ParseCorpusProgram(Simpl_driver& driver, const std::string& filename)
+{
+    driver.fast_scanning = true;
+    driver.keep_ast = true;
+    if (driver.parse(filename) || NO_NODE == driver.ast)
+    {
+        std::cerr << filename << ": the corpus program does not parse" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Run the bytecode once; false on a runtime error, which is reported.
+static bool RunCorpusProgram(const std::string& filename, const TBytecode& bytecode,
+                             std::string& printed, unsigned long& dispatches, double& seconds)
+{
+    std::istringstream in;
+    std::ostringstream out;
+    TStackMachine vm;
+    InitStackMachine(vm, bytecode, in, out);
+    auto start = std::chrono::steady_clock::now();
+    bool ok = RunBytecode(vm);
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!ok)
+    {
+        std::cerr << filename << ": runtime error: " << vm.error << std::endl;
+        return false;
+    }
+    printed = out.str();
+    dispatches = vm.dispatches;
+    return true;
+}
+
+// Each superinstruction of the build, alone, against none on the corpus
+// program where it saves the most dispatches; superinstructions.def is
+// then written again with those that are faster there.
+static int SelectSuperinstructions(const std::string& output, const std::vector<std::string>& files)
+{
+    unsigned count = opcodeCount - FIRST_SUPERINSTRUCTION;
+    std::vector<unsigned long> saved(count, 0);
+    std::vector<size_t> programs(count, 0);
+    for (size_t f = 0; f < files.size(); ++f)
+    {
+        Simpl_driver driver;
+        if (!ParseCorpusProgram(driver, files[f]))
+            return 1;
+        TBytecode bytecode;
+        CompileBytecode(bytecode, driver.tree, driver.ast, 0);
+        std::string expected, printed;
+        unsigned long dispatches, fused;
+        double seconds;
+        if (!RunCorpusProgram(files[f], bytecode, expected, dispatches, seconds))
+            return 1;
+        for (unsigned k = 0; k < count; ++k)
+        {
+            CompileBytecode(bytecode, driver.tree, driver.ast, 1u << k);
+            if (!RunCorpusProgram(files[f], bytecode, printed, fused, seconds))
+                return 1;
+            CheckRun(files[f], OpcodeName(FIRST_SUPERINSTRUCTION + k), true, printed, "", expected);
+            if (dispatches - fused > saved[k])
+            {
+                saved[k] = dispatches - fused;
+                programs[k] = f;
+            }
+        }
+        DestroyUserVariableTable(driver.ast_symbols);
+        driver.ast_symbols = NULL;
+    }
+
+    // a fused and an unfused run side by side give one ratio, and the
+    // median of these holds up when the machine has slow spells
+    std::vector<double> speedups(count, 0);
+    for (size_t f = 0; f < files.size(); ++f)
+    {
+        Simpl_driver driver;
+        if (!ParseCorpusProgram(driver, files[f]))
+            return 1;
+        TBytecode unfusedCode;
+        CompileBytecode(unfusedCode, driver.tree, driver.ast, 0);
+        for (unsigned k = 0; k < count; ++k)
+        {
+            if (0 == saved[k] || programs[k] != f)
+                continue;
+            TBytecode bytecode;
+            CompileBytecode(bytecode, driver.tree, driver.ast, 1u << k);
+            std::vector<double> ratios;
+            for (int pair = 0; pair < SUPERINSTRUCTION_PAIRS; ++pair)
+            {
+                std::string printed;
+                unsigned long dispatches;
+                double unfused, fused;
+                if (!RunCorpusProgram(files[f], unfusedCode, printed, dispatches, unfused)
+                    || !RunCorpusProgram(files[f], bytecode, printed, dispatches, fused))
+                    return 1;
+                ratios.push_back(unfused / fused);
+            }
+            std::sort(ratios.begin(), ratios.end());
+            speedups[k] = ratios[ratios.size() / 2];
+        }
+        DestroyUserVariableTable(driver.ast_symbols);
+        driver.ast_symbols = NULL;
+    }
+
+    for (unsigned k = 0; k < count; ++k)
+    {
+        std::cerr << "bench: " << OpcodeName(FIRST_SUPERINSTRUCTION + k);
+        if (0 == saved[k])
+            std::cerr << " saves nothing in the corpus";
+        else
+            std::cerr << " alone " << speedups[k] << "x the stack machine without superinstructions on "
+                      << files[programs[k]] << ", " << saved[k] << " dispatches saved";
+        std::cerr << (speedups[k] >= SUPERINSTRUCTION_MIN_SPEEDUP ? ", kept" : ", dropped") << std::endl;
+    }
+    std::ofstream def(output);
+    if (!def)
+    {
+        perror(output.c_str());
+        return 1;
+    }
+    WriteTimedSuperinstructions(speedups, def);
+    return def ? 0 : 1;
+}
+
+static void WriteJson(std::ostream& out, const std::vector<TBenchResult>& results)
+{
+    out << "{\n  \"repeats\": " << BENCH_REPEATS << ",\n";
+#ifdef THREADED_DISPATCH
+    out << "  \"dispatch\": \"threaded\",\n";
+#else
+    out << "  \"dispatch\": \"switch\",\n";
+#endif
+    out << "  \"hardware_counters\": " << (g_CycleCounter >= 0 ? "true" : "false")
+        << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const TBenchResult& r = results[i];
+        double seconds = r.seconds > 0 ? r.seconds : 1e-9;
+        out << "    {\"stage\": \"" << r.name << "\", \"statements\": " << r.size
+            << ", \"seconds\": " << r.seconds
+            << ", \"items\": " << r.items
+            << ", \"items_per_second\": " << r.items / seconds;
+        if (r.bytes > 0)
+            out << ", \"bytes\": " << (long) r.bytes
+                << ", \"mb_per_second\": " << r.bytes / seconds / 1e6;
+        if (r.dispatches > 0)
+            out << ", \"dispatches\": " << r.dispatches
+                << ", \"dispatches_per_statement\": " << (double) r.dispatches / r.items;
+        if (r.instructions >= 0 && r.cycles > 0)
+            out << ", \"instructions\": " << r.instructions << ", \"cycles\": " << r.cycles
+                << ", \"ipc\": " << (double) r.instructions / r.cycles;
+        if (r.branchMisses >= 0)
+            out << ", \"branch_misses\": " << r.branchMisses;
+        out << ", \"allocations\": " << r.allocations
+            << ", \"allocated_bytes\": " << r.allocatedBytes
+            << ", \"peak_rss_kb\": " << r.peakRssKb
+            << ", \"leaked_allocations\": " << r.leakedAllocations << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char** argv)
+{
+    // -superinstructions DEF PROGRAM... keeps the superinstructions that
+    // pay off, see make superinstructions
+    if (argc > 3 && argv[1] == std::string("-superinstructions"))
+        return SelectSuperinstructions(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+
+    std::string output = argc > 1 ? argv[1] : "bench.json";
+    const long sizes[] = {1000, 10000, 100000};
+    std::vector<TBenchResult> results;
+
+    OpenCounters();
+    if (g_CycleCounter < 0)
+        std::cerr << "bench: no hardware counters, instructions per cycle and branch misses "
+                  << "are not reported" << std::endl;
+
+    for (long size : sizes)
+    {
+        long bytes = 0;
+        std::string filename = WriteProgram(GenerateProgram(size), bytes);
+        if (filename.empty())
+            return 1;
+        BenchProgram(filename, size, bytes, results);
+        unlink(filename.c_str());
+        BenchDeclarations(size, results);
+        BenchFolding(size, results);
+        BenchStreaming(size, results);
+        BenchSymbolTable(size, results);
+        BenchExecution(size, results);
+        std::cerr << "bench: " << size << " statements done" << std::endl;
+    }
+    BenchLargeInput(results);
+
+    std::ofstream json(output);
+    if (!json)
+    {
+        perror(output.c_str());
+        return 1;
+    }
+    WriteJson(json, results);
+    std::cerr << "bench: results written to " << output << std::endl;
+    for (const TBenchResult& r : results)
+        if (r.leakedAllocations != 0)
+        {
+            std::cerr << "bench: " << r.name << " of " << r.size << " statements leaked "
+                      << r.leakedAllocations << " allocations" << std::endl;
+            return 1;
+        }
+    return 0;
+}
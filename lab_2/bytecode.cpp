@@ -0,0 +1,1129 @@
+/*
+* Bytecode compiler and stack machine
+*/
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <cstring>
+
+#include "bytecode.hpp"
+
+/* What the operand of an instruction is */
+typedef enum
+{
+  operandNone,
+  operandValue,
+  operandDouble,
+  operandArray,
+  operandSlot,
+  operandTarget,
+  operandError
+} TOperandEnum;
+
+typedef struct
+{
+  const char* name;
+  TOperandEnum operand;
+  int stackEffect;      /* values pushed less values popped */
+} TOpcodeInfo;
+
+/* By TOpcodeEnum */
+static const TOpcodeInfo g_Opcodes[] =
+{
+  {"halt",                 operandNone,    0},
+  {"push_int",             operandValue,   1},
+  {"push_double",          operandDouble,  1},
+  {"push_array",           operandArray,   1},
+  {"load",                 operandSlot,    1},
+  {"store",                operandSlot,   -1},
+  {"pop",                  operandNone,   -1},
+  {"add_int",              operandNone,   -1},
+  {"subtract_int",         operandNone,   -1},
+  {"multiply_int",         operandNone,   -1},
+  {"divide_int",           operandNone,   -1},
+  {"negate_int",           operandNone,    0},
+  {"less_int",             operandNone,   -1},
+  {"greater_int",          operandNone,   -1},
+  {"less_equal_int",       operandNone,   -1},
+  {"greater_equal_int",    operandNone,   -1},
+  {"equal_int",            operandNone,   -1},
+  {"not_equal_int",        operandNone,   -1},
+  {"add_double",           operandNone,   -1},
+  {"subtract_double",      operandNone,   -1},
+  {"multiply_double",      operandNone,   -1},
+  {"divide_double",        operandNone,   -1},
+  {"negate_double",        operandNone,    0},
+  {"less_double",          operandNone,   -1},
+  {"greater_double",       operandNone,   -1},
+  {"less_equal_double",    operandNone,   -1},
+  {"greater_equal_double", operandNone,   -1},
+  {"equal_double",         operandNone,   -1},
+  {"not_equal_double",     operandNone,   -1},
+  {"int_to_double",        operandNone,    0},
+  {"double_to_int",        operandNone,    0},
+  {"int_to_char",          operandNone,    0},
+  {"int_to_bool",          operandNone,    0},
+  {"double_to_bool",       operandNone,    0},
+  {"jump",                 operandTarget,  0},
+  {"jump_if_false_int",    operandTarget, -1},
+  {"jump_if_false_double", operandTarget, -1},
+  {"input_int",            operandSlot,    0},
+  {"input_double",         operandSlot,    0},
+  {"input_char",           operandSlot,    0},
+  {"input_bool",           operandSlot,    0},
+  {"print_int",            operandNone,   -1},
+  {"print_double",         operandNone,   -1},
+  {"print_char",           operandNone,   -1},
+  {"print_bool",           operandNone,   -1},
+  {"error",                operandError,   0}
+};
+
+static_assert(sizeof(g_Opcodes) / sizeof(g_Opcodes[0]) == opcodeError + 1,
+              "every opcode is described");
+
+/* Instructions of TOperatorEnum operators, opNone where there is none */
+static const TOpcodeEnum g_IntOperators[] =
+{
+  opcodeHalt, opcodeAddInt, opcodeSubtractInt, opcodeMultiplyInt, opcodeDivideInt,
+  opcodeLessInt, opcodeGreaterInt, opcodeLessEqualInt, opcodeGreaterEqualInt,
+  opcodeEqualInt, opcodeNotEqualInt
+};
+
+static const TOpcodeEnum g_DoubleOperators[] =
+{
+  opcodeHalt, opcodeAddDouble, opcodeSubtractDouble, opcodeMultiplyDouble, opcodeDivideDouble,
+  opcodeLessDouble, opcodeGreaterDouble, opcodeLessEqualDouble, opcodeGreaterEqualDouble,
+  opcodeEqualDouble, opcodeNotEqualDouble
+};
+
+/* Labels of the loop being compiled */
+typedef struct
+{
+  std::vector<size_t> continues;  /* jumps to the test or the step */
+  std::vector<size_t> breaks;     /* jumps to the end of the loop */
+} TLoopLabels;
+
+typedef struct
+{
+  TBytecode* bytecode;
+  const TAst* tree;
+  std::vector<TLoopLabels> loops;
+  int depth;                      /* of the operand stack */
+} TCompiler;
+
+static bool IsArray(SubexpressionValueTypeEnum type)
+{
+  return type >= typeIntArray;
+}
+
+static bool IsComparison(TOperatorEnum op)
+{
+  return op >= opLess && op <= opNotEqual;
+}
+
+static size_t Emit(TCompiler& c, TOpcodeEnum opcode, int32_t operand = 0)
+{
+  TInstruction instruction;
+  instruction.opcode = opcode;
+  instruction.operand = operand;
+  try
+  {
+    c.bytecode->code.push_back(instruction);
+  }
+  catch (std::bad_alloc& ba)
+  {
+    perror("out of space");
+    exit(0);
+  }
+  c.depth += g_Opcodes[opcode].stackEffect;
+  if (c.depth > (int) c.bytecode->maxStack)
+    c.bytecode->maxStack = c.depth;
+  return c.bytecode->code.size() - 1;
+}
+
+/* Stop the program with a runtime error; stackEffect keeps the stack
+   depth of the code that follows as if the program went on */
+static void EmitError(TCompiler& c, const char* message, int stackEffect)
+{
+  c.bytecode->errors.push_back(message);
+  Emit(c, opcodeError, (int32_t) c.bytecode->errors.size() - 1);
+  c.depth += stackEffect;
+  if (c.depth > (int) c.bytecode->maxStack)
+    c.bytecode->maxStack = c.depth;
+}
+
+static int32_t Here(const TCompiler& c)
+{
+  return (int32_t) c.bytecode->code.size();
+}
+
+static void PatchJump(TCompiler& c, size_t jump, int32_t target)
+{
+  c.bytecode->code[jump].operand = target;
+}
+
+/* The value on top of the stack converted as an assignment converts it */
+static void CompileConversion(TCompiler& c, SubexpressionValueTypeEnum from, SubexpressionValueTypeEnum to)
+{
+  if (from == to)
+    return;
+  if (IsArray(from) || IsArray(to))
+  {
+    EmitError(c, "an array does not convert to another type", 0);
+    return;
+  }
+  switch (to)
+  {
+  case typeDouble:
+    Emit(c, opcodeIntToDouble);
+    break;
+  case typeChar:
+    if (typeDouble == from)
+      Emit(c, opcodeDoubleToInt);
+    Emit(c, opcodeIntToChar);
+    break;
+  case typeBool:
+    Emit(c, typeDouble == from ? opcodeDoubleToBool : opcodeIntToBool);
+    break;
+  default:
+    if (typeDouble == from)
+      Emit(c, opcodeDoubleToInt);
+    break;
+  }
+}
+
+static SubexpressionValueTypeEnum CompileExpression(TCompiler& c, TNodeIndex a);
+
+/* Operands of mixed types are computed as doubles, the result is
+   converted to the type of the operator node */
+static void CompileBinary(TCompiler& c, const TNode& node)
+{
+  SubexpressionValueTypeEnum leftType = NodeValueType(*c.tree, node.first);
+  SubexpressionValueTypeEnum rightType = NodeValueType(*c.tree, node.second);
+  bool arrays = IsArray(leftType) || IsArray(rightType);
+  bool doubles = !arrays && (typeDouble == leftType || typeDouble == rightType);
+
+  CompileExpression(c, node.first);
+  if (doubles && typeDouble != leftType)
+    Emit(c, opcodeIntToDouble);
+  CompileExpression(c, node.second);
+  if (doubles && typeDouble != rightType)
+    Emit(c, opcodeIntToDouble);
+  if (arrays)
+  {
+    EmitError(c, "arithmetic on an array", -1);
+    return;
+  }
+
+  TOperatorEnum op = (TOperatorEnum) node.op;
+  Emit(c, doubles ? g_DoubleOperators[op] : g_IntOperators[op]);
+  SubexpressionValueTypeEnum type = doubles && !IsComparison(op) ? typeDouble : typeInt;
+  CompileConversion(c, type, (SubexpressionValueTypeEnum) node.valueType);
+}
+
+static void CompileUnary(TCompiler& c, const TNode& node)
+{
+  SubexpressionValueTypeEnum type = CompileExpression(c, node.first);
+  if (IsArray(type))
+  {
+    EmitError(c, "arithmetic on an array", 0);
+    return;
+  }
+  if (opToDouble == node.op)
+  {
+    if (typeDouble != type)
+      Emit(c, opcodeIntToDouble);
+    type = typeDouble;
+  }
+  else if (typeDouble == type)
+    Emit(c, opcodeNegateDouble);
+  else
+  {
+    Emit(c, opcodeNegateInt);
+    type = typeInt;
+  }
+  CompileConversion(c, type, (SubexpressionValueTypeEnum) node.valueType);
+}
+
+/* Pushes the value of the expression, returns its type */
+static SubexpressionValueTypeEnum CompileExpression(TCompiler& c, TNodeIndex a)
+{
+  const TNode& node = c.tree->nodes[a];
+  switch (node.nodetype)
+  {
+  case typeConst:
+    switch (node.valueType)
+    {
+    case typeInt:
+      Emit(c, opcodePushInt, node.iNumber);
+      break;
+    case typeChar:
+      Emit(c, opcodePushInt, node.cNumber);
+      break;
+    case typeBool:
+      Emit(c, opcodePushInt, node.bNumber);
+      break;
+    case typeDouble:
+      c.bytecode->doubles.push_back(node.dNumber);
+      Emit(c, opcodePushDouble, (int32_t) c.bytecode->doubles.size() - 1);
+      break;
+    default:
+      c.bytecode->arrays.push_back(node.iArrayNumber);
+      Emit(c, opcodePushArray, (int32_t) c.bytecode->arrays.size() - 1);
+      break;
+    }
+    break;
+
+  case typeIdentifier:
+    if (NO_SYMBOL == node.first)
+      EmitError(c, "reference to an undeclared variable", 1);
+    else
+      Emit(c, opcodeLoad, node.first);
+    break;
+
+  case typeBinaryOp:
+    CompileBinary(c, node);
+    break;
+
+  case typeUnaryOp:
+    CompileUnary(c, node);
+    break;
+
+  default:
+    EmitError(c, "bad expression", 1);
+    break;
+  }
+  return (SubexpressionValueTypeEnum) node.valueType;
+}
+
+/* Evaluates the condition, returns the jump taken when it does not hold */
+static size_t CompileCondition(TCompiler& c, TNodeIndex a)
+{
+  SubexpressionValueTypeEnum type = CompileExpression(c, a);
+  if (IsArray(type))
+    EmitError(c, "an array is not a condition", 0);
+  return Emit(c, typeDouble == type ? opcodeJumpIfFalseDouble : opcodeJumpIfFalseInt);
+}
+
+static void CompileStatement(TCompiler& c, TNodeIndex a);
+
+/* A while or for loop tests its condition at the top, a do loop after
+   its body */
+static void CompileLoop(TCompiler& c, const TNode& node)
+{
+  try
+  {
+    c.loops.push_back(TLoopLabels());
+  }
+  catch (std::bad_alloc& ba)
+  {
+    perror("out of space");
+    exit(0);
+  }
+  int32_t top = Here(c);
+  size_t end = 0;
+  if (loopDo != node.op)
+    end = CompileCondition(c, node.first);
+  CompileStatement(c, node.second);
+  for (size_t jump : c.loops.back().continues)
+    PatchJump(c, jump, Here(c));
+  if (loopDo == node.op)
+  {
+    end = CompileCondition(c, node.first);
+  }
+  else
+    CompileStatement(c, node.third);
+  Emit(c, opcodeJump, top);
+  PatchJump(c, end, Here(c));
+  for (size_t jump : c.loops.back().breaks)
+    PatchJump(c, jump, Here(c));
+  c.loops.pop_back();
+}
+
+static void CompileInput(TCompiler& c, const TNode& node)
+{
+  const TNode& variable = c.tree->nodes[node.first];
+  if (typeIdentifier != variable.nodetype || NO_SYMBOL == variable.first)
+  {
+    EmitError(c, "input needs a variable", 0);
+    return;
+  }
+  switch (variable.valueType)
+  {
+  case typeInt:    Emit(c, opcodeInputInt, variable.first); break;
+  case typeDouble: Emit(c, opcodeInputDouble, variable.first); break;
+  case typeChar:   Emit(c, opcodeInputChar, variable.first); break;
+  case typeBool:   Emit(c, opcodeInputBool, variable.first); break;
+  default:         EmitError(c, "input of an array", 0); break;
+  }
+}
+
+static void CompileOutput(TCompiler& c, const TNode& node)
+{
+  switch (CompileExpression(c, node.first))
+  {
+  case typeInt:    Emit(c, opcodePrintInt); break;
+  case typeDouble: Emit(c, opcodePrintDouble); break;
+  case typeChar:   Emit(c, opcodePrintChar); break;
+  case typeBool:   Emit(c, opcodePrintBool); break;
+  default:         EmitError(c, "output of an array", -1); break;
+  }
+}
+
+static void CompileStatement(TCompiler& c, TNodeIndex a)
+{
+  if (NO_NODE == a)
+    return;
+  const TNode& node = c.tree->nodes[a];
+  switch (node.nodetype)
+  {
+  case typeList:
+    for (auto i = 0u; i < node.second; ++i)
+      CompileStatement(c, c.tree->children[node.first + i]);
+    break;
+
+  case typeAssignmentOp:
+  {
+    if (NO_SYMBOL == node.first)
+    {
+      EmitError(c, "assignment to an undeclared variable", 0);
+      break;
+    }
+    SubexpressionValueTypeEnum type = CompileExpression(c, node.second);
+    CompileConversion(c, type, SymbolRecord(c.tree->variables, node.first).valueType);
+    Emit(c, opcodeStore, node.first);
+    break;
+  }
+
+  case typeIfStatement:
+  {
+    size_t otherwise = CompileCondition(c, node.first);
+    CompileStatement(c, node.second);
+    if (NO_NODE == node.third)
+    {
+      PatchJump(c, otherwise, Here(c));
+      break;
+    }
+    size_t end = Emit(c, opcodeJump);
+    PatchJump(c, otherwise, Here(c));
+    CompileStatement(c, node.third);
+    PatchJump(c, end, Here(c));
+    break;
+  }
+
+  case typeWhileStatement:
+    CompileLoop(c, node);
+    break;
+
+  case typeJumpStatement:
+    /* outside loops break and continue end the program, as return does */
+    if (jumpReturn == node.op || c.loops.empty())
+      Emit(c, opcodeHalt);
+    else if (jumpContinue == node.op)
+      c.loops.back().continues.push_back(Emit(c, opcodeJump));
+    else
+      c.loops.back().breaks.push_back(Emit(c, opcodeJump));
+    break;
+
+  case typeInput:
+    CompileInput(c, node);
+    break;
+
+  case typeOutput:
+    CompileOutput(c, node);
+    break;
+
+  case typeFunctionStatment:
+    /* a definition, its body runs only when called */
+    break;
+
+  default:
+    CompileExpression(c, a);
+    Emit(c, opcodePop);
+    break;
+  }
+}
+
+/* The sequences of superinstructions.def, by opcode - FIRST_SUPERINSTRUCTION */
+typedef struct
+{
+  unsigned length;
+  uint8_t fused[SUPERINSTRUCTION_MAX];
+} TSuperinstruction;
+
+static const TSuperinstruction g_Superinstructions[] =
+{
+#define SUPERINSTRUCTION2(name, a, b) {2, {a, b}},
+#define SUPERINSTRUCTION3(name, a, b, c) {3, {a, b, c}},
+#define SUPERINSTRUCTION4(name, a, b, c, d) {4, {a, b, c, d}},
+#include "superinstructions.def"
+#undef SUPERINSTRUCTION2
+#undef SUPERINSTRUCTION3
+#undef SUPERINSTRUCTION4
+  {0, {0}}    /* keeps the table from being empty */
+};
+
+static_assert(opcodeCount - FIRST_SUPERINSTRUCTION <= SUPERINSTRUCTION_LIMIT,
+              "too many superinstructions");
+
+/* The first instruction of every enabled sequence becomes its
+   superinstruction; the others stay, so jumps into the sequence and the
+   operands the superinstruction reads are where they were. Sequences
+   are matched against the code as compiled, longest first. */
+static void FuseSuperinstructions(TBytecode& bytecode, uint32_t enabled)
+{
+  std::vector<TInstruction>& code = bytecode.code;
+  std::vector<uint8_t> compiled;
+  try
+  {
+    compiled.resize(code.size());
+  }
+  catch (std::bad_alloc& ba)
+  {
+    perror("out of space");
+    exit(0);
+  }
+  for (size_t i = 0; i < code.size(); ++i)
+    compiled[i] = code[i].opcode;
+
+  for (size_t i = 0; i < code.size(); ++i)
+  {
+    unsigned longest = 0;
+    for (unsigned k = 0; k < opcodeCount - FIRST_SUPERINSTRUCTION; ++k)
+    {
+      const TSuperinstruction& super = g_Superinstructions[k];
+      if (0 == (enabled & (1u << k)) || super.length <= longest || i + super.length > code.size())
+        continue;
+      unsigned j = 0;
+      while (j < super.length && compiled[i + j] == super.fused[j])
+        ++j;
+      if (j == super.length)
+      {
+        longest = super.length;
+        code[i].opcode = FIRST_SUPERINSTRUCTION + k;
+      }
+    }
+  }
+}
+
+void CompileBytecode(TBytecode& bytecode, const TAst& tree, TNodeIndex program, uint32_t superinstructions)
+{
+  bytecode.code.clear();
+  bytecode.doubles.clear();
+  bytecode.arrays.clear();
+  bytecode.errors.clear();
+  bytecode.slots = (NULL != tree.variables ? tree.variables->data.size() : 0) + 1;
+  bytecode.maxStack = 0;
+
+  TCompiler c;
+  c.bytecode = &bytecode;
+  c.tree = &tree;
+  c.depth = 0;
+  CompileStatement(c, program);
+  Emit(c, opcodeHalt);
+  if (0 != superinstructions)
+    FuseSuperinstructions(bytecode, superinstructions);
+}
+
+std::string OpcodeName(unsigned opcode)
+{
+  if (opcode < FIRST_SUPERINSTRUCTION)
+    return g_Opcodes[opcode].name;
+  const TSuperinstruction& super = g_Superinstructions[opcode - FIRST_SUPERINSTRUCTION];
+  std::string name;
+  for (unsigned j = 0; j < super.length; ++j)
+  {
+    if (j > 0)
+      name += "+";
+    name += g_Opcodes[super.fused[j]].name;
+  }
+  return name;
+}
+
+int OpcodeStackEffect(unsigned opcode)
+{
+  return g_Opcodes[opcode].stackEffect;
+}
+
+void PrintBytecode(const TBytecode& bytecode, std::ostream& out)
+{
+  for (size_t i = 0; i < bytecode.code.size(); ++i)
+  {
+    const TInstruction& instruction = bytecode.code[i];
+    out << i << "\t" << OpcodeName(instruction.opcode);
+    /* a superinstruction shows the operand of its first instruction, the
+       others are listed after it */
+    unsigned opcode = instruction.opcode;
+    if (opcode >= FIRST_SUPERINSTRUCTION)
+      opcode = g_Superinstructions[opcode - FIRST_SUPERINSTRUCTION].fused[0];
+    switch (g_Opcodes[opcode].operand)
+    {
+    case operandNone:
+      break;
+    case operandDouble:
+      out << " " << bytecode.doubles[instruction.operand];
+      break;
+    case operandError:
+      out << " \"" << bytecode.errors[instruction.operand] << "\"";
+      break;
+    case operandArray:
+      out << " " << bytecode.arrays[instruction.operand];
+      break;
+    default:
+      out << " " << instruction.operand;
+      break;
+    }
+    out << std::endl;
+  }
+}
+
+void InitStackMachine(TStackMachine& vm, const TBytecode& bytecode, std::istream& in, std::ostream& out)
+{
+  TValue zero;
+  memset(&zero, 0, sizeof(zero));
+  vm.bytecode = &bytecode;
+  try
+  {
+    vm.slots.assign(bytecode.slots, zero);
+    vm.stack.assign(bytecode.maxStack + 1, zero);
+  }
+  catch (std::bad_alloc& ba)
+  {
+    perror("out of space");
+    exit(0);
+  }
+  vm.in = &in;
+  vm.out = &out;
+  vm.failed = false;
+  vm.error.clear();
+  vm.dispatches = 0;
+}
+
+static bool Fail(TStackMachine& vm, unsigned long dispatches, const std::string& message)
+{
+  vm.dispatches = dispatches;
+  vm.failed = true;
+  vm.error = message;
+  return false;
+}
+
+void InitOpcodeProfile(TOpcodeProfile& profile)
+{
+  profile.sequences.clear();
+  profile.programs.clear();
+  profile.dispatches = 0;
+  profile.window = 0;
+  profile.length = 0;
+  profile.next = SIZE_MAX;
+}
+
+static void RecordDispatch(TOpcodeProfile& profile, const TInstruction* code, size_t i)
+{
+  if (i == profile.next && profile.length > 0)
+  {
+    profile.window = profile.window << 8 | code[i].opcode;
+    if (profile.length < SUPERINSTRUCTION_MAX)
+      ++profile.length;
+  }
+  else
+  {
+    profile.window = code[i].opcode;
+    profile.length = 1;
+  }
+  profile.next = i + 1;
+  ++profile.dispatches;
+  try
+  {
+    for (unsigned length = 2; length <= profile.length; ++length)
+    {
+      uint32_t opcodes = length < 4 ? profile.window & ((1u << 8 * length) - 1) : profile.window;
+      ++profile.sequences[(uint64_t) length << 32 | opcodes];
+    }
+  }
+  catch (std::bad_alloc& ba)
+  {
+    perror("out of space");
+    exit(0);
+  }
+}
+
+/* What each instruction does, given its operand. The top of the stack is
+   kept in tos, sp[-1] is the entry below it. Instructions that end the
+   program return from the machine. */
+#define OPERATION_opcodeHalt(operand) { vm.dispatches = dispatches; return true; }
+#define OPERATION_opcodePushInt(operand) { *sp++ = tos; tos.iNumber = (operand); }
+#define OPERATION_opcodePushDouble(operand) { *sp++ = tos; tos.dNumber = doubles[operand]; }
+#define OPERATION_opcodePushArray(operand) { *sp++ = tos; tos.array = arrays[operand]; }
+#define OPERATION_opcodeLoad(operand) { *sp++ = tos; tos = slots[operand]; }
+#define OPERATION_opcodeStore(operand) { slots[operand] = tos; tos = *--sp; }
+#define OPERATION_opcodePop(operand) { tos = *--sp; }
+
+/* ints wrap around */
+#define OPERATION_opcodeAddInt(operand) \
+  { --sp; tos.iNumber = (int) ((unsigned) sp->iNumber + (unsigned) tos.iNumber); }
+#define OPERATION_opcodeSubtractInt(operand) \
+  { --sp; tos.iNumber = (int) ((unsigned) sp->iNumber - (unsigned) tos.iNumber); }
+#define OPERATION_opcodeMultiplyInt(operand) \
+  { --sp; tos.iNumber = (int) ((unsigned) sp->iNumber * (unsigned) tos.iNumber); }
+#define OPERATION_opcodeDivideInt(operand) \
+  { \
+    --sp; \
+    if (0 == tos.iNumber) \
+      return Fail(vm, dispatches, "division by zero"); \
+    if (INT_MIN == sp->iNumber && -1 == tos.iNumber) \
+      tos.iNumber = INT_MIN; \
+    else \
+      tos.iNumber = sp->iNumber / tos.iNumber; \
+  }
+#define OPERATION_opcodeNegateInt(operand) { tos.iNumber = (int) (0u - (unsigned) tos.iNumber); }
+#define OPERATION_opcodeLessInt(operand) { --sp; tos.iNumber = sp->iNumber < tos.iNumber; }
+#define OPERATION_opcodeGreaterInt(operand) { --sp; tos.iNumber = sp->iNumber > tos.iNumber; }
+#define OPERATION_opcodeLessEqualInt(operand) { --sp; tos.iNumber = sp->iNumber <= tos.iNumber; }
+#define OPERATION_opcodeGreaterEqualInt(operand) { --sp; tos.iNumber = sp->iNumber >= tos.iNumber; }
+#define OPERATION_opcodeEqualInt(operand) { --sp; tos.iNumber = sp->iNumber == tos.iNumber; }
+#define OPERATION_opcodeNotEqualInt(operand) { --sp; tos.iNumber = sp->iNumber != tos.iNumber; }
+
+#define OPERATION_opcodeAddDouble(operand) { --sp; tos.dNumber = sp->dNumber + tos.dNumber; }
+#define OPERATION_opcodeSubtractDouble(operand) { --sp; tos.dNumber = sp->dNumber - tos.dNumber; }
+#define OPERATION_opcodeMultiplyDouble(operand) { --sp; tos.dNumber = sp->dNumber * tos.dNumber; }
+#define OPERATION_opcodeDivideDouble(operand) { --sp; tos.dNumber = sp->dNumber / tos.dNumber; }
+#define OPERATION_opcodeNegateDouble(operand) { tos.dNumber = -tos.dNumber; }
+#define OPERATION_opcodeLessDouble(operand) { --sp; tos.iNumber = sp->dNumber < tos.dNumber; }
+#define OPERATION_opcodeGreaterDouble(operand) { --sp; tos.iNumber = sp->dNumber > tos.dNumber; }
+#define OPERATION_opcodeLessEqualDouble(operand) { --sp; tos.iNumber = sp->dNumber <= tos.dNumber; }
+#define OPERATION_opcodeGreaterEqualDouble(operand) { --sp; tos.iNumber = sp->dNumber >= tos.dNumber; }
+#define OPERATION_opcodeEqualDouble(operand) { --sp; tos.iNumber = sp->dNumber == tos.dNumber; }
+#define OPERATION_opcodeNotEqualDouble(operand) { --sp; tos.iNumber = sp->dNumber != tos.dNumber; }
+
+#define OPERATION_opcodeIntToDouble(operand) { tos.dNumber = tos.iNumber; }
+#define OPERATION_opcodeDoubleToInt(operand) { tos.iNumber = DoubleToInt(tos.dNumber); }
+#define OPERATION_opcodeIntToChar(operand) { tos.iNumber = (char) tos.iNumber; }
+#define OPERATION_opcodeIntToBool(operand) { tos.iNumber = tos.iNumber != 0; }
+#define OPERATION_opcodeDoubleToBool(operand) { tos.iNumber = tos.dNumber != 0; }
+
+#define OPERATION_opcodeJump(operand) { pc = start + (operand); }
+#define OPERATION_opcodeJumpIfFalseInt(operand) \
+  { \
+    bool holds = 0 != tos.iNumber; \
+    tos = *--sp; \
+    if (!holds) \
+      pc = start + (operand); \
+  }
+#define OPERATION_opcodeJumpIfFalseDouble(operand) \
+  { \
+    bool holds = 0 != tos.dNumber; \
+    tos = *--sp; \
+    if (!holds) \
+      pc = start + (operand); \
+  }
+
+#define OPERATION_opcodeInputInt(operand) \
+  { \
+    if (!(in >> slots[operand].iNumber)) \
+      return Fail(vm, dispatches, "no value to input"); \
+  }
+#define OPERATION_opcodeInputDouble(operand) \
+  { \
+    if (!(in >> slots[operand].dNumber)) \
+      return Fail(vm, dispatches, "no value to input"); \
+  }
+#define OPERATION_opcodeInputChar(operand) \
+  { \
+    char c = 0; \
+    if (!(in >> c)) \
+      return Fail(vm, dispatches, "no value to input"); \
+    slots[operand].iNumber = c; \
+  }
+#define OPERATION_opcodeInputBool(operand) \
+  { \
+    int i = 0; \
+    if (!(in >> i)) \
+      return Fail(vm, dispatches, "no value to input"); \
+    slots[operand].iNumber = i != 0; \
+  }
+
+#define OPERATION_opcodePrintInt(operand) { out << tos.iNumber << std::endl; tos = *--sp; }
+#define OPERATION_opcodePrintDouble(operand) { out << tos.dNumber << std::endl; tos = *--sp; }
+#define OPERATION_opcodePrintChar(operand) { out << (char) tos.iNumber << std::endl; tos = *--sp; }
+#define OPERATION_opcodePrintBool(operand) { out << (tos.iNumber != 0) << std::endl; tos = *--sp; }
+
+#define OPERATION_opcodeError(operand) { return Fail(vm, dispatches, vm.bytecode->errors[operand]); }
+
+/* An instruction on its own */
+#define INSTRUCTION(opcode) \
+  HANDLER(opcode): \
+    OPERATION_##opcode(instruction.operand) \
+    DISPATCH();
+
+/* A superinstruction leaves pc after the last instruction it fuses
+   before running them, a jump among them then goes where it should */
+#define FUSED2(name, a, b) \
+  HANDLER(opcode##name): \
+    { \
+      const auto* fused = pc; \
+      pc += 1; \
+      OPERATION_##a(instruction.operand) \
+      OPERATION_##b(fused[0].operand) \
+    } \
+    DISPATCH();
+#define FUSED3(name, a, b, c) \
+  HANDLER(opcode##name): \
+    { \
+      const auto* fused = pc; \
+      pc += 2; \
+      OPERATION_##a(instruction.operand) \
+      OPERATION_##b(fused[0].operand) \
+      OPERATION_##c(fused[1].operand) \
+    } \
+    DISPATCH();
+#define FUSED4(name, a, b, c, d) \
+  HANDLER(opcode##name): \
+    { \
+      const auto* fused = pc; \
+      pc += 3; \
+      OPERATION_##a(instruction.operand) \
+      OPERATION_##b(fused[0].operand) \
+      OPERATION_##c(fused[1].operand) \
+      OPERATION_##d(fused[2].operand) \
+    } \
+    DISPATCH();
+
+#ifdef THREADED_DISPATCH
+/* Handlers are labels, each ends jumping to the handler of the next
+   instruction */
+#define HANDLER(opcode) handle_##opcode
+#define DISPATCH() \
+  do \
+  { \
+    if (Profiling) \
+      RecordDispatch(*profile, vm.bytecode->code.data(), pc - start); \
+    instruction = *pc++; \
+    ++dispatches; \
+    goto *instruction.handler; \
+  } while (0)
+
+typedef struct
+{
+  const void* handler;
+  int32_t operand;
+} TThreadedInstruction;
+
+/* GCC merges the identical ends of the handlers, which leaves them
+   sharing a few jumps to the next handler that predict it poorly */
+#if !defined __clang__
+#define DISPATCH_TAILS __attribute__((optimize("no-crossjumping")))
+#endif
+#else
+/* Handlers are the cases of a switch in a loop */
+#define HANDLER(opcode) case opcode
+#define DISPATCH() continue
+#endif
+#ifndef DISPATCH_TAILS
+#define DISPATCH_TAILS
+#endif
+
+template <bool Profiling>
+DISPATCH_TAILS static bool Execute(TStackMachine& vm, TOpcodeProfile* profile)
+{
+  const double* doubles = vm.bytecode->doubles.data();
+  void* const* arrays = vm.bytecode->arrays.data();
+  TValue* slots = vm.slots.data();
+  /* the top of the stack, and the free entry above the one below it;
+     stack[0] only takes what tos held before the first push */
+  TValue tos = vm.stack[0];
+  TValue* sp = vm.stack.data();
+  std::istream& in = *vm.in;
+  std::ostream& out = *vm.out;
+  unsigned long dispatches = 0;
+
+#ifdef THREADED_DISPATCH
+  /* by TOpcodeEnum */
+  static const void* const handlers[] =
+  {
+    &&HANDLER(opcodeHalt), &&HANDLER(opcodePushInt), &&HANDLER(opcodePushDouble),
+    &&HANDLER(opcodePushArray), &&HANDLER(opcodeLoad), &&HANDLER(opcodeStore),
+    &&HANDLER(opcodePop), &&HANDLER(opcodeAddInt), &&HANDLER(opcodeSubtractInt),
+    &&HANDLER(opcodeMultiplyInt), &&HANDLER(opcodeDivideInt), &&HANDLER(opcodeNegateInt),
+    &&HANDLER(opcodeLessInt), &&HANDLER(opcodeGreaterInt), &&HANDLER(opcodeLessEqualInt),
+    &&HANDLER(opcodeGreaterEqualInt), &&HANDLER(opcodeEqualInt), &&HANDLER(opcodeNotEqualInt),
+    &&HANDLER(opcodeAddDouble), &&HANDLER(opcodeSubtractDouble), &&HANDLER(opcodeMultiplyDouble),
+    &&HANDLER(opcodeDivideDouble), &&HANDLER(opcodeNegateDouble), &&HANDLER(opcodeLessDouble),
+    &&HANDLER(opcodeGreaterDouble), &&HANDLER(opcodeLessEqualDouble),
+    &&HANDLER(opcodeGreaterEqualDouble), &&HANDLER(opcodeEqualDouble),
+    &&HANDLER(opcodeNotEqualDouble), &&HANDLER(opcodeIntToDouble), &&HANDLER(opcodeDoubleToInt),
+    &&HANDLER(opcodeIntToChar), &&HANDLER(opcodeIntToBool), &&HANDLER(opcodeDoubleToBool),
+    &&HANDLER(opcodeJump), &&HANDLER(opcodeJumpIfFalseInt), &&HANDLER(opcodeJumpIfFalseDouble),
+    &&HANDLER(opcodeInputInt), &&HANDLER(opcodeInputDouble), &&HANDLER(opcodeInputChar),
+    &&HANDLER(opcodeInputBool), &&HANDLER(opcodePrintInt), &&HANDLER(opcodePrintDouble),
+    &&HANDLER(opcodePrintChar), &&HANDLER(opcodePrintBool), &&HANDLER(opcodeError),
+#define SUPERINSTRUCTION2(name, a, b) &&HANDLER(opcode##name),
+#define SUPERINSTRUCTION3(name, a, b, c) &&HANDLER(opcode##name),
+#define SUPERINSTRUCTION4(name, a, b, c, d) &&HANDLER(opcode##name),
+#include "superinstructions.def"
+#undef SUPERINSTRUCTION2
+#undef SUPERINSTRUCTION3
+#undef SUPERINSTRUCTION4
+  };
+  static_assert(sizeof(handlers) / sizeof(handlers[0]) == opcodeCount,
+                "every opcode has a handler");
+
+  /* direct-threaded copy of the code: each instruction holds the address
+     of its handler, which jumps straight to the next one */
+  std::vector<TThreadedInstruction> threaded;
+  try
+  {
+    threaded.resize(vm.bytecode->code.size());
+  }
+  catch (std::bad_alloc& ba)
+  {
+    perror("out of space");
+    exit(0);
+  }
+  for (size_t i = 0; i < threaded.size(); ++i)
+  {
+    threaded[i].handler = handlers[vm.bytecode->code[i].opcode];
+    threaded[i].operand = vm.bytecode->code[i].operand;
+  }
+  const TThreadedInstruction* start = threaded.data();
+  const TThreadedInstruction* pc = start;
+  TThreadedInstruction instruction;
+  DISPATCH();
+  {
+#else
+  const TInstruction* start = vm.bytecode->code.data();
+  const TInstruction* pc = start;
+  for (;;)
+  {
+    if (Profiling)
+      RecordDispatch(*profile, start, pc - start);
+    /* a copy: the stores to the stack could alias the code */
+    TInstruction instruction = *pc++;
+    ++dispatches;
+    switch (instruction.opcode)
+    {
+#endif
+    INSTRUCTION(opcodeHalt)
+    INSTRUCTION(opcodePushInt)
+    INSTRUCTION(opcodePushDouble)
+    INSTRUCTION(opcodePushArray)
+    INSTRUCTION(opcodeLoad)
+    INSTRUCTION(opcodeStore)
+    INSTRUCTION(opcodePop)
+    INSTRUCTION(opcodeAddInt)
+    INSTRUCTION(opcodeSubtractInt)
+    INSTRUCTION(opcodeMultiplyInt)
+    INSTRUCTION(opcodeDivideInt)
+    INSTRUCTION(opcodeNegateInt)
+    INSTRUCTION(opcodeLessInt)
+    INSTRUCTION(opcodeGreaterInt)
+    INSTRUCTION(opcodeLessEqualInt)
+    INSTRUCTION(opcodeGreaterEqualInt)
+    INSTRUCTION(opcodeEqualInt)
+    INSTRUCTION(opcodeNotEqualInt)
+    INSTRUCTION(opcodeAddDouble)
+    INSTRUCTION(opcodeSubtractDouble)
+    INSTRUCTION(opcodeMultiplyDouble)
+    INSTRUCTION(opcodeDivideDouble)
+    INSTRUCTION(opcodeNegateDouble)
+    INSTRUCTION(opcodeLessDouble)
+    INSTRUCTION(opcodeGreaterDouble)
+    INSTRUCTION(opcodeLessEqualDouble)
+    INSTRUCTION(opcodeGreaterEqualDouble)
+    INSTRUCTION(opcodeEqualDouble)
+    INSTRUCTION(opcodeNotEqualDouble)
+    INSTRUCTION(opcodeIntToDouble)
+    INSTRUCTION(opcodeDoubleToInt)
+    INSTRUCTION(opcodeIntToChar)
+    INSTRUCTION(opcodeIntToBool)
+    INSTRUCTION(opcodeDoubleToBool)
+    INSTRUCTION(opcodeJump)
+    INSTRUCTION(opcodeJumpIfFalseInt)
+    INSTRUCTION(opcodeJumpIfFalseDouble)
+    INSTRUCTION(opcodeInputInt)
+    INSTRUCTION(opcodeInputDouble)
+    INSTRUCTION(opcodeInputChar)
+    INSTRUCTION(opcodeInputBool)
+    INSTRUCTION(opcodePrintInt)
+    INSTRUCTION(opcodePrintDouble)
+    INSTRUCTION(opcodePrintChar)
+    INSTRUCTION(opcodePrintBool)
+#define SUPERINSTRUCTION2 FUSED2
+#define SUPERINSTRUCTION3 FUSED3
+#define SUPERINSTRUCTION4 FUSED4
+#include "superinstructions.def"
+#undef SUPERINSTRUCTION2
+#undef SUPERINSTRUCTION3
+#undef SUPERINSTRUCTION4
+#ifndef THREADED_DISPATCH
+    default:
+#endif
+    INSTRUCTION(opcodeError)
+#ifndef THREADED_DISPATCH
+    }
+#endif
+  }
+}
+
+#undef HANDLER
+#undef DISPATCH
+#undef INSTRUCTION
+#undef FUSED2
+#undef FUSED3
+#undef FUSED4
+
+bool RunBytecode(TStackMachine& vm)
+{
+  return Execute<false>(vm, NULL);
+}
+
+/* Whether a sequence can be fused: a jump only ends one, and nothing
+   fuses what ends the program */
+static bool IsFusible(uint32_t opcodes, unsigned length)
+{
+  for (unsigned j = 0; j < length; ++j)
+  {
+    unsigned opcode = opcodes >> 8 * (length - 1 - j) & 0xff;
+    if (opcodeHalt == opcode || opcodeError == opcode)
+      return false;
+    bool jump = opcodeJump == opcode || opcodeJumpIfFalseInt == opcode || opcodeJumpIfFalseDouble == opcode;
+    if (jump && j + 1 < length)
+      return false;
+  }
+  return true;
+}
+
+static bool IsBetterScore(const TSequenceScore& a, const TSequenceScore& b)
+{
+  return a.share != b.share ? a.share > b.share :
+         a.length != b.length ? a.length > b.length : a.opcodes < b.opcodes;
+}
+
+bool ProfileBytecode(TStackMachine& vm, TOpcodeProfile& profile)
+{
+  /* a new program, the runs of the last one do not go on */
+  profile.sequences.clear();
+  profile.dispatches = 0;
+  profile.length = 0;
+  profile.next = SIZE_MAX;
+  bool done = Execute<true>(vm, &profile);
+  try
+  {
+    std::vector<TSequenceScore> ranked;
+    for (const auto& sequence : profile.sequences)
+    {
+      TSequenceScore score;
+      score.length = (unsigned) (sequence.first >> 32);
+      score.opcodes = (uint32_t) sequence.first;
+      score.share = (double) sequence.second * (score.length - 1) / profile.dispatches;
+      /* worth a handler when it saves at least one dispatch in a hundred */
+      if (IsFusible(score.opcodes, score.length) && score.share >= 0.01)
+        ranked.push_back(score);
+    }
+    std::sort(ranked.begin(), ranked.end(), IsBetterScore);
+    profile.programs.push_back(ranked);
+  }
+  catch (std::bad_alloc& ba)
+  {
+    perror("out of space");
+    exit(0);
+  }
+  return done;
+}
+
+/* InputInt from input_int */
+static std::string CamelCase(const char* name)
+{
+  std::string camel;
+  bool upper = true;
+  for (const char* p = name; *p; ++p)
+  {
+    if ('_' == *p)
+      upper = true;
+    else
+    {
+      camel += upper ? (char) toupper(*p) : *p;
+      upper = false;
+    }
+  }
+  return camel;
+}
+
+/* The SUPERINSTRUCTIONn line of a sequence, without its comment */
+static void WriteSuperinstruction(const uint8_t* fused, unsigned length, std::ostream& out)
+{
+  std::string name = "Fused";
+  std::string operands;
+  for (unsigned j = 0; j < length; ++j)
+  {
+    const char* opcode = g_Opcodes[fused[j]].name;
+    name += CamelCase(opcode);
+    operands += ", opcode" + CamelCase(opcode);
+  }
+  out << "SUPERINSTRUCTION" << length << "(" << name << operands << ")";
+}
+
+void WriteSuperinstructions(const TOpcodeProfile& profile, std::ostream& out)
+{
+  std::vector<TSequenceScore> candidates;
+  bool more = true;
+  for (size_t rank = 0; more && candidates.size() < SUPERINSTRUCTION_LIMIT; ++rank)
+  {
+    more = false;
+    for (const auto& program : profile.programs)
+    {
+      if (rank >= program.size() || candidates.size() == SUPERINSTRUCTION_LIMIT)
+        continue;
+      more = true;
+      const TSequenceScore& score = program[rank];
+      bool known = false;
+      for (TSequenceScore& candidate : candidates)
+      {
+        if (candidate.opcodes == score.opcodes && candidate.length == score.length)
+        {
+          known = true;
+          if (score.share > candidate.share)
+            candidate.share = score.share;
+        }
+      }
+      if (!known)
+        candidates.push_back(score);
+    }
+  }
+
+  out << "/* Candidate superinstructions of the stack machine, generated by make\n"
+      << "   superinstructions from the sequences the corpus programs ran most\n"
+      << "   often, to be timed by simpl-bench -superinstructions; the comments\n"
+      << "   give the most of the dispatches of one program each would save\n"
+      << "   there on its own. */" << std::endl;
+  for (const TSequenceScore& score : candidates)
+  {
+    uint8_t fused[SUPERINSTRUCTION_MAX];
+    for (unsigned j = 0; j < score.length; ++j)
+      fused[j] = score.opcodes >> 8 * (score.length - 1 - j) & 0xff;
+    WriteSuperinstruction(fused, score.length, out);
+    char share[32];
+    snprintf(share, sizeof share, "%.1f%%", score.share * 100);
+    out << " /* " << share << " */" << std::endl;
+  }
+}
+
+void WriteTimedSuperinstructions(const std::vector<double>& speedups, std::ostream& out)
+{
+  out << "/* Superinstructions of the stack machine, generated by make\n"
+      << "   superinstructions: of the sequences the corpus programs ran most\n"
+      << "   often, those that made the program using them most at least\n"
+      << "   " << SUPERINSTRUCTION_MIN_SPEEDUP << "x as fast when fused alone. The comments give that\n"
+      << "   speedup over the stack machine without superinstructions. */" << std::endl;
+  for (unsigned k = 0; k < opcodeCount - FIRST_SUPERINSTRUCTION && k < speedups.size(); ++k)
+  {
+    if (speedups[k] < SUPERINSTRUCTION_MIN_SPEEDUP)
+      continue;
+    const TSuperinstruction& super = g_Superinstructions[k];
+    char ratio[32];
+    snprintf(ratio, sizeof ratio, "%.2fx", speedups[k]);
+    WriteSuperinstruction(super.fused, super.length, out);
+    out << " /* " << ratio << " */" << std::endl;
+  }
+}
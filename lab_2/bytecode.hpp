@@ -0,0 +1,184 @@
+/* Bytecode of Simpl programs and the stack machine that runs it */
+
+#ifndef _BYTECODE_HPP
+#define _BYTECODE_HPP
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ast.hpp"
+#include "interpreter.hpp"
+
+/* Instructions work on the operand stack; int, char and bool values are
+   ints there. The operand of an instruction is given after its name. */
+typedef enum
+{
+    opcodeHalt,               /* end of the program */
+    opcodePushInt,            /* value */
+    opcodePushDouble,         /* index in doubles */
+    opcodePushArray,          /* index in arrays */
+    opcodeLoad,               /* slot */
+    opcodeStore,              /* slot, pops the value */
+    opcodePop,
+    opcodeAddInt,
+    opcodeSubtractInt,
+    opcodeMultiplyInt,
+    opcodeDivideInt,
+    opcodeNegateInt,
+    opcodeLessInt,            /* comparisons push int 1 or 0 */
+    opcodeGreaterInt,
+    opcodeLessEqualInt,
+    opcodeGreaterEqualInt,
+    opcodeEqualInt,
+    opcodeNotEqualInt,
+    opcodeAddDouble,
+    opcodeSubtractDouble,
+    opcodeMultiplyDouble,
+    opcodeDivideDouble,
+    opcodeNegateDouble,
+    opcodeLessDouble,
+    opcodeGreaterDouble,
+    opcodeLessEqualDouble,
+    opcodeGreaterEqualDouble,
+    opcodeEqualDouble,
+    opcodeNotEqualDouble,
+    opcodeIntToDouble,
+    opcodeDoubleToInt,        /* truncated, saturated */
+    opcodeIntToChar,
+    opcodeIntToBool,
+    opcodeDoubleToBool,
+    opcodeJump,               /* target */
+    opcodeJumpIfFalseInt,     /* target, pops the condition */
+    opcodeJumpIfFalseDouble,  /* target, pops the condition */
+    opcodeInputInt,           /* slot */
+    opcodeInputDouble,        /* slot */
+    opcodeInputChar,          /* slot */
+    opcodeInputBool,          /* slot */
+    opcodePrintInt,           /* pops the value */
+    opcodePrintDouble,
+    opcodePrintChar,
+    opcodePrintBool,
+    opcodeError,              /* index in errors, stops the program */
+    /* Superinstructions, see superinstructions.def: one dispatch runs
+       the instruction and the ones after it, reading their operands
+       where they are */
+#define SUPERINSTRUCTION2(name, a, b) opcode##name,
+#define SUPERINSTRUCTION3(name, a, b, c) opcode##name,
+#define SUPERINSTRUCTION4(name, a, b, c, d) opcode##name,
+#include "superinstructions.def"
+#undef SUPERINSTRUCTION2
+#undef SUPERINSTRUCTION3
+#undef SUPERINSTRUCTION4
+    opcodeCount
+} TOpcodeEnum;
+
+/* Longest sequence a superinstruction fuses, and how many there can be */
+#define SUPERINSTRUCTION_MAX 4
+#define SUPERINSTRUCTION_LIMIT 16
+
+/* A superinstruction stays when it makes the program that uses it most
+   at least this much faster than the code it fuses, above timing noise */
+#define SUPERINSTRUCTION_MIN_SPEEDUP 1.02
+
+#define FIRST_SUPERINSTRUCTION (opcodeError + 1)
+#define ALL_SUPERINSTRUCTIONS 0xffffffffu
+
+typedef struct
+{
+  uint8_t opcode;     /* TOpcodeEnum */
+  int32_t operand;    /* jump targets are instruction indices */
+} TInstruction;
+
+/* A compiled program */
+typedef struct
+{
+  std::vector<TInstruction> code;
+  std::vector<double> doubles;        /* double constants */
+  std::vector<void*> arrays;          /* array constants, owned by the tree */
+  std::vector<std::string> errors;    /* messages of the error instructions */
+  unsigned slots;                     /* variables, by symbol; slot 0 is unused */
+  unsigned maxStack;                  /* deepest the operand stack gets */
+} TBytecode;
+
+/* Compile the program of the tree from its root. Runtime errors that
+   can be seen from the types, such as arithmetic on an array, become
+   error instructions where the tree-walker would stop, so both engines
+   print the same. Bit k of superinstructions lets the k-th one of
+   superinstructions.def replace the sequences it fuses. */
+void CompileBytecode(TBytecode& bytecode, const TAst& tree, TNodeIndex program,
+                     uint32_t superinstructions = ALL_SUPERINSTRUCTIONS);
+
+/* Name of an opcode; a superinstruction joins those it fuses with + */
+std::string OpcodeName(unsigned opcode);
+
+/* Values an instruction pushes less those it pops, superinstructions
+   excluded */
+int OpcodeStackEffect(unsigned opcode);
+
+/* Listing of the instructions */
+void PrintBytecode(const TBytecode& bytecode, std::ostream& out);
+
+/* State of a program running on the stack machine */
+typedef struct
+{
+  const TBytecode* bytecode;
+  std::vector<TValue> slots;
+  std::vector<TValue> stack;
+  std::istream* in;
+  std::ostream* out;
+  bool failed;
+  std::string error;
+  unsigned long dispatches;     /* instructions executed */
+} TStackMachine;
+
+void InitStackMachine(TStackMachine& vm, const TBytecode& bytecode, std::istream& in, std::ostream& out);
+
+/* Run the program to its end; false on a runtime error, which is
+   described in vm.error */
+bool RunBytecode(TStackMachine& vm);
+
+/* A sequence of instructions, the first one in the highest byte used */
+typedef struct
+{
+  uint32_t opcodes;
+  unsigned length;
+  double share;           /* of the dispatches of a program it would save */
+} TSequenceScore;
+
+/* How often sequences of 2 to SUPERINSTRUCTION_MAX instructions ran one
+   right after the other, with no jump taken in between */
+typedef struct
+{
+  /* by length << 32 | the opcodes a byte each, the last one lowest; runs
+     in the program last profiled */
+  std::unordered_map<uint64_t, unsigned long> sequences;
+  /* for each program profiled, the sequences worth fusing in it, largest
+     share first: a short program counts as much as a long one */
+  std::vector<std::vector<TSequenceScore>> programs;
+  unsigned long dispatches;     /* of the program last profiled */
+  uint32_t window;        /* opcodes of the run ending at the last instruction */
+  unsigned length;        /* of that run, up to SUPERINSTRUCTION_MAX */
+  size_t next;            /* index of the instruction that continues it */
+} TOpcodeProfile;
+
+void InitOpcodeProfile(TOpcodeProfile& profile);
+
+/* RunBytecode, counting the sequences executed in the profile and
+   ranking them for the program. The code should be compiled without
+   superinstructions. */
+bool ProfileBytecode(TStackMachine& vm, TOpcodeProfile& profile);
+
+/* Write superinstructions.def for the sequences that save the most in
+   the programs of the profile, taking the best of each program in turn:
+   the candidates, which simpl-bench -superinstructions then times */
+void WriteSuperinstructions(const TOpcodeProfile& profile, std::ostream& out);
+
+/* Write superinstructions.def again with the superinstructions of this
+   build that are at least SUPERINSTRUCTION_MIN_SPEEDUP times as fast as
+   the code they fuse; speedups holds the ratio measured for each, by
+   opcode - FIRST_SUPERINSTRUCTION */
+void WriteTimedSuperinstructions(const std::vector<double>& speedups, std::ostream& out);
+
+#endif
@@ -0,0 +1,192 @@
+/*
+* Numeric literals: locale-independent conversion with range checks and
+* a per-compilation pool of shared constant nodes
+*/
+#include <cerrno>
+#include <climits>
+#include <clocale>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined __APPLE__
+#include <xlocale.h>
+#endif
+
+#include "constants.hpp"
+
+/* Hash of a constant's type and bit pattern (a 64-bit mix) */
+static unsigned HashConstant(SubexpressionValueTypeEnum type, uint64_t bits)
+{
+  uint64_t hash = (bits ^ ((uint64_t) type << 56)) * 0x9e3779b97f4a7c15ull;
+  return (unsigned) (hash >> 32);
+}
+
+static uint64_t ConstantBits(const TNode& node)
+{
+  uint64_t bits = 0;
+  if (node.valueType == typeDouble)
+    memcpy(&bits, &node.dNumber, sizeof(double));
+  else
+    bits = (uint32_t) node.iNumber;
+  return bits;
+}
+
+/* Rebuild the slots twice as large, keeping the load factor under 1/2 */
+static void GrowConstantPool(TConstantPool& pool, const TAst& tree)
+{
+  size_t size = pool.slots.empty() ? 256 : pool.slots.size() * 2;
+  pool.slots.assign(size, 0);
+  size_t mask = size - 1;
+  for (auto i = 0u; i < pool.constants.size(); ++i)
+  {
+    const TNode& node = tree.nodes[pool.constants[i]];
+    size_t slot = HashConstant((SubexpressionValueTypeEnum) node.valueType, ConstantBits(node)) & mask;
+    while (pool.slots[slot] != 0)
+      slot = (slot + 1) & mask;
+    pool.slots[slot] = i + 1;
+  }
+}
+
+static TNodeIndex InternConstant(TConstantPool& pool, TAst& tree, const TNode& constant)
+{
+  if (2 * (pool.constants.size() + 1) > pool.slots.size())
+    GrowConstantPool(pool, tree);
+
+  uint64_t bits = ConstantBits(constant);
+  size_t mask = pool.slots.size() - 1;
+  size_t slot = HashConstant((SubexpressionValueTypeEnum) constant.valueType, bits) & mask;
+  while (pool.slots[slot] != 0)
+  {
+    TNodeIndex candidate = pool.constants[pool.slots[slot] - 1];
+    if (tree.nodes[candidate].valueType == constant.valueType && ConstantBits(tree.nodes[candidate]) == bits)
+      return candidate;
+    slot = (slot + 1) & mask;
+  }
+
+  TNodeIndex a = constant.valueType == typeDouble ? CreateNumberNode(tree, constant.dNumber)
+                                                  : CreateNumberNode(tree, constant.iNumber);
+  tree.nodes[a].first = (TNodeIndex) pool.constants.size();
+  pool.constants.push_back(a);
+  pool.slots[slot] = pool.constants.size();
+  return a;
+}
+
+TNodeIndex InternConstant(TConstantPool& pool, TAst& tree, int value)
+{
+  TNode constant;
+  constant.valueType = typeInt;
+  constant.iNumber = value;
+  return InternConstant(pool, tree, constant);
+}
+
+TNodeIndex InternConstant(TConstantPool& pool, TAst& tree, double value)
+{
+  TNode constant;
+  constant.valueType = typeDouble;
+  constant.dNumber = value;
+  return InternConstant(pool, tree, constant);
+}
+
+void ClearConstantPool(TConstantPool& pool)
+{
+  pool.constants.clear();
+  /* a streamed compilation clears the pool after every statement, a
+     small table is emptied in place rather than reallocated */
+  if (pool.slots.size() > 256)
+    pool.slots.clear();
+  else if (!pool.slots.empty())
+    memset(pool.slots.data(), 0, pool.slots.size() * sizeof(unsigned));
+}
+
+bool ConvertIntegerLiteral(const char* text, size_t length, int& value)
+{
+  uint64_t result = 0;
+  for (size_t i = 0; i < length; ++i)
+  {
+    result = result * 10 + (text[i] - '0');
+    if (result > INT_MAX)
+    {
+      value = INT_MAX;
+      return false;
+    }
+  }
+  value = (int) result;
+  return true;
+}
+
+/* strtod() of the C locale, for literals the fast path cannot convert exactly */
+static bool ConvertFloatLiteralSlow(const char* text, size_t length, double& value)
+{
+  std::string literal(text, length);
+  errno = 0;
+#if defined _WIN32 || defined _WIN64
+  static _locale_t cLocale = _create_locale(LC_NUMERIC, "C");
+  value = _strtod_l(literal.c_str(), NULL, cLocale);
+#else
+  static locale_t cLocale = newlocale(LC_NUMERIC_MASK, "C", (locale_t) 0);
+  value = strtod_l(literal.c_str(), NULL, cLocale);
+#endif
+  /* denormals are representable, only infinity and a lost value are errors */
+  return !(errno == ERANGE && (std::isinf(value) || value == 0.0));
+}
+
+bool ConvertFloatLiteral(const char* text, size_t length, double& value)
+{
+  /* Digits of the form [0-9]*\.?[0-9]*([Ee][-+]?[0-9]+)? */
+  static const double powersOf10[] =
+  {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool isFraction = false;
+  size_t i = 0;
+  for (; i < length && text[i] != 'e' && text[i] != 'E'; ++i)
+  {
+    if (text[i] == '.')
+    {
+      isFraction = true;
+      continue;
+    }
+    if (mantissa == 0 && text[i] == '0')
+    {
+      exponent -= isFraction;
+      continue;
+    }
+    if (digits == 19)
+      return ConvertFloatLiteralSlow(text, length, value);
+    mantissa = mantissa * 10 + (text[i] - '0');
+    ++digits;
+    exponent -= isFraction;
+  }
+
+  if (i < length)
+  {
+    bool isNegative = text[++i] == '-';
+    if (text[i] == '-' || text[i] == '+')
+      ++i;
+    int written = 0;
+    for (; i < length && written < 100000; ++i)
+      written = written * 10 + (text[i] - '0');
+    exponent += isNegative ? -written : written;
+  }
+
+  if (mantissa == 0)
+  {
+    value = 0.0;
+    return true;
+  }
+  /* Both the mantissa and the power of ten are exact doubles, so one
+     multiplication or division rounds correctly (Clinger's fast path) */
+  if (mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+  {
+    value = exponent >= 0 ? (double) mantissa * powersOf10[exponent]
+                          : (double) mantissa / powersOf10[-exponent];
+    return true;
+  }
+  return ConvertFloatLiteralSlow(text, length, value);
+}
@@ -0,0 +1,31 @@
+/* Numeric literals: conversion and the constant pool */
+
+#ifndef _CONSTANTS_HPP
+#define _CONSTANTS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ast.hpp"
+
+/* One shared typeConst node per distinct literal of a compilation.
+   A node's first field is its position in the pool, so later stages can
+   refer to constants by index. The nodes live in the tree, the pool is
+   cleared with it. */
+typedef struct
+{
+  std::vector<TNodeIndex> constants;  /* nodes, by pool index */
+  std::vector<unsigned> slots;        /* open addressing: index + 1, 0 is a free slot */
+} TConstantPool;
+
+TNodeIndex InternConstant(TConstantPool& pool, TAst& tree, int value);
+TNodeIndex InternConstant(TConstantPool& pool, TAst& tree, double value);
+void ClearConstantPool(TConstantPool& pool);
+
+/* Locale-independent conversion of the text of an INTCONST or a NUMBER.
+   False when the value is out of range: integers are then clamped to
+   INT_MAX, doubles become infinity or zero. */
+bool ConvertIntegerLiteral(const char* text, size_t length, int& value);
+bool ConvertFloatLiteral(const char* text, size_t length, double& value);
+
+#endif
@@ -0,0 +1,263 @@
+/*
+* Constant folding of AST expressions
+*/
+#include <climits>
+
+#include "fold.hpp"
+
+/* Value of a literal */
+typedef struct
+{
+  SubexpressionValueTypeEnum type;   /* typeInt or typeDouble */
+  int iNumber;
+  double dNumber;
+} TFoldedValue;
+
+static bool LiteralValue(const TAst& tree, TNodeIndex a, TFoldedValue& value)
+{
+  if (NO_NODE == a || typeConst != tree.nodes[a].nodetype)
+    return false;
+  const TNode& node = tree.nodes[a];
+  value.type = (SubexpressionValueTypeEnum) node.valueType;
+  if (typeInt == node.valueType)
+    value.iNumber = node.iNumber;
+  else if (typeDouble == node.valueType)
+    value.dNumber = node.dNumber;
+  else
+    return false;
+  return true;
+}
+
+/* Relational operators give int 1 or 0 */
+template <typename T>
+static bool CompareValues(TOperatorEnum op, T left, T right, bool& result)
+{
+  switch (op)
+  {
+  case opLess:         result = left < right;  return true;
+  case opGreater:      result = left > right;  return true;
+  case opLessEqual:    result = left <= right; return true;
+  case opGreaterEqual: result = left >= right; return true;
+  case opEqual:        result = left == right; return true;
+  case opNotEqual:     result = left != right; return true;
+  default:             return false;
+  }
+}
+
+static bool FoldUnary(TOperatorEnum op, const TFoldedValue& operand, TFoldedValue& result)
+{
+  result = operand;
+  switch (op)
+  {
+  case opNegate:
+    /* ints wrap around as they do at run time */
+    if (typeInt == operand.type)
+      result.iNumber = (int) (0u - (unsigned) operand.iNumber);
+    else
+      result.dNumber = -operand.dNumber;
+    return true;
+  case opToDouble:
+    if (typeInt != operand.type)
+      return false;
+    result.type = typeDouble;
+    result.dNumber = operand.iNumber;
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool FoldBinary(TOperatorEnum op, const TFoldedValue& left, const TFoldedValue& right,
+                       TFoldedValue& result)
+{
+  if (left.type != right.type)
+    return false;
+  result.type = left.type;
+  bool comparison;
+  if (typeInt == left.type)
+  {
+    unsigned l = (unsigned) left.iNumber, r = (unsigned) right.iNumber;
+    switch (op)
+    {
+    case opAdd:      result.iNumber = (int) (l + r); return true;
+    case opSubtract: result.iNumber = (int) (l - r); return true;
+    case opMultiply: result.iNumber = (int) (l * r); return true;
+    case opDivide:
+      if (0 == right.iNumber || (INT_MIN == left.iNumber && -1 == right.iNumber))
+        return false;
+      result.iNumber = left.iNumber / right.iNumber;
+      return true;
+    default:
+      if (!CompareValues(op, left.iNumber, right.iNumber, comparison))
+        return false;
+      result.iNumber = comparison;
+      return true;
+    }
+  }
+
+  switch (op)
+  {
+  case opAdd:      result.dNumber = left.dNumber + right.dNumber; return true;
+  case opSubtract: result.dNumber = left.dNumber - right.dNumber; return true;
+  case opMultiply: result.dNumber = left.dNumber * right.dNumber; return true;
+  case opDivide:
+    if (0 == right.dNumber)
+      return false;
+    result.dNumber = left.dNumber / right.dNumber;
+    return true;
+  default:
+    if (!CompareValues(op, left.dNumber, right.dNumber, comparison))
+      return false;
+    result.type = typeInt;
+    result.iNumber = comparison;
+    return true;
+  }
+}
+
+/* Free a folded node if it is the newest one, else count it as left
+   unreachable; pooled constants are shared and stay */
+static void FreeFoldedNode(TAst& tree, TNodeIndex a, TFoldCount& count)
+{
+  const TNode& node = tree.nodes[a];
+  if (typeConst == node.nodetype && NOT_POOLED != node.first)
+    return;
+  if (a + 1 == tree.nodes.size())
+  {
+    tree.nodes.pop_back();
+    ++count.removed;
+  }
+  else
+    ++count.unreachable;
+}
+
+/* The int to double conversion the parser inserts for mixed operands */
+static bool IsConversion(const TAst& tree, TNodeIndex a)
+{
+  return NO_NODE != a && typeUnaryOp == tree.nodes[a].nodetype && opToDouble == tree.nodes[a].op;
+}
+
+/* Value of an operand that is a literal or a conversion of one */
+static bool OperandValue(const TAst& tree, TNodeIndex a, TFoldedValue& value)
+{
+  TFoldedValue operand;
+  if (IsConversion(tree, a))
+    return LiteralValue(tree, tree.nodes[a].first, operand) && FoldUnary(opToDouble, operand, value);
+  return LiteralValue(tree, a, value);
+}
+
+/* Free an operand of a folded operator, with its conversion */
+static void FreeOperand(TAst& tree, TNodeIndex a, TFoldCount& count)
+{
+  if (IsConversion(tree, a))
+  {
+    TNodeIndex operand = tree.nodes[a].first;
+    FreeFoldedNode(tree, a, count);
+    FreeFoldedNode(tree, operand, count);
+  }
+  else
+    FreeFoldedNode(tree, a, count);
+}
+
+/* An operand, with its conversion folded */
+static TNodeIndex FoldOperand(TAst& tree, TConstantPool& pool, TNodeIndex a, TFoldCount& count)
+{
+  if (IsConversion(tree, a))
+    return FoldConstantNode(tree, pool, a, count);
+  return a;
+}
+
+TNodeIndex FoldConstantNode(TAst& tree, TConstantPool& pool, TNodeIndex a, TFoldCount& count)
+{
+  if (NO_NODE == a)
+    return a;
+  bool binary = typeBinaryOp == tree.nodes[a].nodetype;
+  if (!binary && typeUnaryOp != tree.nodes[a].nodetype)
+    return a;
+
+  TOperatorEnum op = (TOperatorEnum) tree.nodes[a].op;
+  TNodeIndex left = tree.nodes[a].first;
+  TNodeIndex right = binary ? tree.nodes[a].second : NO_NODE;
+  TFoldedValue l, r, value;
+  bool folded = OperandValue(tree, left, l);
+  if (folded && binary)
+    folded = OperandValue(tree, right, r) && FoldBinary(op, l, r, value);
+  else if (folded)
+    folded = FoldUnary(op, l, value);
+  /* operators keep the type the parser checked */
+  if (folded && value.type != tree.nodes[a].valueType)
+    folded = false;
+  if (!folded)
+  {
+    /* the operator stays, the conversions of its literals still fold */
+    left = FoldOperand(tree, pool, left, count);
+    tree.nodes[a].first = left;
+    if (binary)
+    {
+      right = FoldOperand(tree, pool, right, count);
+      tree.nodes[a].second = right;
+    }
+    return a;
+  }
+
+  /* on the fly, the operator and its conversions are the newest nodes */
+  FreeFoldedNode(tree, a, count);
+  if (binary)
+    FreeOperand(tree, right, count);
+  FreeOperand(tree, left, count);
+  if (typeDouble == value.type)
+    return InternConstant(pool, tree, value.dNumber);
+  return InternConstant(pool, tree, value.iNumber);
+}
+
+TNodeIndex FoldConstants(TAst& tree, TConstantPool& pool, TNodeIndex a, TFoldCount& count)
+{
+  if (NO_NODE == a)
+    return a;
+  /* folding adds nodes, so a child is stored only once it is folded */
+  TNodeIndex child;
+  switch (tree.nodes[a].nodetype)
+  {
+  case typeBinaryOp:
+    child = FoldConstants(tree, pool, tree.nodes[a].second, count);
+    tree.nodes[a].second = child;
+    /* fall through */
+  case typeUnaryOp:
+    child = FoldConstants(tree, pool, tree.nodes[a].first, count);
+    tree.nodes[a].first = child;
+    return FoldConstantNode(tree, pool, a, count);
+
+  case typeInput:
+  case typeOutput:
+  case typeReturn:
+    child = FoldConstants(tree, pool, tree.nodes[a].first, count);
+    tree.nodes[a].first = child;
+    return a;
+
+  case typeAssignmentOp:
+    child = FoldConstants(tree, pool, tree.nodes[a].second, count);
+    tree.nodes[a].second = child;
+    return a;
+
+  case typeIfStatement:
+  case typeWhileStatement:
+  case typeFunctionStatment:
+    child = FoldConstants(tree, pool, tree.nodes[a].first, count);
+    tree.nodes[a].first = child;
+    child = FoldConstants(tree, pool, tree.nodes[a].second, count);
+    tree.nodes[a].second = child;
+    child = FoldConstants(tree, pool, tree.nodes[a].third, count);
+    tree.nodes[a].third = child;
+    return a;
+
+  case typeList:
+    for (auto i = 0u; i < tree.nodes[a].second; ++i)
+    {
+      child = FoldConstants(tree, pool, tree.children[tree.nodes[a].first + i], count);
+      tree.children[tree.nodes[a].first + i] = child;
+    }
+    return a;
+
+  default:
+    return a;
+  }
+}
@@ -0,0 +1,30 @@
+/* Constant folding: operators whose operands are literals become literals */
+
+#ifndef _FOLD_HPP
+#define _FOLD_HPP
+
+#include "ast.hpp"
+#include "constants.hpp"
+
+/* Nodes taken out of expressions by folding */
+typedef struct
+{
+  long removed;       /* freed off the end of the node vector */
+  long unreachable;   /* left in the node vector, no longer in the tree */
+} TFoldCount;
+
+/* Fold the operator node a if its operands are literals, looking through
+   the int to double conversions of its operands. Returns the node that
+   takes its place, a pooled constant, or a itself. Each operator and
+   conversion folded away is counted: freed if it is at the end of the
+   node vector, as on the fly, else left unreachable. Pooled literals are
+   shared and stay.
+   An operator whose value does not have the type the parser gave it
+   (int + double is typed int) is kept, as is a division by zero. */
+TNodeIndex FoldConstantNode(TAst& tree, TConstantPool& pool, TNodeIndex a, TFoldCount& count);
+
+/* Fold every constant subexpression of the tree under a, returns the
+   node that takes its place */
+TNodeIndex FoldConstants(TAst& tree, TConstantPool& pool, TNodeIndex a, TFoldCount& count);
+
+#endif
@@ -0,0 +1,65 @@
+/*
+* Identifier interning: an open-addressing hash table over the spellings
+*/
+#include <cstring>
+
+#include "identifiers.hpp"
+
+/* FNV-1a */
+static unsigned HashIdentifier(const char* text, size_t length)
+{
+  unsigned hash = 2166136261u;
+  for (size_t i = 0; i < length; ++i)
+  {
+    hash ^= (unsigned char) text[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/* Rebuild the slots twice as large, keeping the load factor under 1/2 */
+static void GrowIdentifierTable(TIdentifierTable& table)
+{
+  size_t size = table.slots.empty() ? 1024 : table.slots.size() * 2;
+  table.slots.assign(size, 0);
+  size_t mask = size - 1;
+  for (auto i = 0u; i < table.identifiers.size(); ++i)
+  {
+    size_t slot = table.identifiers[i].hash & mask;
+    while (table.slots[slot] != 0)
+      slot = (slot + 1) & mask;
+    table.slots[slot] = i + 1;
+  }
+}
+
+const TIdentifier* InternIdentifier(TIdentifierTable& table, const char* text, size_t length)
+{
+  if (2 * (table.identifiers.size() + 1) > table.slots.size())
+    GrowIdentifierTable(table);
+
+  unsigned hash = HashIdentifier(text, length);
+  size_t mask = table.slots.size() - 1;
+  size_t slot = hash & mask;
+  while (table.slots[slot] != 0)
+  {
+    const TIdentifier& candidate = table.identifiers[table.slots[slot] - 1];
+    if (candidate.hash == hash && candidate.name.size() == length &&
+        0 == memcmp(candidate.name.data(), text, length))
+      return &candidate;
+    slot = (slot + 1) & mask;
+  }
+
+  TIdentifier record;
+  record.id = (unsigned) table.identifiers.size();
+  record.hash = hash;
+  table.identifiers.push_back(record);
+  table.identifiers.back().name.assign(text, length);
+  table.slots[slot] = record.id + 1;
+  return &table.identifiers.back();
+}
+
+void ClearIdentifierTable(TIdentifierTable& table)
+{
+  table.identifiers.clear();
+  table.slots.clear();
+}
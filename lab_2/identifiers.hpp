@@ -0,0 +1,31 @@
+/* Identifier interning */
+
+#ifndef _IDENTIFIERS_HPP
+#define _IDENTIFIERS_HPP
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+/* One record per distinct identifier spelling of a compilation.
+   Two identifiers are the same name if and only if their records are
+   the same object, so symbol lookups compare pointers (or ids). */
+typedef struct
+{
+  unsigned id;        /* dense number in order of first appearance */
+  unsigned hash;
+  std::string name;
+} TIdentifier;
+
+typedef struct
+{
+  std::deque<TIdentifier> identifiers;  /* indexed by id, records never move */
+  std::vector<unsigned> slots;          /* open addressing: id + 1, 0 is a free slot */
+} TIdentifierTable;
+
+/* Returns the record of the spelling, adding it on first sight */
+const TIdentifier* InternIdentifier(TIdentifierTable& table, const char* text, size_t length);
+void ClearIdentifierTable(TIdentifierTable& table);
+
+#endif
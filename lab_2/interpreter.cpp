@@ -0,0 +1,583 @@
+/*
+* Tree-walking interpreter: executes the AST of a program directly
+*/
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "interpreter.hpp"
+
+/* How a statement ends */
+typedef enum
+{
+  flowNext,
+  flowBreak,
+  flowContinue,
+  flowReturn,
+  flowError
+} TFlowEnum;
+
+static bool IsArray(SubexpressionValueTypeEnum type)
+{
+  return type >= typeIntArray;
+}
+
+static void RuntimeError(TInterpreter& vm, const char* message)
+{
+  if (!vm.failed)
+  {
+    vm.failed = true;
+    vm.error = message;
+  }
+}
+
+static TValue ZeroValue()
+{
+  TValue value;
+  memset(&value, 0, sizeof(value));
+  return value;
+}
+
+int DoubleToInt(double d)
+{
+  if (d != d)
+    return 0;
+  if (d <= (double) INT_MIN)
+    return INT_MIN;
+  if (d >= (double) INT_MAX)
+    return INT_MAX;
+  return (int) d;
+}
+
+static double ToDouble(TValue value, SubexpressionValueTypeEnum type)
+{
+  return typeDouble == type ? value.dNumber : value.iNumber;
+}
+
+/* The value converted from one type to another, as an assignment does */
+static TValue ConvertValue(TInterpreter& vm, TValue value, SubexpressionValueTypeEnum from,
+                           SubexpressionValueTypeEnum to)
+{
+  if (from == to)
+    return value;
+  if (IsArray(from) || IsArray(to))
+  {
+    RuntimeError(vm, "an array does not convert to another type");
+    return ZeroValue();
+  }
+  TValue result;
+  int i = typeDouble == from ? DoubleToInt(value.dNumber) : value.iNumber;
+  switch (to)
+  {
+  case typeDouble:
+    result.dNumber = ToDouble(value, from);
+    break;
+  case typeChar:
+    result.iNumber = (char) i;
+    break;
+  case typeBool:
+    result.iNumber = typeDouble == from ? value.dNumber != 0 : i != 0;
+    break;
+  default:
+    result.iNumber = i;
+    break;
+  }
+  return result;
+}
+
+static TValue Evaluate(TInterpreter& vm, TNodeIndex a);
+
+/* Whether a condition holds */
+static bool IsTrue(TInterpreter& vm, TNodeIndex a)
+{
+  TValue value = Evaluate(vm, a);
+  SubexpressionValueTypeEnum type = NodeValueType(*vm.tree, a);
+  if (IsArray(type))
+  {
+    RuntimeError(vm, "an array is not a condition");
+    return false;
+  }
+  return typeDouble == type ? value.dNumber != 0 : value.iNumber != 0;
+}
+
+static bool CompareInts(TOperatorEnum op, int left, int right)
+{
+  switch (op)
+  {
+  case opLess:         return left < right;
+  case opGreater:      return left > right;
+  case opLessEqual:    return left <= right;
+  case opGreaterEqual: return left >= right;
+  case opEqual:        return left == right;
+  default:             return left != right;
+  }
+}
+
+static bool CompareDoubles(TOperatorEnum op, double left, double right)
+{
+  switch (op)
+  {
+  case opLess:         return left < right;
+  case opGreater:      return left > right;
+  case opLessEqual:    return left <= right;
+  case opGreaterEqual: return left >= right;
+  case opEqual:        return left == right;
+  default:             return left != right;
+  }
+}
+
+/* Operands of mixed types are computed as doubles, ints wrap around; the
+   result is converted to the type of the operator node */
+static TValue EvaluateBinary(TInterpreter& vm, const TNode& node)
+{
+  SubexpressionValueTypeEnum leftType = NodeValueType(*vm.tree, node.first);
+  SubexpressionValueTypeEnum rightType = NodeValueType(*vm.tree, node.second);
+  TValue left = Evaluate(vm, node.first);
+  TValue right = Evaluate(vm, node.second);
+  if (IsArray(leftType) || IsArray(rightType))
+  {
+    RuntimeError(vm, "arithmetic on an array");
+    return ZeroValue();
+  }
+
+  TOperatorEnum op = (TOperatorEnum) node.op;
+  TValue result;
+  SubexpressionValueTypeEnum type;
+  if (typeDouble == leftType || typeDouble == rightType)
+  {
+    double l = ToDouble(left, leftType), r = ToDouble(right, rightType);
+    type = typeDouble;
+    switch (op)
+    {
+    case opAdd:      result.dNumber = l + r; break;
+    case opSubtract: result.dNumber = l - r; break;
+    case opMultiply: result.dNumber = l * r; break;
+    case opDivide:   result.dNumber = l / r; break;
+    default:         result.dNumber = CompareDoubles(op, l, r); break;
+    }
+  }
+  else
+  {
+    unsigned l = (unsigned) left.iNumber, r = (unsigned) right.iNumber;
+    type = typeInt;
+    switch (op)
+    {
+    case opAdd:      result.iNumber = (int) (l + r); break;
+    case opSubtract: result.iNumber = (int) (l - r); break;
+    case opMultiply: result.iNumber = (int) (l * r); break;
+    case opDivide:
+      if (0 == right.iNumber)
+      {
+        RuntimeError(vm, "division by zero");
+        return ZeroValue();
+      }
+      if (INT_MIN == left.iNumber && -1 == right.iNumber)
+        result.iNumber = INT_MIN;
+      else
+        result.iNumber = left.iNumber / right.iNumber;
+      break;
+    default:
+      result.iNumber = CompareInts(op, left.iNumber, right.iNumber);
+      break;
+    }
+  }
+  return ConvertValue(vm, result, type, (SubexpressionValueTypeEnum) node.valueType);
+}
+
+static TValue EvaluateUnary(TInterpreter& vm, const TNode& node)
+{
+  SubexpressionValueTypeEnum type = NodeValueType(*vm.tree, node.first);
+  TValue operand = Evaluate(vm, node.first);
+  if (IsArray(type))
+  {
+    RuntimeError(vm, "arithmetic on an array");
+    return ZeroValue();
+  }
+  TValue result;
+  if (opToDouble == node.op)
+  {
+    result.dNumber = ToDouble(operand, type);
+    type = typeDouble;
+  }
+  else if (typeDouble == type)
+    result.dNumber = -operand.dNumber;
+  else
+  {
+    result.iNumber = (int) (0u - (unsigned) operand.iNumber);
+    type = typeInt;
+  }
+  return ConvertValue(vm, result, type, (SubexpressionValueTypeEnum) node.valueType);
+}
+
+/* What an operator node is specialized into before the program runs: an
+   operation on ints or doubles that needs no type checks, or the generic
+   evaluation when its operands are arrays or its result needs a
+   conversion, as a char or bool result does. An int operand of a double
+   operation comes through a td node, which specializes too. The
+   operations are in the order of TOperatorEnum. */
+typedef enum
+{
+  specGeneric,
+  specAddInt,
+  specSubtractInt,
+  specMultiplyInt,
+  specDivideInt,
+  specLessInt,           /* comparisons of ints give int 1 or 0 */
+  specGreaterInt,
+  specLessEqualInt,
+  specGreaterEqualInt,
+  specEqualInt,
+  specNotEqualInt,
+  specAddDouble,
+  specSubtractDouble,
+  specMultiplyDouble,
+  specDivideDouble,
+  specLessDouble,        /* comparisons of doubles give int 1 or 0 too */
+  specGreaterDouble,
+  specLessEqualDouble,
+  specGreaterEqualDouble,
+  specEqualDouble,
+  specNotEqualDouble,
+  specNegateInt,
+  specNegateDouble,
+  specIntToDouble
+} TSpecializedEnum;
+
+/* int, char and bool values are ints */
+static bool IsInt(SubexpressionValueTypeEnum type)
+{
+  return typeInt == type || typeChar == type || typeBool == type;
+}
+
+/* The operation an operator node always does, given the types the parser
+   gave it and its operands; these do not change while the program runs,
+   so a specialized operator never has to fall back to the generic one */
+static TSpecializedEnum Specialize(const TInterpreter& vm, const TNode& node)
+{
+  SubexpressionValueTypeEnum type = (SubexpressionValueTypeEnum) node.valueType;
+  SubexpressionValueTypeEnum operand = NodeValueType(*vm.tree, node.first);
+  if (typeUnaryOp == node.nodetype)
+  {
+    if (opToDouble == node.op)
+      return IsInt(operand) && typeDouble == type ? specIntToDouble : specGeneric;
+    if (IsInt(operand) && typeInt == type)
+      return specNegateInt;
+    if (typeDouble == operand && typeDouble == type)
+      return specNegateDouble;
+    return specGeneric;
+  }
+  if (node.op < opAdd || node.op > opNotEqual)
+    return specGeneric;
+  SubexpressionValueTypeEnum right = NodeValueType(*vm.tree, node.second);
+  /* comparisons give int 1 or 0 */
+  bool comparison = node.op >= opLess;
+  if (IsInt(operand) && IsInt(right) && typeInt == type)
+    return (TSpecializedEnum) (specAddInt + (node.op - opAdd));
+  if (typeDouble == operand && typeDouble == right && (comparison ? typeInt : typeDouble) == type)
+    return (TSpecializedEnum) (specAddDouble + (node.op - opAdd));
+  return specGeneric;
+}
+
+/* An operator node, as the operation it has been specialized into */
+static TValue EvaluateOperator(TInterpreter& vm, TNodeIndex a, const TNode& node)
+{
+  ++vm.operations;
+  uint8_t operation = vm.specialized[a];
+  if (specGeneric == operation)
+  {
+    ++vm.unspecialized;
+    return typeBinaryOp == node.nodetype ? EvaluateBinary(vm, node) : EvaluateUnary(vm, node);
+  }
+
+  TValue result;
+  TValue left = Evaluate(vm, node.first);
+  if (operation >= specNegateInt)
+  {
+    switch (operation)
+    {
+    case specNegateInt:    result.iNumber = (int) (0u - (unsigned) left.iNumber); break;
+    case specNegateDouble: result.dNumber = -left.dNumber; break;
+    default:               result.dNumber = left.iNumber; break;    /* specIntToDouble */
+    }
+    return result;
+  }
+
+  TValue right = Evaluate(vm, node.second);
+  unsigned l = (unsigned) left.iNumber, r = (unsigned) right.iNumber;
+  switch (operation)
+  {
+  case specAddInt:      result.iNumber = (int) (l + r); break;
+  case specSubtractInt: result.iNumber = (int) (l - r); break;
+  case specMultiplyInt: result.iNumber = (int) (l * r); break;
+  case specDivideInt:
+    if (0 == right.iNumber)
+    {
+      RuntimeError(vm, "division by zero");
+      return ZeroValue();
+    }
+    if (INT_MIN == left.iNumber && -1 == right.iNumber)
+      result.iNumber = INT_MIN;
+    else
+      result.iNumber = left.iNumber / right.iNumber;
+    break;
+  case specLessInt:            result.iNumber = left.iNumber < right.iNumber; break;
+  case specGreaterInt:         result.iNumber = left.iNumber > right.iNumber; break;
+  case specLessEqualInt:       result.iNumber = left.iNumber <= right.iNumber; break;
+  case specGreaterEqualInt:    result.iNumber = left.iNumber >= right.iNumber; break;
+  case specEqualInt:           result.iNumber = left.iNumber == right.iNumber; break;
+  case specNotEqualInt:        result.iNumber = left.iNumber != right.iNumber; break;
+  case specAddDouble:          result.dNumber = left.dNumber + right.dNumber; break;
+  case specSubtractDouble:     result.dNumber = left.dNumber - right.dNumber; break;
+  case specMultiplyDouble:     result.dNumber = left.dNumber * right.dNumber; break;
+  case specDivideDouble:       result.dNumber = left.dNumber / right.dNumber; break;
+  case specLessDouble:         result.iNumber = left.dNumber < right.dNumber; break;
+  case specGreaterDouble:      result.iNumber = left.dNumber > right.dNumber; break;
+  case specLessEqualDouble:    result.iNumber = left.dNumber <= right.dNumber; break;
+  case specGreaterEqualDouble: result.iNumber = left.dNumber >= right.dNumber; break;
+  case specEqualDouble:        result.iNumber = left.dNumber == right.dNumber; break;
+  default:                     result.iNumber = left.dNumber != right.dNumber; break;
+  }
+  return result;
+}
+
+static TValue Evaluate(TInterpreter& vm, TNodeIndex a)
+{
+  const TNode& node = vm.tree->nodes[a];
+  TValue value;
+  switch (node.nodetype)
+  {
+  case typeConst:
+    switch (node.valueType)
+    {
+    case typeDouble: value.dNumber = node.dNumber; break;
+    case typeChar:   value.iNumber = node.cNumber; break;
+    case typeBool:   value.iNumber = node.bNumber; break;
+    case typeInt:    value.iNumber = node.iNumber; break;
+    default:         value.array = node.iArrayNumber; break;
+    }
+    return value;
+
+  case typeIdentifier:
+    if (NO_SYMBOL == node.first)
+    {
+      RuntimeError(vm, "reference to an undeclared variable");
+      return ZeroValue();
+    }
+    return vm.slots[node.first];
+
+  case typeBinaryOp:
+  case typeUnaryOp:
+    return EvaluateOperator(vm, a, node);
+
+  default:
+    RuntimeError(vm, "bad expression");
+    return ZeroValue();
+  }
+}
+
+static TFlowEnum Execute(TInterpreter& vm, TNodeIndex a);
+
+static TFlowEnum ExecuteAssignment(TInterpreter& vm, const TNode& node)
+{
+  if (NO_SYMBOL == node.first)
+  {
+    RuntimeError(vm, "assignment to an undeclared variable");
+    return flowError;
+  }
+  TValue value = Evaluate(vm, node.second);
+  SubexpressionValueTypeEnum type = SymbolRecord(vm.tree->variables, node.first).valueType;
+  value = ConvertValue(vm, value, NodeValueType(*vm.tree, node.second), type);
+  if (vm.failed)
+    return flowError;
+  vm.slots[node.first] = value;
+  return flowNext;
+}
+
+static TFlowEnum ExecuteInput(TInterpreter& vm, const TNode& node)
+{
+  const TNode& variable = vm.tree->nodes[node.first];
+  if (typeIdentifier != variable.nodetype || NO_SYMBOL == variable.first)
+  {
+    RuntimeError(vm, "input needs a variable");
+    return flowError;
+  }
+  TValue& slot = vm.slots[variable.first];
+  std::istream& in = *vm.in;
+  bool read;
+  switch (variable.valueType)
+  {
+  case typeInt:
+    read = static_cast<bool>(in >> slot.iNumber);
+    break;
+  case typeDouble:
+    read = static_cast<bool>(in >> slot.dNumber);
+    break;
+  case typeChar:
+  {
+    char c = 0;
+    read = static_cast<bool>(in >> c);
+    slot.iNumber = c;
+    break;
+  }
+  case typeBool:
+  {
+    int i = 0;
+    read = static_cast<bool>(in >> i);
+    slot.iNumber = i != 0;
+    break;
+  }
+  default:
+    RuntimeError(vm, "input of an array");
+    return flowError;
+  }
+  if (!read)
+  {
+    RuntimeError(vm, "no value to input");
+    return flowError;
+  }
+  return flowNext;
+}
+
+static TFlowEnum ExecuteOutput(TInterpreter& vm, const TNode& node)
+{
+  TValue value = Evaluate(vm, node.first);
+  if (vm.failed)
+    return flowError;
+  std::ostream& out = *vm.out;
+  switch (NodeValueType(*vm.tree, node.first))
+  {
+  case typeInt:    out << value.iNumber << std::endl; break;
+  case typeDouble: out << value.dNumber << std::endl; break;
+  case typeChar:   out << (char) value.iNumber << std::endl; break;
+  case typeBool:   out << (value.iNumber != 0) << std::endl; break;
+  default:
+    RuntimeError(vm, "output of an array");
+    return flowError;
+  }
+  return flowNext;
+}
+
+static TFlowEnum ExecuteLoop(TInterpreter& vm, const TNode& node)
+{
+  /* a do loop runs its body before the first test */
+  bool testing = loopDo != node.op;
+  for (;;)
+  {
+    if (testing)
+    {
+      bool holds = IsTrue(vm, node.first);
+      if (vm.failed)
+        return flowError;
+      if (!holds)
+        return flowNext;
+    }
+    testing = true;
+    TFlowEnum flow = Execute(vm, node.second);
+    if (flowBreak == flow)
+      return flowNext;
+    if (flowReturn == flow || flowError == flow)
+      return flow;
+    /* continue goes on with the step of a for loop */
+    if (flowError == Execute(vm, node.third))
+      return flowError;
+  }
+}
+
+static TFlowEnum Execute(TInterpreter& vm, TNodeIndex a)
+{
+  if (NO_NODE == a)
+    return flowNext;
+  const TNode& node = vm.tree->nodes[a];
+  if (typeList != node.nodetype)
+    ++vm.steps;
+  switch (node.nodetype)
+  {
+  case typeList:
+    for (auto i = 0u; i < node.second; ++i)
+    {
+      TFlowEnum flow = Execute(vm, vm.tree->children[node.first + i]);
+      if (flowNext != flow)
+        return flow;
+    }
+    return flowNext;
+
+  case typeAssignmentOp:
+    return ExecuteAssignment(vm, node);
+
+  case typeIfStatement:
+  {
+    bool holds = IsTrue(vm, node.first);
+    if (vm.failed)
+      return flowError;
+    return Execute(vm, holds ? node.second : node.third);
+  }
+
+  case typeWhileStatement:
+    return ExecuteLoop(vm, node);
+
+  case typeJumpStatement:
+    switch (node.op)
+    {
+    case jumpBreak:    return flowBreak;
+    case jumpContinue: return flowContinue;
+    default:           return flowReturn;
+    }
+
+  case typeInput:
+    return ExecuteInput(vm, node);
+
+  case typeOutput:
+    return ExecuteOutput(vm, node);
+
+  case typeFunctionStatment:
+    /* a definition, its body runs only when called */
+    return flowNext;
+
+  default:
+    /* an expression statement */
+    Evaluate(vm, a);
+    return vm.failed ? flowError : flowNext;
+  }
+}
+
+void InitInterpreter(TInterpreter& vm, const TAst& tree, std::istream& in, std::ostream& out)
+{
+  vm.tree = &tree;
+  size_t symbols = NULL != tree.variables ? tree.variables->data.size() : 0;
+  try
+  {
+    vm.slots.assign(symbols + 1, ZeroValue());
+    vm.specialized.assign(tree.nodes.size(), specGeneric);
+  }
+  catch (std::bad_alloc& ba)
+  {
+    perror("out of space");
+    exit(0);
+  }
+  vm.in = &in;
+  vm.out = &out;
+  vm.failed = false;
+  vm.error.clear();
+  vm.steps = 0;
+  vm.specializing = true;
+  vm.operations = 0;
+  vm.unspecialized = 0;
+}
+
+bool RunProgram(TInterpreter& vm, TNodeIndex program)
+{
+  if (vm.specializing)
+  {
+    for (auto a = 0u; a < vm.tree->nodes.size(); ++a)
+    {
+      const TNode& node = vm.tree->nodes[a];
+      if (typeBinaryOp == node.nodetype || typeUnaryOp == node.nodetype)
+        vm.specialized[a] = Specialize(vm, node);
+    }
+  }
+  TFlowEnum flow = Execute(vm, program);
+  /* break and continue outside loops have been reported by the parser,
+     they end the program as return does */
+  return flowError != flow && !vm.failed;
+}
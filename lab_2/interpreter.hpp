@@ -0,0 +1,59 @@
+/* Tree-walking interpreter of Simpl programs */
+
+#ifndef _INTERPRETER_HPP
+#define _INTERPRETER_HPP
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ast.hpp"
+
+/* The virtual machines jump from handler to handler through computed
+   gotos where the compiler has labels as values; -DSWITCH_DISPATCH builds
+   the portable loop over a switch instead */
+#if defined __GNUC__ && !defined SWITCH_DISPATCH
+#define THREADED_DISPATCH 1
+#endif
+
+/* Value of an expression or variable, of the type the parser gave it:
+   int, char and bool values are ints, arrays are their storage */
+typedef union
+{
+  int iNumber;
+  double dNumber;
+  void* array;
+} TValue;
+
+/* A double converted to int: truncated towards zero, saturated at the
+   bounds of int; NaN is 0 */
+int DoubleToInt(double d);
+
+/* State of a running program */
+typedef struct
+{
+  const TAst* tree;
+  std::vector<TValue> slots;         /* variables by symbol, slots[0] is unused */
+  std::istream* in;                  /* what input() reads */
+  std::ostream* out;                 /* what echa() writes */
+  bool failed;                       /* stopped on a runtime error */
+  std::string error;
+  unsigned long steps;               /* statements executed */
+  bool specializing;                 /* operators specialize to their types */
+  std::vector<uint8_t> specialized;  /* what each operator node does, by node */
+  unsigned long operations;          /* operators evaluated */
+  unsigned long unspecialized;       /* of which had no specialization */
+} TInterpreter;
+
+/* Every variable of the tree's program starts out zero and every
+   operator generic, until RunProgram specializes them */
+void InitInterpreter(TInterpreter& vm, const TAst& tree, std::istream& in, std::ostream& out);
+
+/* Execute the program from its root until its end or a return statement,
+   with its operators specialized to their types unless vm.specializing
+   is turned off. False on a runtime error, which is described in
+   vm.error. Function bodies are not run: there is no way to call a
+   function. */
+bool RunProgram(TInterpreter& vm, TNodeIndex program);
+
+#endif
@@ -0,0 +1,1027 @@
+/*
+* Baseline JIT: stack machine bytecode to x86-64 machine code
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+#include "jit.hpp"
+
+#ifdef JIT_X86_64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/* What the compiled program returns: how it ended, or the index in
+   bytecode.errors of the error instruction that stopped it */
+typedef enum
+{
+  jitHalt = -1,
+  jitDivisionByZero = -2,
+  jitNoInput = -3
+} TJitStatusEnum;
+
+/* The machine code is called as a function of the slots, the stack and
+   the machine its runtime helpers read and write */
+typedef int (*TJitFunction)(TValue* slots, TValue* stack, TStackMachine* vm);
+
+static bool Fail(TStackMachine& vm, const std::string& message)
+{
+  vm.failed = true;
+  vm.error = message;
+  return false;
+}
+
+bool RunJit(TStackMachine& vm, const TJitCode& jit)
+{
+  TJitFunction entry = reinterpret_cast<TJitFunction>(jit.code);
+  int status = entry(vm.slots.data(), vm.stack.data(), &vm);
+  vm.dispatches = 0;
+  switch (status)
+  {
+  case jitHalt:           return true;
+  case jitDivisionByZero: return Fail(vm, "division by zero");
+  case jitNoInput:        return Fail(vm, "no value to input");
+  default:                return Fail(vm, vm.bytecode->errors[status]);
+  }
+}
+
+#ifndef JIT_X86_64
+
+bool CompileJit(TJitCode& jit, const TBytecode& bytecode)
+{
+  jit.code = NULL;
+  jit.size = 0;
+  jit.mapped = 0;
+  return false;
+}
+
+void ReleaseJit(TJitCode& jit)
+{
+  jit.code = NULL;
+}
+
+#else
+
+/* Runtime helpers the code calls for input, output and conversions, as
+   the stack machine does them */
+static bool InputInt(TStackMachine* vm, TValue* slot)
+{
+  return static_cast<bool>(*vm->in >> slot->iNumber);
+}
+
+static bool InputDouble(TStackMachine* vm, TValue* slot)
+{
+  return static_cast<bool>(*vm->in >> slot->dNumber);
+}
+
+static bool InputChar(TStackMachine* vm, TValue* slot)
+{
+  char c = 0;
+  if (!(*vm->in >> c))
+    return false;
+  slot->iNumber = c;
+  return true;
+}
+
+static bool InputBool(TStackMachine* vm, TValue* slot)
+{
+  int i = 0;
+  if (!(*vm->in >> i))
+    return false;
+  slot->iNumber = i != 0;
+  return true;
+}
+
+static void PrintInt(TStackMachine* vm, int i)
+{
+  *vm->out << i << std::endl;
+}
+
+static void PrintDouble(TStackMachine* vm, double d)
+{
+  *vm->out << d << std::endl;
+}
+
+static void PrintChar(TStackMachine* vm, int i)
+{
+  *vm->out << (char) i << std::endl;
+}
+
+static void PrintBool(TStackMachine* vm, int i)
+{
+  *vm->out << (i != 0) << std::endl;
+}
+
+/* Registers by their number in the encoding. While the program runs rbx
+   holds the slots, r12 the stack and r13 the machine; being callee-saved
+   they survive the calls of the helpers. rax and xmm0 hold the results
+   of instructions, rcx and xmm1 their second operands, rdx is scratch. */
+typedef enum
+{
+  cpuRax = 0,
+  cpuRcx = 1,
+  cpuRdx = 2,
+  cpuRbx = 3,
+  cpuRsi = 6,
+  cpuRdi = 7,
+  cpuR12 = 12,
+  cpuR13 = 13,
+  cpuXmm0 = 0,
+  cpuXmm1 = 1
+} TCpuRegisterEnum;
+
+/* A rel32 operand to patch with the address of an instruction */
+typedef struct
+{
+  size_t at;        /* offset of the operand */
+  size_t target;    /* instruction index, or one of the stubs after the code */
+} TJitFixup;
+
+/* Where the value of a stack entry is while the code is compiled. Entries
+   are written to the stack's memory only when the code needs them there:
+   before jumps, jump targets and calls. */
+typedef enum
+{
+  entryMemory,      /* in the stack */
+  entryInt,         /* the int constant value */
+  entryDouble,      /* the double constant doubles[value] */
+  entrySlot,        /* the variable of slot value, which no store has changed */
+  entryRax,         /* in eax, at most one entry */
+  entryXmm0,        /* in xmm0, at most one entry */
+  entryRcx,         /* in ecx, the second operand of the instruction compiled */
+  entryXmm1         /* in xmm1, likewise */
+} TEntryEnum;
+
+typedef struct
+{
+  uint8_t kind;     /* TEntryEnum */
+  int32_t value;
+} TStackEntry;
+
+typedef struct
+{
+  const TBytecode* bytecode;
+  std::vector<uint8_t> bytes;
+  std::vector<size_t> labels;       /* offsets of the instructions, then of the stubs */
+  std::vector<TJitFixup> fixups;
+  std::vector<TStackEntry> stack;   /* the entries at the instruction compiled */
+} TAssembler;
+
+static void Byte(TAssembler& a, uint8_t byte)
+{
+  a.bytes.push_back(byte);
+}
+
+static void Bytes(TAssembler& a, std::initializer_list<uint8_t> bytes)
+{
+  a.bytes.insert(a.bytes.end(), bytes.begin(), bytes.end());
+}
+
+static void Int32(TAssembler& a, int32_t value)
+{
+  for (int i = 0; i < 4; ++i)
+    Byte(a, (uint8_t) ((uint32_t) value >> 8 * i));
+}
+
+static void Int64(TAssembler& a, uint64_t value)
+{
+  for (int i = 0; i < 8; ++i)
+    Byte(a, (uint8_t) (value >> 8 * i));
+}
+
+/* An instruction with a [base + disp32] operand: its mandatory prefix (0
+   for none), whether it is 64-bit, its opcode and the register or opcode
+   extension of the ModRM reg field */
+static void EmitMemory(TAssembler& a, uint8_t prefix, bool wide, std::initializer_list<uint8_t> opcode,
+                       unsigned reg, unsigned base, int32_t displacement)
+{
+  if (0 != prefix)
+    Byte(a, prefix);
+  uint8_t rex = 0x40 | (wide ? 8 : 0) | (reg & 8 ? 4 : 0) | (base & 8 ? 1 : 0);
+  if (0x40 != rex)
+    Byte(a, rex);
+  Bytes(a, opcode);
+  Byte(a, 0x80 | (reg & 7) << 3 | (base & 7));
+  if (4 == (base & 7))
+    Byte(a, 0x24);    /* SIB of r12: no index */
+  Int32(a, displacement);
+}
+
+/* Offset of a slot or stack entry */
+static int32_t At(int index)
+{
+  return index * (int32_t) sizeof(TValue);
+}
+
+/* A jump to an instruction or stub, patched once all are placed */
+static void EmitJump(TAssembler& a, std::initializer_list<uint8_t> opcode, size_t target)
+{
+  Bytes(a, opcode);
+  TJitFixup fixup;
+  fixup.at = a.bytes.size();
+  fixup.target = target;
+  a.fixups.push_back(fixup);
+  Int32(a, 0);
+}
+
+static void EmitCall(TAssembler& a, const void* function)
+{
+  Bytes(a, {0x48, 0xB8});               /* mov rax, function */
+  Int64(a, (uint64_t) (uintptr_t) function);
+  Bytes(a, {0xFF, 0xD0});               /* call rax */
+}
+
+/* The epilogue, returning the status */
+static void EmitReturn(TAssembler& a, int32_t status)
+{
+  Byte(a, 0xB8);                        /* mov eax, status */
+  Int32(a, status);
+  Bytes(a, {0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3});   /* pop r13, r12, rbx; ret */
+}
+
+/* eax, 1 or 0 as the condition code holds, to the stack entry */
+static void EmitSetInt(TAssembler& a, uint8_t condition, int entry)
+{
+  Bytes(a, {0x0F, condition, 0xC0});   /* setcc al */
+  Bytes(a, {0x0F, 0xB6, 0xC0});         /* movzx eax, al */
+  EmitMemory(a, 0, false, {0x89}, cpuRax, cpuR12, At(entry));
+}
+
+/* Compare the double entry with 0 */
+static void EmitTestDouble(TAssembler& a, int entry)
+{
+  EmitMemory(a, 0xF2, false, {0x0F, 0x10}, cpuXmm0, cpuR12, At(entry));   /* movsd xmm0 */
+  Bytes(a, {0x66, 0x0F, 0x57, 0xC9});   /* xorpd xmm1, xmm1 */
+  Bytes(a, {0x66, 0x0F, 0x2E, 0xC1});   /* ucomisd xmm0, xmm1 */
+}
+
+/* Condition codes of setcc, as 0x0F 0x9x */
+#define SET_ABOVE 0x97
+#define SET_ABOVE_EQUAL 0x93
+#define SET_EQUAL 0x94
+#define SET_NOT_EQUAL 0x95
+#define SET_LESS 0x9C
+#define SET_GREATER_EQUAL 0x9D
+#define SET_LESS_EQUAL 0x9E
+#define SET_GREATER 0x9F
+
+/* Stack depth before each instruction, -1 where the code is never
+   reached, and whether a jump goes there; false when the code is not what
+   CompileBytecode gives */
+static bool FindDepths(const TBytecode& bytecode, std::vector<int>& depths, std::vector<bool>& targets)
+{
+  const std::vector<TInstruction>& code = bytecode.code;
+  depths.assign(code.size(), -1);
+  targets.assign(code.size(), false);
+  if (code.empty())
+    return false;
+  std::vector<size_t> work(1, 0);
+  depths[0] = 0;
+  while (!work.empty())
+  {
+    size_t i = work.back();
+    work.pop_back();
+    unsigned opcode = code[i].opcode;
+    if (opcode > opcodeError)
+      return false;
+    int depth = depths[i] + OpcodeStackEffect(opcode);
+    if (depth < 0 || depth > (int) bytecode.maxStack)
+      return false;
+    size_t next[2];
+    size_t successors = 0;
+    if (opcodeJump == opcode || opcodeJumpIfFalseInt == opcode || opcodeJumpIfFalseDouble == opcode)
+    {
+      if (code[i].operand < 0 || (size_t) code[i].operand >= code.size())
+        return false;
+      targets[code[i].operand] = true;
+      next[successors++] = code[i].operand;
+    }
+    if (opcodeHalt != opcode && opcodeError != opcode && opcodeJump != opcode)
+      next[successors++] = i + 1;
+    for (size_t k = 0; k < successors; ++k)
+    {
+      if (next[k] >= code.size())
+        return false;
+      if (-1 == depths[next[k]])
+      {
+        depths[next[k]] = depth;
+        work.push_back(next[k]);
+      }
+      else if (depths[next[k]] != depth)
+        return false;
+    }
+  }
+  return true;
+}
+
+/* The machine code of an instruction whose operands are in the stack's
+   memory, where it leaves its result; d is the stack depth before it */
+static void EmitInMemory(TAssembler& a, const TBytecode& bytecode, const TInstruction& instruction,
+                         int d, size_t divisionByZero, size_t noInput)
+{
+  int32_t operand = instruction.operand;
+  switch (instruction.opcode)
+  {
+  case opcodeHalt:
+    EmitReturn(a, jitHalt);
+    break;
+  case opcodePushInt:
+    EmitMemory(a, 0, false, {0xC7}, 0, cpuR12, At(d));       /* mov dword [entry], operand */
+    Int32(a, operand);
+    break;
+  case opcodePushDouble:
+  case opcodePushArray:
+  {
+    uint64_t bits;
+    if (opcodePushDouble == instruction.opcode)
+      memcpy(&bits, &bytecode.doubles[operand], sizeof(bits));
+    else
+      bits = (uint64_t) (uintptr_t) bytecode.arrays[operand];
+    Bytes(a, {0x48, 0xB8});                                   /* mov rax, bits */
+    Int64(a, bits);
+    EmitMemory(a, 0, true, {0x89}, cpuRax, cpuR12, At(d));
+    break;
+  }
+  case opcodeLoad:
+    EmitMemory(a, 0, true, {0x8B}, cpuRax, cpuRbx, At(operand));
+    EmitMemory(a, 0, true, {0x89}, cpuRax, cpuR12, At(d));
+    break;
+  case opcodeStore:
+    EmitMemory(a, 0, true, {0x8B}, cpuRax, cpuR12, At(d - 1));
+    EmitMemory(a, 0, true, {0x89}, cpuRax, cpuRbx, At(operand));
+    break;
+  case opcodePop:
+    break;
+
+  /* ints wrap around */
+  case opcodeAddInt:
+  case opcodeSubtractInt:
+  case opcodeMultiplyInt:
+    EmitMemory(a, 0, false, {0x8B}, cpuRax, cpuR12, At(d - 2));
+    if (opcodeAddInt == instruction.opcode)
+      EmitMemory(a, 0, false, {0x03}, cpuRax, cpuR12, At(d - 1));
+    else if (opcodeSubtractInt == instruction.opcode)
+      EmitMemory(a, 0, false, {0x2B}, cpuRax, cpuR12, At(d - 1));
+    else
+      EmitMemory(a, 0, false, {0x0F, 0xAF}, cpuRax, cpuR12, At(d - 1));
+    EmitMemory(a, 0, false, {0x89}, cpuRax, cpuR12, At(d - 2));
+    break;
+  case opcodeDivideInt:
+    EmitMemory(a, 0, false, {0x8B}, cpuRcx, cpuR12, At(d - 1));
+    Bytes(a, {0x85, 0xC9});                                   /* test ecx, ecx */
+    EmitJump(a, {0x0F, 0x84}, divisionByZero);                /* je */
+    EmitMemory(a, 0, false, {0x8B}, cpuRax, cpuR12, At(d - 2));
+    /* by -1 negates, INT_MIN stays INT_MIN where idiv would trap */
+    Bytes(a, {0x83, 0xF9, 0xFF});                             /* cmp ecx, -1 */
+    Bytes(a, {0x75, 0x04});                                   /* jne idiv */
+    Bytes(a, {0xF7, 0xD8});                                   /* neg eax */
+    Bytes(a, {0xEB, 0x03});                                   /* jmp store */
+    Bytes(a, {0x99, 0xF7, 0xF9});                             /* idiv: cdq; idiv ecx */
+    EmitMemory(a, 0, false, {0x89}, cpuRax, cpuR12, At(d - 2));
+    break;
+  case opcodeNegateInt:
+    EmitMemory(a, 0, false, {0xF7}, 3, cpuR12, At(d - 1));   /* neg dword [entry] */
+    break;
+  case opcodeLessInt:
+  case opcodeGreaterInt:
+  case opcodeLessEqualInt:
+  case opcodeGreaterEqualInt:
+  case opcodeEqualInt:
+  case opcodeNotEqualInt:
+  {
+    static const uint8_t conditions[] =
+    {
+      SET_LESS, SET_GREATER, SET_LESS_EQUAL, SET_GREATER_EQUAL, SET_EQUAL, SET_NOT_EQUAL
+    };
+    EmitMemory(a, 0, false, {0x8B}, cpuRax, cpuR12, At(d - 2));
+    EmitMemory(a, 0, false, {0x3B}, cpuRax, cpuR12, At(d - 1));   /* cmp eax, right */
+    EmitSetInt(a, conditions[instruction.opcode - opcodeLessInt], d - 2);
+    break;
+  }
+
+  case opcodeAddDouble:
+  case opcodeSubtractDouble:
+  case opcodeMultiplyDouble:
+  case opcodeDivideDouble:
+  {
+    static const uint8_t operations[] = {0x58, 0x5C, 0x59, 0x5E};  /* addsd, subsd, mulsd, divsd */
+    EmitMemory(a, 0xF2, false, {0x0F, 0x10}, cpuXmm0, cpuR12, At(d - 2));
+    EmitMemory(a, 0xF2, false, {0x0F, operations[instruction.opcode - opcodeAddDouble]},
+               cpuXmm0, cpuR12, At(d - 1));
+    EmitMemory(a, 0xF2, false, {0x0F, 0x11}, cpuXmm0, cpuR12, At(d - 2));
+    break;
+  }
+  case opcodeNegateDouble:
+    Bytes(a, {0x48, 0xB8});                                   /* mov rax, sign bit */
+    Int64(a, 0x8000000000000000ull);
+    EmitMemory(a, 0, true, {0x31}, cpuRax, cpuR12, At(d - 1));   /* xor [entry], rax */
+    break;
+  /* ucomisd sets the flags of an unsigned compare, and all of them when
+     either value is NaN: a < b is b above a, which NaN fails */
+  case opcodeLessDouble:
+  case opcodeGreaterDouble:
+  case opcodeLessEqualDouble:
+  case opcodeGreaterEqualDouble:
+  case opcodeEqualDouble:
+  case opcodeNotEqualDouble:
+    EmitMemory(a, 0xF2, false, {0x0F, 0x10}, cpuXmm0, cpuR12, At(d - 2));
+    EmitMemory(a, 0xF2, false, {0x0F, 0x10}, cpuXmm1, cpuR12, At(d - 1));
+    switch (instruction.opcode)
+    {
+    case opcodeLessDouble:
+      Bytes(a, {0x66, 0x0F, 0x2E, 0xC8});                     /* ucomisd xmm1, xmm0 */
+      EmitSetInt(a, SET_ABOVE, d - 2);
+      break;
+    case opcodeGreaterDouble:
+      Bytes(a, {0x66, 0x0F, 0x2E, 0xC1});                     /* ucomisd xmm0, xmm1 */
+      EmitSetInt(a, SET_ABOVE, d - 2);
+      break;
+    case opcodeLessEqualDouble:
+      Bytes(a, {0x66, 0x0F, 0x2E, 0xC8});
+      EmitSetInt(a, SET_ABOVE_EQUAL, d - 2);
+      break;
+    case opcodeGreaterEqualDouble:
+      Bytes(a, {0x66, 0x0F, 0x2E, 0xC1});
+      EmitSetInt(a, SET_ABOVE_EQUAL, d - 2);
+      break;
+    case opcodeEqualDouble:
+      /* equal and ordered */
+      Bytes(a, {0x66, 0x0F, 0x2E, 0xC1});
+      Bytes(a, {0x0F, 0x9B, 0xC1});                           /* setnp cl */
+      Bytes(a, {0x0F, SET_EQUAL, 0xC0});                      /* sete al */
+      Bytes(a, {0x20, 0xC8});                                 /* and al, cl */
+      EmitSetInt(a, SET_NOT_EQUAL, d - 2);
+      break;
+    default:
+      /* not equal or unordered */
+      Bytes(a, {0x66, 0x0F, 0x2E, 0xC1});
+      Bytes(a, {0x0F, 0x9A, 0xC1});                           /* setp cl */
+      Bytes(a, {0x0F, SET_NOT_EQUAL, 0xC0});                  /* setne al */
+      Bytes(a, {0x08, 0xC8});                                 /* or al, cl */
+      EmitSetInt(a, SET_NOT_EQUAL, d - 2);
+      break;
+    }
+    break;
+
+  case opcodeIntToDouble:
+    EmitMemory(a, 0xF2, false, {0x0F, 0x2A}, cpuXmm0, cpuR12, At(d - 1));   /* cvtsi2sd */
+    EmitMemory(a, 0xF2, false, {0x0F, 0x11}, cpuXmm0, cpuR12, At(d - 1));
+    break;
+  case opcodeDoubleToInt:
+    EmitMemory(a, 0xF2, false, {0x0F, 0x10}, cpuXmm0, cpuR12, At(d - 1));
+    EmitCall(a, (const void*) &DoubleToInt);
+    EmitMemory(a, 0, false, {0x89}, cpuRax, cpuR12, At(d - 1));
+    break;
+  case opcodeIntToChar:
+    EmitMemory(a, 0, false, {0x0F, 0xBE}, cpuRax, cpuR12, At(d - 1));   /* movsx eax, byte */
+    EmitMemory(a, 0, false, {0x89}, cpuRax, cpuR12, At(d - 1));
+    break;
+  case opcodeIntToBool:
+    EmitMemory(a, 0, false, {0x83}, 7, cpuR12, At(d - 1));   /* cmp dword [entry], 0 */
+    Byte(a, 0);
+    EmitSetInt(a, SET_NOT_EQUAL, d - 1);
+    break;
+  case opcodeDoubleToBool:
+    /* NaN is true */
+    EmitTestDouble(a, d - 1);
+    Bytes(a, {0x0F, 0x9A, 0xC1});                             /* setp cl */
+    Bytes(a, {0x0F, SET_NOT_EQUAL, 0xC0});                    /* setne al */
+    Bytes(a, {0x08, 0xC8});                                   /* or al, cl */
+    EmitSetInt(a, SET_NOT_EQUAL, d - 1);
+    break;
+
+  case opcodeJump:
+    EmitJump(a, {0xE9}, operand);
+    break;
+  case opcodeJumpIfFalseInt:
+    EmitMemory(a, 0, false, {0x83}, 7, cpuR12, At(d - 1));
+    Byte(a, 0);
+    EmitJump(a, {0x0F, 0x84}, operand);                       /* je */
+    break;
+  case opcodeJumpIfFalseDouble:
+    /* NaN is true, it does not jump */
+    EmitTestDouble(a, d - 1);
+    Bytes(a, {0x7A, 0x06});                                   /* jp past the je */
+    EmitJump(a, {0x0F, 0x84}, operand);
+    break;
+
+  case opcodeInputInt:
+  case opcodeInputDouble:
+  case opcodeInputChar:
+  case opcodeInputBool:
+  {
+    static const void* const helpers[] =
+    {
+      (const void*) &InputInt, (const void*) &InputDouble, (const void*) &InputChar, (const void*) &InputBool
+    };
+    Bytes(a, {0x4C, 0x89, 0xEF});                             /* mov rdi, r13 */
+    EmitMemory(a, 0, true, {0x8D}, cpuRsi, cpuRbx, At(operand));   /* lea rsi, [slot] */
+    EmitCall(a, helpers[instruction.opcode - opcodeInputInt]);
+    Bytes(a, {0x84, 0xC0});                                   /* test al, al */
+    EmitJump(a, {0x0F, 0x84}, noInput);
+    break;
+  }
+  case opcodePrintInt:
+  case opcodePrintChar:
+  case opcodePrintBool:
+    Bytes(a, {0x4C, 0x89, 0xEF});
+    EmitMemory(a, 0, false, {0x8B}, cpuRsi, cpuR12, At(d - 1));
+    EmitCall(a, opcodePrintInt == instruction.opcode ? (const void*) &PrintInt :
+                opcodePrintChar == instruction.opcode ? (const void*) &PrintChar : (const void*) &PrintBool);
+    break;
+  case opcodePrintDouble:
+    Bytes(a, {0x4C, 0x89, 0xEF});
+    EmitMemory(a, 0xF2, false, {0x0F, 0x10}, cpuXmm0, cpuR12, At(d - 1));
+    EmitCall(a, (const void*) &PrintDouble);
+    break;
+
+  default:
+    EmitReturn(a, operand);
+    break;
+  }
+}
+
+/* The 64 bits of a constant entry */
+static uint64_t ConstantBits(const TAssembler& a, const TStackEntry& entry)
+{
+  uint64_t bits;
+  memcpy(&bits, &a.bytecode->doubles[entry.value], sizeof(bits));
+  return bits;
+}
+
+/* Write stack entry k to the stack's memory */
+static void Materialize(TAssembler& a, size_t k)
+{
+  TStackEntry& entry = a.stack[k];
+  switch (entry.kind)
+  {
+  case entryInt:
+    EmitMemory(a, 0, false, {0xC7}, 0, cpuR12, At(k));        /* mov dword [entry], value */
+    Int32(a, entry.value);
+    break;
+  case entryDouble:
+    Bytes(a, {0x48, 0xBA});                                   /* mov rdx, bits */
+    Int64(a, ConstantBits(a, entry));
+    EmitMemory(a, 0, true, {0x89}, cpuRdx, cpuR12, At(k));
+    break;
+  case entrySlot:
+    EmitMemory(a, 0, true, {0x8B}, cpuRdx, cpuRbx, At(entry.value));
+    EmitMemory(a, 0, true, {0x89}, cpuRdx, cpuR12, At(k));
+    break;
+  case entryRax:
+    EmitMemory(a, 0, true, {0x89}, cpuRax, cpuR12, At(k));
+    break;
+  case entryXmm0:
+    EmitMemory(a, 0xF2, false, {0x0F, 0x11}, cpuXmm0, cpuR12, At(k));
+    break;
+  default:
+    break;
+  }
+  entry.kind = entryMemory;
+}
+
+/* Every entry to memory, as jumps, jump targets and calls need them */
+static void Flush(TAssembler& a)
+{
+  for (size_t k = 0; k < a.stack.size(); ++k)
+    Materialize(a, k);
+}
+
+/* Free the register of an entry kind */
+static void Spill(TAssembler& a, TEntryEnum kind)
+{
+  for (size_t k = 0; k < a.stack.size(); ++k)
+    if (kind == a.stack[k].kind)
+      Materialize(a, k);
+}
+
+static void Push(TAssembler& a, TEntryEnum kind, int32_t value)
+{
+  TStackEntry entry;
+  entry.kind = kind;
+  entry.value = value;
+  a.stack.push_back(entry);
+}
+
+/* The int of entry k into eax, ecx or edx; an entry in eax stays there */
+static void LoadInt(TAssembler& a, unsigned reg, size_t k)
+{
+  const TStackEntry& entry = a.stack[k];
+  switch (entry.kind)
+  {
+  case entryInt:
+    Byte(a, 0xB8 + reg);                                      /* mov reg, value */
+    Int32(a, entry.value);
+    break;
+  case entrySlot:
+    EmitMemory(a, 0, false, {0x8B}, reg, cpuRbx, At(entry.value));
+    break;
+  case entryMemory:
+    EmitMemory(a, 0, false, {0x8B}, reg, cpuR12, At(k));
+    break;
+  case entryRax:
+    if (cpuRax != reg)
+      Bytes(a, {0x89, (uint8_t) (0xC0 | reg)});               /* mov reg, eax */
+    break;
+  default:
+    break;
+  }
+}
+
+/* The double of entry k into xmm0 or xmm1 */
+static void LoadDouble(TAssembler& a, unsigned reg, size_t k)
+{
+  const TStackEntry& entry = a.stack[k];
+  switch (entry.kind)
+  {
+  case entryDouble:
+    Bytes(a, {0x48, 0xBA});                                   /* mov rdx, bits */
+    Int64(a, ConstantBits(a, entry));
+    Bytes(a, {0x66, 0x48, 0x0F, 0x6E, (uint8_t) (0xC2 | reg << 3)});   /* movq reg, rdx */
+    break;
+  case entrySlot:
+    EmitMemory(a, 0xF2, false, {0x0F, 0x10}, reg, cpuRbx, At(entry.value));
+    break;
+  case entryMemory:
+    EmitMemory(a, 0xF2, false, {0x0F, 0x10}, reg, cpuR12, At(k));
+    break;
+  case entryXmm0:
+    if (cpuXmm0 != reg)
+      Bytes(a, {0x66, 0x0F, 0x28, (uint8_t) (0xC0 | reg << 3)});   /* movapd reg, xmm0 */
+    break;
+  default:
+    break;
+  }
+}
+
+/* The operands of a binary int instruction: the left one into eax, the
+   right one left where it is unless it was in eax, then it is in ecx */
+static void PrepareInts(TAssembler& a, size_t left, size_t right)
+{
+  if (entryRax == a.stack[right].kind)
+  {
+    Bytes(a, {0x89, 0xC1});                                   /* mov ecx, eax */
+    a.stack[right].kind = entryRcx;
+  }
+  else if (entryRax != a.stack[left].kind)
+    Spill(a, entryRax);
+  LoadInt(a, cpuRax, left);
+}
+
+/* op eax, right for an op of the form 0x0F? op /r */
+static void EmitIntOperation(TAssembler& a, std::initializer_list<uint8_t> opcode, size_t right)
+{
+  const TStackEntry& entry = a.stack[right];
+  if (entrySlot == entry.kind)
+    EmitMemory(a, 0, false, opcode, cpuRax, cpuRbx, At(entry.value));
+  else if (entryMemory == entry.kind)
+    EmitMemory(a, 0, false, opcode, cpuRax, cpuR12, At(right));
+  else
+  {
+    if (entryInt == entry.kind)
+      LoadInt(a, cpuRcx, right);
+    Bytes(a, opcode);
+    Byte(a, 0xC1);                                            /* eax, ecx */
+  }
+}
+
+/* Like PrepareInts with xmm0 and xmm1 */
+static void PrepareDoubles(TAssembler& a, size_t left, size_t right)
+{
+  if (entryXmm0 == a.stack[right].kind)
+  {
+    Bytes(a, {0x66, 0x0F, 0x28, 0xC8});                       /* movapd xmm1, xmm0 */
+    a.stack[right].kind = entryXmm1;
+  }
+  else if (entryXmm0 != a.stack[left].kind)
+    Spill(a, entryXmm0);
+  LoadDouble(a, cpuXmm0, left);
+  if (entryXmm1 != a.stack[right].kind)
+  {
+    LoadDouble(a, cpuXmm1, right);
+    a.stack[right].kind = entryXmm1;
+  }
+}
+
+/* Replace the top n entries with the result in a register */
+static void Result(TAssembler& a, size_t n, TEntryEnum kind)
+{
+  a.stack.resize(a.stack.size() - n);
+  Push(a, kind, 0);
+}
+
+/* The machine code of an instruction, its operands where the entries of
+   the stack say they are */
+static void EmitInstruction(TAssembler& a, const TInstruction& instruction, size_t divisionByZero,
+                            size_t noInput)
+{
+  size_t d = a.stack.size();
+  int32_t operand = instruction.operand;
+  switch (instruction.opcode)
+  {
+  case opcodeHalt:
+    EmitReturn(a, jitHalt);
+    return;
+  case opcodeError:
+    EmitReturn(a, operand);
+    return;
+  case opcodePushInt:
+    Push(a, entryInt, operand);
+    return;
+  case opcodePushDouble:
+    Push(a, entryDouble, operand);
+    return;
+  case opcodeLoad:
+    Push(a, entrySlot, operand);
+    return;
+  case opcodePop:
+    a.stack.pop_back();
+    return;
+  case opcodeStore:
+  {
+    /* the entries still to read the variable read it before the store */
+    for (size_t k = 0; k + 1 < d; ++k)
+      if (entrySlot == a.stack[k].kind && operand == a.stack[k].value)
+        Materialize(a, k);
+    const TStackEntry& value = a.stack[d - 1];
+    switch (value.kind)
+    {
+    case entryInt:
+      EmitMemory(a, 0, false, {0xC7}, 0, cpuRbx, At(operand));
+      Int32(a, value.value);
+      break;
+    case entryRax:
+      EmitMemory(a, 0, true, {0x89}, cpuRax, cpuRbx, At(operand));
+      break;
+    case entryXmm0:
+      EmitMemory(a, 0xF2, false, {0x0F, 0x11}, cpuXmm0, cpuRbx, At(operand));
+      break;
+    case entryDouble:
+      Bytes(a, {0x48, 0xBA});
+      Int64(a, ConstantBits(a, value));
+      EmitMemory(a, 0, true, {0x89}, cpuRdx, cpuRbx, At(operand));
+      break;
+    default:
+      EmitMemory(a, 0, true, {0x8B}, cpuRdx, entrySlot == value.kind ? cpuRbx : cpuR12,
+                 At(entrySlot == value.kind ? value.value : (int) d - 1));
+      EmitMemory(a, 0, true, {0x89}, cpuRdx, cpuRbx, At(operand));
+      break;
+    }
+    a.stack.pop_back();
+    return;
+  }
+
+  case opcodeAddInt:
+    PrepareInts(a, d - 2, d - 1);
+    EmitIntOperation(a, {0x03}, d - 1);
+    Result(a, 2, entryRax);
+    return;
+  case opcodeSubtractInt:
+    PrepareInts(a, d - 2, d - 1);
+    EmitIntOperation(a, {0x2B}, d - 1);
+    Result(a, 2, entryRax);
+    return;
+  case opcodeMultiplyInt:
+    PrepareInts(a, d - 2, d - 1);
+    EmitIntOperation(a, {0x0F, 0xAF}, d - 1);
+    Result(a, 2, entryRax);
+    return;
+  case opcodeDivideInt:
+    PrepareInts(a, d - 2, d - 1);
+    if (entryRcx != a.stack[d - 1].kind)
+      LoadInt(a, cpuRcx, d - 1);
+    Bytes(a, {0x85, 0xC9});                                   /* test ecx, ecx */
+    EmitJump(a, {0x0F, 0x84}, divisionByZero);
+    Bytes(a, {0x83, 0xF9, 0xFF, 0x75, 0x04, 0xF7, 0xD8, 0xEB, 0x03, 0x99, 0xF7, 0xF9});
+    Result(a, 2, entryRax);
+    return;
+  case opcodeLessInt:
+  case opcodeGreaterInt:
+  case opcodeLessEqualInt:
+  case opcodeGreaterEqualInt:
+  case opcodeEqualInt:
+  case opcodeNotEqualInt:
+  {
+    static const uint8_t conditions[] =
+    {
+      SET_LESS, SET_GREATER, SET_LESS_EQUAL, SET_GREATER_EQUAL, SET_EQUAL, SET_NOT_EQUAL
+    };
+    PrepareInts(a, d - 2, d - 1);
+    EmitIntOperation(a, {0x3B}, d - 1);                       /* cmp eax, right */
+    Bytes(a, {0x0F, conditions[instruction.opcode - opcodeLessInt], 0xC0, 0x0F, 0xB6, 0xC0});
+    Result(a, 2, entryRax);
+    return;
+  }
+  case opcodeNegateInt:
+  case opcodeIntToChar:
+  case opcodeIntToBool:
+    if (entryRax != a.stack[d - 1].kind)
+      Spill(a, entryRax);
+    LoadInt(a, cpuRax, d - 1);
+    if (opcodeNegateInt == instruction.opcode)
+      Bytes(a, {0xF7, 0xD8});                                 /* neg eax */
+    else if (opcodeIntToChar == instruction.opcode)
+      Bytes(a, {0x0F, 0xBE, 0xC0});                           /* movsx eax, al */
+    else
+      Bytes(a, {0x85, 0xC0, 0x0F, SET_NOT_EQUAL, 0xC0, 0x0F, 0xB6, 0xC0});
+    Result(a, 1, entryRax);
+    return;
+
+  case opcodeAddDouble:
+  case opcodeSubtractDouble:
+  case opcodeMultiplyDouble:
+  case opcodeDivideDouble:
+  {
+    static const uint8_t operations[] = {0x58, 0x5C, 0x59, 0x5E};
+    PrepareDoubles(a, d - 2, d - 1);
+    Bytes(a, {0xF2, 0x0F, operations[instruction.opcode - opcodeAddDouble], 0xC1});   /* op xmm0, xmm1 */
+    Result(a, 2, entryXmm0);
+    return;
+  }
+  case opcodeLessDouble:
+  case opcodeGreaterDouble:
+  case opcodeLessEqualDouble:
+  case opcodeGreaterEqualDouble:
+  case opcodeEqualDouble:
+  case opcodeNotEqualDouble:
+  {
+    Spill(a, entryRax);
+    PrepareDoubles(a, d - 2, d - 1);
+    bool swapped = opcodeLessDouble == instruction.opcode || opcodeLessEqualDouble == instruction.opcode;
+    Bytes(a, {0x66, 0x0F, 0x2E, (uint8_t) (swapped ? 0xC8 : 0xC1)});   /* ucomisd */
+    switch (instruction.opcode)
+    {
+    case opcodeLessDouble:
+    case opcodeGreaterDouble:
+      Bytes(a, {0x0F, SET_ABOVE, 0xC0});
+      break;
+    case opcodeLessEqualDouble:
+    case opcodeGreaterEqualDouble:
+      Bytes(a, {0x0F, SET_ABOVE_EQUAL, 0xC0});
+      break;
+    case opcodeEqualDouble:
+      Bytes(a, {0x0F, 0x9B, 0xC1, 0x0F, SET_EQUAL, 0xC0, 0x20, 0xC8});       /* ordered and equal */
+      break;
+    default:
+      Bytes(a, {0x0F, 0x9A, 0xC1, 0x0F, SET_NOT_EQUAL, 0xC0, 0x08, 0xC8});   /* unordered or not */
+      break;
+    }
+    Bytes(a, {0x0F, 0xB6, 0xC0});                             /* movzx eax, al */
+    Result(a, 2, entryRax);
+    return;
+  }
+  case opcodeNegateDouble:
+    if (entryXmm0 != a.stack[d - 1].kind)
+      Spill(a, entryXmm0);
+    LoadDouble(a, cpuXmm0, d - 1);
+    Bytes(a, {0x48, 0xBA});                                   /* mov rdx, sign bit */
+    Int64(a, 0x8000000000000000ull);
+    Bytes(a, {0x66, 0x48, 0x0F, 0x6E, 0xCA});                 /* movq xmm1, rdx */
+    Bytes(a, {0x66, 0x0F, 0x57, 0xC1});                       /* xorpd xmm0, xmm1 */
+    Result(a, 1, entryXmm0);
+    return;
+  case opcodeIntToDouble:
+  {
+    Spill(a, entryXmm0);
+    const TStackEntry& value = a.stack[d - 1];
+    if (entrySlot == value.kind)
+      EmitMemory(a, 0xF2, false, {0x0F, 0x2A}, cpuXmm0, cpuRbx, At(value.value));   /* cvtsi2sd */
+    else if (entryMemory == value.kind)
+      EmitMemory(a, 0xF2, false, {0x0F, 0x2A}, cpuXmm0, cpuR12, At(d - 1));
+    else if (entryRax == value.kind)
+      Bytes(a, {0xF2, 0x0F, 0x2A, 0xC0});                     /* cvtsi2sd xmm0, eax */
+    else
+    {
+      LoadInt(a, cpuRdx, d - 1);
+      Bytes(a, {0xF2, 0x0F, 0x2A, 0xC2});                     /* cvtsi2sd xmm0, edx */
+    }
+    Result(a, 1, entryXmm0);
+    return;
+  }
+
+  case opcodeJump:
+    Flush(a);
+    EmitJump(a, {0xE9}, operand);
+    return;
+  case opcodeJumpIfFalseInt:
+  {
+    /* the others to memory first, the condition may be in eax */
+    TStackEntry condition = a.stack[d - 1];
+    a.stack.pop_back();
+    Flush(a);
+    a.stack.push_back(condition);
+    if (entryInt == condition.kind)
+    {
+      if (0 == condition.value)
+        EmitJump(a, {0xE9}, operand);
+    }
+    else
+    {
+      LoadInt(a, cpuRax, d - 1);
+      Bytes(a, {0x85, 0xC0});                                 /* test eax, eax */
+      EmitJump(a, {0x0F, 0x84}, operand);
+    }
+    a.stack.pop_back();
+    return;
+  }
+
+  default:
+    /* calls, and what is rare enough to run from memory */
+    Flush(a);
+    EmitInMemory(a, *a.bytecode, instruction, (int) d, divisionByZero, noInput);
+    a.stack.resize(d + OpcodeStackEffect(instruction.opcode));   /* new entries are entryMemory */
+    return;
+  }
+}
+
+bool CompileJit(TJitCode& jit, const TBytecode& bytecode)
+{
+  jit.code = NULL;
+  jit.size = 0;
+  jit.mapped = 0;
+  const std::vector<TInstruction>& code = bytecode.code;
+  TAssembler a;
+  a.bytecode = &bytecode;
+  std::vector<int> depths;
+  std::vector<bool> targets;
+  try
+  {
+    if (!FindDepths(bytecode, depths, targets))
+      return false;
+
+    /* the stubs the runtime errors jump to follow the code */
+    size_t divisionByZero = code.size(), noInput = code.size() + 1;
+    a.labels.assign(code.size() + 2, 0);
+    Bytes(a, {0x53, 0x41, 0x54, 0x41, 0x55});                /* push rbx, r12, r13 */
+    Bytes(a, {0x48, 0x89, 0xFB});                             /* mov rbx, rdi */
+    Bytes(a, {0x49, 0x89, 0xF4});                             /* mov r12, rsi */
+    Bytes(a, {0x49, 0x89, 0xD5});                             /* mov r13, rdx */
+    bool fallsThrough = false;
+    for (size_t i = 0; i < code.size(); ++i)
+    {
+      if (depths[i] < 0)
+      {
+        a.labels[i] = a.bytes.size();
+        fallsThrough = false;
+        continue;
+      }
+      /* the jumps here find the whole stack in memory */
+      if (targets[i] && fallsThrough)
+        Flush(a);
+      a.labels[i] = a.bytes.size();
+      if (targets[i] || !fallsThrough)
+      {
+        TStackEntry entry;
+        entry.kind = entryMemory;
+        entry.value = 0;
+        a.stack.assign(depths[i], entry);
+      }
+      EmitInstruction(a, code[i], divisionByZero, noInput);
+      unsigned opcode = code[i].opcode;
+      fallsThrough = opcodeJump != opcode && opcodeHalt != opcode && opcodeError != opcode;
+    }
+    a.labels[divisionByZero] = a.bytes.size();
+    EmitReturn(a, jitDivisionByZero);
+    a.labels[noInput] = a.bytes.size();
+    EmitReturn(a, jitNoInput);
+  }
+  catch (std::bad_alloc& ba)
+  {
+    perror("out of space");
+    exit(0);
+  }
+  for (const TJitFixup& fixup : a.fixups)
+  {
+    int32_t offset = (int32_t) (a.labels[fixup.target] - (fixup.at + 4));
+    memcpy(&a.bytes[fixup.at], &offset, sizeof(offset));
+  }
+
+  /* written while the pages are writable, run once they are executable */
+  size_t page = (size_t) sysconf(_SC_PAGESIZE);
+  size_t mapped = (a.bytes.size() + page - 1) / page * page;
+  void* pages = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == pages)
+    return false;
+  memcpy(pages, a.bytes.data(), a.bytes.size());
+  if (0 != mprotect(pages, mapped, PROT_READ | PROT_EXEC))
+  {
+    munmap(pages, mapped);
+    return false;
+  }
+  jit.code = pages;
+  jit.size = a.bytes.size();
+  jit.mapped = mapped;
+  return true;
+}
+
+void ReleaseJit(TJitCode& jit)
+{
+  if (NULL != jit.code)
+    munmap(jit.code, jit.mapped);
+  jit.code = NULL;
+}
+
+#endif
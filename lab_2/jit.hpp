@@ -0,0 +1,37 @@
+/* Baseline compiler of stack machine bytecode to x86-64 machine code */
+
+#ifndef _JIT_HPP
+#define _JIT_HPP
+
+#include <cstddef>
+#include "bytecode.hpp"
+
+/* Machine code is generated for x86-64 Linux (System V calls, mmap'd
+   pages); elsewhere every program runs on the stack machine */
+#if defined __x86_64__ && defined __linux__
+#define JIT_X86_64 1
+#endif
+
+/* Native code of a program, in executable pages of its own */
+typedef struct
+{
+  void* code;       /* NULL when the bytecode was not compiled */
+  size_t size;      /* bytes of machine code */
+  size_t mapped;    /* bytes of the pages */
+} TJitCode;
+
+/* Translate bytecode compiled without superinstructions, each instruction
+   into a template of machine code. False when it cannot: an instruction
+   or platform the compiler does not know, or no executable memory; the
+   stack machine then runs the bytecode. */
+bool CompileJit(TJitCode& jit, const TBytecode& bytecode);
+
+/* Unmap the code */
+void ReleaseJit(TJitCode& jit);
+
+/* Run the compiled program on the machine's slots and stack, which
+   InitStackMachine set up for the same bytecode; false on a runtime
+   error, which is described in vm.error. No dispatches are counted. */
+bool RunJit(TStackMachine& vm, const TJitCode& jit);
+
+#endif
@@ -1,32 +1,497 @@
 #include <iostream>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <sys/stat.h>
 #include "simpl-driver.hpp"
+#include "interpreter.hpp"
+#include "bytecode.hpp"
+#include "regvm.hpp"
+#include "jit.hpp"
+#include "simpl-jobs.hpp"
 
-int main(int argc, char* argv[])
+// Number of read-like system calls made so far (Linux), -1 if unknown.
+static long ReadSyscallCount()
+{
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    long value;
+    while (io >> key >> value)
+    {
+        if (key == "syscr:")
+            return value;
+    }
+    return -1;
+}
+
+// Scan a file without parsing and report the scanner throughput.
+static int LexOnly(Simpl_driver& driver, const std::string& filename)
+{
+    std::ostream& out = *driver.out;
+    long syscallsBefore = ReadSyscallCount();
+    auto start = std::chrono::steady_clock::now();
+    long tokens = driver.lex(filename);
+    auto stop = std::chrono::steady_clock::now();
+    long syscallsAfter = ReadSyscallCount();
+    if (tokens < 0)
+        return 1;
+
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    out << filename << ": " << tokens << " tokens, " << seconds << " s";
+
+    struct stat info;
+    if (stat(filename.c_str(), &info) == 0 && S_ISREG(info.st_mode) && seconds > 0)
+        out << ", " << info.st_size / seconds / 1e6 << " MB/s";
+    if (syscallsBefore >= 0 && syscallsAfter >= 0)
+        out << ", " << syscallsAfter - syscallsBefore << " read syscalls";
+    out << std::endl;
+    return 0;
+}
+
+typedef struct
+{
+    yy::Parser::token_type kind;
+    TSourceSpan location;
+    yy::Parser::semantic_type value;
+} TScannedToken;
+
+// Scan the whole file with the scanner the driver is set to use,
+// returns the time it took or -1 if the file cannot be read.
+static double ScanAll(Simpl_driver& driver, const std::string& filename,
+                      std::vector<TScannedToken>& tokens)
+{
+    driver.filename = filename;
+    if (!driver.scan_begin())
+        return -1;
+    auto start = std::chrono::steady_clock::now();
+    TScannedToken t;
+    do
+    {
+        memset(&t.value, 0, sizeof(t.value));
+        t.kind = driver.scan(&t.value, &t.location);
+        tokens.push_back(t);
+    } while (t.kind != yy::Parser::token::EOFILE);
+    auto stop = std::chrono::steady_clock::now();
+    driver.scan_end();
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+static bool SameToken(const TScannedToken& a, const TScannedToken& b)
+{
+    typedef yy::Parser::token token;
+    if (a.kind != b.kind || a.location.begin != b.location.begin || a.location.end != b.location.end)
+        return false;
+    switch (a.kind)
+    {
+    case token::VARIABLE:    return a.value.var == b.value.var;
+    case token::INTCONST:    return a.value.i == b.value.i;
+    case token::NUMBER:      return 0 == memcmp(&a.value.d, &b.value.d, sizeof(double));
+    case token::MULOPERATOR:
+    case token::RELOP:       return 0 == strcmp(a.value.s, b.value.s);
+    default:                 return true;
+    }
+}
+
+// Differential check: the hand-written scanner must return the same
+// tokens, values and locations as the flex one. Reports both speeds.
+static int LexCheck(Simpl_driver& driver, const std::string& filename)
+{
+    if (!driver.mmap_input)
+    {
+        *driver.err << "-lexcheck needs in-memory sources, drop -stdio" << std::endl;
+        return 1;
+    }
+    bool fast = driver.fast_scanning;
+    std::vector<TScannedToken> expected, actual;
+    // both scans intern into the same table, so equal names are equal pointers
+    ClearIdentifierTable(driver.identifiers);
+    driver.fast_scanning = false;
+    double flexSeconds = ScanAll(driver, filename, expected);
+    driver.fast_scanning = true;
+    double fastSeconds = ScanAll(driver, filename, actual);
+    driver.fast_scanning = fast;
+    if (flexSeconds < 0 || fastSeconds < 0)
+        return 1;
+
+    size_t i = 0;
+    while (i < expected.size() && i < actual.size() && SameToken(expected[i], actual[i]))
+        ++i;
+    if (i < expected.size() || i < actual.size())
+    {
+        const TScannedToken& e = expected[std::min(i, expected.size() - 1)];
+        const TScannedToken& a = actual[std::min(i, actual.size() - 1)];
+        *driver.out << filename << ": token " << i << " differs: flex " << e.kind << " at "
+                  << e.location << ", hand-written " << a.kind << " at " << a.location << std::endl;
+        return 1;
+    }
+
+    *driver.out << filename << ": " << expected.size() << " tokens match, flex " << flexSeconds
+              << " s, hand-written " << fastSeconds << " s" << std::endl;
+    return 0;
+}
+
+typedef enum
+{
+    engineAst,
+    engineStack,
+    engineRegister,
+    engineJit
+} TEngine;
+
+// Parse the whole file and execute it on the engine, reading input() from
+// standard input; the stack, register and JIT engines can list their code
+// first. The JIT compiles the stack engine's bytecode to machine code and
+// leaves what it cannot compile to the stack engine. With a profile the
+// stack engine runs the code as compiled, without superinstructions, and
+// counts the sequences it dispatches. The stats are what the engine did:
+// the tree-walker counts the operators that still checked their operand
+// types, the virtual machines their dispatches, the JIT its code size.
+// Returns 0 unless it does not parse or stops on a runtime error.
+static int Run(Simpl_driver& driver, const std::string& filename, TEngine engine, bool bytecodeDumping,
+               TOpcodeProfile* profile, bool statsDumping)
+{
+    if (driver.streaming)
+    {
+        *driver.err << "-run needs the whole program, drop -stream" << std::endl;
+        return 1;
+    }
+    driver.keep_ast = true;
+    if (driver.parse(filename))
+        return 1;
+    bool done;
+    std::string error;
+    std::ostringstream stats;
+    if (engineAst == engine)
+    {
+        TInterpreter vm;
+        InitInterpreter(vm, driver.tree, std::cin, *driver.out);
+        done = RunProgram(vm, driver.ast);
+        error = vm.error;
+        stats << vm.steps << " statements, " << vm.operations << " operators, "
+              << vm.unspecialized << " unspecialized";
+    }
+    else if (engineRegister == engine)
+    {
+        TRegisterCode code;
+        CompileRegisterCode(code, driver.tree, driver.ast);
+        if (bytecodeDumping)
+            PrintRegisterCode(code, *driver.out);
+        TRegisterMachine vm;
+        InitRegisterMachine(vm, code, std::cin, *driver.out);
+        done = RunRegisterCode(vm);
+        error = vm.error;
+        stats << vm.dispatches << " dispatches";
+    }
+    else if (engineJit == engine)
+    {
+        TBytecode bytecode;
+        CompileBytecode(bytecode, driver.tree, driver.ast, 0);
+        if (bytecodeDumping)
+            PrintBytecode(bytecode, *driver.out);
+        TStackMachine vm;
+        InitStackMachine(vm, bytecode, std::cin, *driver.out);
+        TJitCode jit;
+        if (CompileJit(jit, bytecode))
+        {
+            done = RunJit(vm, jit);
+            stats << jit.size << " bytes of machine code";
+        }
+        else
+        {
+            done = RunBytecode(vm);
+            stats << "not compiled, " << vm.dispatches << " dispatches";
+        }
+        ReleaseJit(jit);
+        error = vm.error;
+    }
+    else
+    {
+        TBytecode bytecode;
+        CompileBytecode(bytecode, driver.tree, driver.ast, NULL != profile ? 0 : ALL_SUPERINSTRUCTIONS);
+        if (bytecodeDumping)
+            PrintBytecode(bytecode, *driver.out);
+        TStackMachine vm;
+        InitStackMachine(vm, bytecode, std::cin, *driver.out);
+        done = NULL != profile ? ProfileBytecode(vm, *profile) : RunBytecode(vm);
+        error = vm.error;
+        stats << vm.dispatches << " dispatches";
+    }
+    if (!done)
+        *driver.err << filename << ": runtime error: " << error << std::endl;
+    if (statsDumping)
+        *driver.err << filename << ": " << stats.str() << std::endl;
+    driver.result = done ? 0 : 1;
+    DestroyUserVariableTable(driver.ast_symbols);
+    driver.ast_symbols = NULL;
+    return driver.result;
+}
+
+typedef enum
+{
+    modeParse,
+    modeLex,
+    modeLexCheck,
+    modeRun
+} TCompilationMode;
+
+// A file of the command line with the options in force where it appears,
+// and what compiling it printed.
+typedef struct
+{
+    std::string filename;
+    TCompilationMode mode;
+    bool astDumping;
+    bool xmlDumping;
+    std::string xmlPath;
+    bool mmapInput;
+    bool pipelined;
+    bool streaming;
+    bool fastScanning;
+    bool foldingConstants;
+    TEngine engine;
+    bool bytecodeDumping;
+    TOpcodeProfile* profile;    // shared by the files of the command line
+    bool statsDumping;
+
+    std::ostringstream out;
+    std::ostringstream err;
+    int result;
+    bool done;
+} TCompilation;
+
+typedef struct
+{
+    std::vector<TCompilation*> files;
+    std::mutex lock;
+    std::condition_variable finished;
+} TCompilationBatch;
+
+// Compile a file in a context of its own, returns 0 on success.
+static int Compile(TCompilation& c, std::ostream& out, std::ostream& err)
 {
-    int res = 0;
     Simpl_driver driver;
-    driver.AST_dumping = false;
-    driver.XML_dumping = false;
-    driver.XML_dumping_path = "";
+    driver.AST_dumping = c.astDumping;
+    driver.XML_dumping = c.xmlDumping;
+    driver.XML_dumping_path = c.xmlPath;
+    driver.mmap_input = c.mmapInput;
+    driver.pipelined = c.pipelined;
+    driver.streaming = c.streaming;
+    driver.fast_scanning = c.fastScanning;
+    driver.folding_constants = c.foldingConstants;
+    driver.out = &out;
+    driver.err = &err;
+
+    switch (c.mode)
+    {
+    case modeLexCheck:
+        return LexCheck(driver, c.filename);
+    case modeLex:
+        return LexOnly(driver, c.filename);
+    case modeRun:
+        return Run(driver, c.filename, c.engine, c.bytecodeDumping, c.profile, c.statsDumping);
+    case modeParse:
+        break;
+    }
+    if (driver.parse(c.filename))
+        return 1;
+    if (driver.folding_constants)
+        out << c.filename << ": " << driver.folded_nodes.removed << " nodes freed by folding, "
+            << driver.folded_nodes.unreachable << " left unreachable" << std::endl;
+    out << driver.result << std::endl;
+    return 0;
+}
+
+static void CompileJob(size_t index, void* context)
+{
+    TCompilationBatch* batch = static_cast<TCompilationBatch*>(context);
+    TCompilation& c = *batch->files[index];
+    c.result = Compile(c, c.out, c.err);
+    std::lock_guard<std::mutex> guard(batch->lock);
+    c.done = true;
+    batch->finished.notify_all();
+}
+
+// Compile the files on a pool of threads; what each file prints is
+// written out in command line order as soon as its turn comes.
+static int CompileParallel(TCompilationBatch& batch, unsigned threads)
+{
+    std::thread pool(RunJobs, threads, batch.files.size(), CompileJob, &batch);
+    int res = 0;
+    for (auto i = 0u; i < batch.files.size(); ++i)
+    {
+        TCompilation& c = *batch.files[i];
+        {
+            std::unique_lock<std::mutex> guard(batch.lock);
+            batch.finished.wait(guard, [&c] { return c.done; });
+        }
+        std::cout << c.out.str() << std::flush;
+        std::cerr << c.err.str() << std::flush;
+        res |= c.result;
+        c.out.str("");
+        c.err.str("");
+    }
+    pool.join();
+    return res;
+}
+
+int main(int argc, char* argv[])
+{
+    TCompilationMode mode = modeParse;
+    TCompilation options;
+    options.astDumping = false;
+    options.xmlDumping = false;
+    options.xmlPath = "";
+    options.mmapInput = true;
+    options.pipelined = false;
+    options.streaming = false;
+    options.fastScanning = false;
+    options.foldingConstants = false;
+    options.engine = engineStack;
+    options.bytecodeDumping = false;
+    options.profile = NULL;
+    options.statsDumping = false;
+    TOpcodeProfile profile;
+    std::string profilePath;
+    unsigned threads = 0;
+    bool running = false;
+    TCompilationBatch batch;
 
     for (auto i = 1; i < argc; ++i)
     {
         if (argv[i] == std::string("-ast"))
         {
-            driver.AST_dumping = true;
+            options.astDumping = true;
         }
         else if (argv[i] == std::string("-xml") && i < argc - 1)
         {
-            driver.XML_dumping = true;
-            driver.XML_dumping_path = std::string(argv[++i]);
+            options.xmlDumping = true;
+            options.xmlPath = std::string(argv[++i]);
+        }
+        else if (argv[i] == std::string("-stdio"))
+        {
+            options.mmapInput = false;
+        }
+        else if (argv[i] == std::string("-pipeline"))
+        {
+            options.pipelined = true;
+        }
+        else if (argv[i] == std::string("-stream"))
+        {
+            options.streaming = true;
         }
-        else if (!driver.parse(argv[i]))
+        else if (argv[i] == std::string("-fastlex"))
         {
-            std::cout << driver.result << std::endl;
+            options.fastScanning = true;
+        }
+        else if (argv[i] == std::string("-fold"))
+        {
+            options.foldingConstants = true;
+        }
+        else if (argv[i] == std::string("-lex"))
+        {
+            mode = modeLex;
+        }
+        else if (argv[i] == std::string("-lexcheck"))
+        {
+            mode = modeLexCheck;
+        }
+        else if (argv[i] == std::string("-run"))
+        {
+            mode = modeRun;
+        }
+        else if (argv[i] == std::string("-engine") && i < argc - 1)
+        {
+            std::string engine(argv[++i]);
+            if (engine == "ast")
+                options.engine = engineAst;
+            else if (engine == "stack")
+                options.engine = engineStack;
+            else if (engine == "register")
+                options.engine = engineRegister;
+            else if (engine == "jit")
+                options.engine = engineJit;
+            else
+            {
+                std::cerr << "unknown engine " << engine << ", use ast, stack, register or jit" << std::endl;
+                return 1;
+            }
+        }
+        else if (argv[i] == std::string("-bytecode"))
+        {
+            options.bytecodeDumping = true;
+        }
+        else if (argv[i] == std::string("-stats"))
+        {
+            options.statsDumping = true;
+        }
+        else if (argv[i] == std::string("-profile") && i < argc - 1)
+        {
+            // candidate superinstructions.def for the sequences the stack
+            // engine runs most often in the files that follow
+            InitOpcodeProfile(profile);
+            options.profile = &profile;
+            profilePath = argv[++i];
+        }
+        else if (argv[i] == std::string("-j") && i < argc - 1)
+        {
+            // -j 0 uses every processor
+            threads = (unsigned) atoi(argv[++i]);
+            if (0 == threads)
+                threads = std::max(1u, std::thread::hardware_concurrency());
         }
         else
         {
-            res = 1;
+            TCompilation* c = new TCompilation;
+            c->filename = argv[i];
+            c->mode = mode;
+            c->astDumping = options.astDumping;
+            c->xmlDumping = options.xmlDumping;
+            c->xmlPath = options.xmlPath;
+            c->mmapInput = options.mmapInput;
+            c->pipelined = options.pipelined;
+            c->streaming = options.streaming;
+            c->fastScanning = options.fastScanning;
+            c->foldingConstants = options.foldingConstants;
+            c->engine = options.engine;
+            c->bytecodeDumping = options.bytecodeDumping;
+            c->profile = options.profile;
+            c->statsDumping = options.statsDumping;
+            c->result = 0;
+            c->done = false;
+            running |= modeRun == mode;
+            batch.files.push_back(c);
+        }
+    }
+
+    int res = 0;
+    // the profile is not shared between threads, and programs that run
+    // read std::cin one after the other, in command-line order
+    if (threads > 1 && batch.files.size() > 1 && NULL == options.profile && !running)
+        res = CompileParallel(batch, threads);
+    else
+    {
+        // one file at a time, printing as it goes
+        for (auto i = 0u; i < batch.files.size(); ++i)
+            res |= Compile(*batch.files[i], std::cout, std::cerr);
+    }
+
+    for (auto i = 0u; i < batch.files.size(); ++i)
+        delete batch.files[i];
+    if (NULL != options.profile)
+    {
+        std::ofstream def(profilePath);
+        WriteSuperinstructions(profile, def);
+        if (!def)
+        {
+            std::cerr << "cannot write " << profilePath << std::endl;
+            return 1;
         }
     }
     return res;
@@ -0,0 +1,826 @@
+/*
+* Three-address code compiler and register machine
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+#include "regvm.hpp"
+
+/* Which fields of an instruction are used, and how */
+typedef enum
+{
+  shapeNone,          /* halt */
+  shapeUnary,         /* a = op b */
+  shapeBinary,        /* a = b op c */
+  shapeJump,          /* target a */
+  shapeBranch,        /* target a, condition b */
+  shapeRegister,      /* a */
+  shapeError          /* message a */
+} TShapeEnum;
+
+typedef struct
+{
+  const char* name;
+  TShapeEnum shape;
+} TRegisterOpcodeInfo;
+
+/* By TRegisterOpcodeEnum */
+static const TRegisterOpcodeInfo g_RegisterOpcodes[] =
+{
+  {"halt",                 shapeNone},
+  {"move",                 shapeUnary},
+  {"add_int",              shapeBinary},
+  {"subtract_int",         shapeBinary},
+  {"multiply_int",         shapeBinary},
+  {"divide_int",           shapeBinary},
+  {"negate_int",           shapeUnary},
+  {"less_int",             shapeBinary},
+  {"greater_int",          shapeBinary},
+  {"less_equal_int",       shapeBinary},
+  {"greater_equal_int",    shapeBinary},
+  {"equal_int",            shapeBinary},
+  {"not_equal_int",        shapeBinary},
+  {"add_double",           shapeBinary},
+  {"subtract_double",      shapeBinary},
+  {"multiply_double",      shapeBinary},
+  {"divide_double",        shapeBinary},
+  {"negate_double",        shapeUnary},
+  {"less_double",          shapeBinary},
+  {"greater_double",       shapeBinary},
+  {"less_equal_double",    shapeBinary},
+  {"greater_equal_double", shapeBinary},
+  {"equal_double",         shapeBinary},
+  {"not_equal_double",     shapeBinary},
+  {"int_to_double",        shapeUnary},
+  {"double_to_int",        shapeUnary},
+  {"int_to_char",          shapeUnary},
+  {"int_to_bool",          shapeUnary},
+  {"double_to_bool",       shapeUnary},
+  {"jump",                 shapeJump},
+  {"jump_if_false_int",    shapeBranch},
+  {"jump_if_false_double", shapeBranch},
+  {"input_int",            shapeRegister},
+  {"input_double",         shapeRegister},
+  {"input_char",           shapeRegister},
+  {"input_bool",           shapeRegister},
+  {"print_int",            shapeRegister},
+  {"print_double",         shapeRegister},
+  {"print_char",           shapeRegister},
+  {"print_bool",           shapeRegister},
+  {"error",                shapeError}
+};
+
+static_assert(sizeof(g_RegisterOpcodes) / sizeof(g_RegisterOpcodes[0]) == regError + 1,
+              "every opcode is described");
+
+/* Instructions of TOperatorEnum operators */
+static const TRegisterOpcodeEnum g_IntOperators[] =
+{
+  regHalt, regAddInt, regSubtractInt, regMultiplyInt, regDivideInt,
+  regLessInt, regGreaterInt, regLessEqualInt, regGreaterEqualInt,
+  regEqualInt, regNotEqualInt
+};
+
+static const TRegisterOpcodeEnum g_DoubleOperators[] =
+{
+  regHalt, regAddDouble, regSubtractDouble, regMultiplyDouble, regDivideDouble,
+  regLessDouble, regGreaterDouble, regLessEqualDouble, regGreaterEqualDouble,
+  regEqualDouble, regNotEqualDouble
+};
+
+/* Labels of the loop being compiled */
+typedef struct
+{
+  std::vector<size_t> continues;  /* jumps to the test or the step */
+  std::vector<size_t> breaks;     /* jumps to the end of the loop */
+} TLoopLabels;
+
+typedef struct
+{
+  TRegisterCode* code;
+  const TAst* tree;
+  std::unordered_map<TNodeIndex, int32_t> constants;   /* registers of the typeConst nodes */
+  std::vector<TLoopLabels> loops;
+  int32_t firstTemporary;
+  int32_t nextTemporary;          /* of the statement being compiled */
+} TRegisterCompiler;
+
+static bool IsArray(SubexpressionValueTypeEnum type)
+{
+  return type >= typeIntArray;
+}
+
+static bool IsComparison(TOperatorEnum op)
+{
+  return op >= opLess && op <= opNotEqual;
+}
+
+static size_t Emit(TRegisterCompiler& c, TRegisterOpcodeEnum opcode, int32_t a = 0, int32_t b = 0, int32_t d = 0)
+{
+  TRegisterInstruction instruction;
+  instruction.opcode = opcode;
+  instruction.a = a;
+  instruction.b = b;
+  instruction.c = d;
+  try
+  {
+    c.code->code.push_back(instruction);
+  }
+  catch (std::bad_alloc& ba)
+  {
+    perror("out of space");
+    exit(0);
+  }
+  return c.code->code.size() - 1;
+}
+
+/* Stop the program with a runtime error */
+static void EmitError(TRegisterCompiler& c, const char* message)
+{
+  c.code->errors.push_back(message);
+  Emit(c, regError, (int32_t) c.code->errors.size() - 1);
+}
+
+static int32_t Here(const TRegisterCompiler& c)
+{
+  return (int32_t) c.code->code.size();
+}
+
+static int32_t NewTemporary(TRegisterCompiler& c)
+{
+  int32_t r = c.nextTemporary++;
+  if ((unsigned) c.nextTemporary > c.code->registers)
+    c.code->registers = c.nextTemporary;
+  return r;
+}
+
+/* The register of every constant node of the tree; pooled literals share
+   a node, so each is loaded once */
+static void AllocateConstants(TRegisterCompiler& c)
+{
+  const std::vector<TNode>& nodes = c.tree->nodes;
+  for (TNodeIndex a = 1; a < nodes.size(); ++a)
+  {
+    const TNode& node = nodes[a];
+    if (typeConst != node.nodetype)
+      continue;
+    TValue value;
+    memset(&value, 0, sizeof(value));
+    switch (node.valueType)
+    {
+    case typeInt:    value.iNumber = node.iNumber; break;
+    case typeChar:   value.iNumber = node.cNumber; break;
+    case typeBool:   value.iNumber = node.bNumber; break;
+    case typeDouble: value.dNumber = node.dNumber; break;
+    default:         value.array = node.iArrayNumber; break;
+    }
+    try
+    {
+      c.constants[a] = c.code->firstConstant + (int32_t) c.code->constants.size();
+      c.code->constants.push_back(value);
+      c.code->constantTypes.push_back((SubexpressionValueTypeEnum) node.valueType);
+    }
+    catch (std::bad_alloc& ba)
+    {
+      perror("out of space");
+      exit(0);
+    }
+  }
+}
+
+/* The register holding the value converted as an assignment converts it */
+static int32_t CompileConversion(TRegisterCompiler& c, int32_t r, SubexpressionValueTypeEnum from,
+                                 SubexpressionValueTypeEnum to)
+{
+  if (from == to)
+    return r;
+  if (IsArray(from) || IsArray(to))
+  {
+    EmitError(c, "an array does not convert to another type");
+    return 0;
+  }
+  if (typeInt == to && typeDouble != from)
+    return r;
+  int32_t t = NewTemporary(c);
+  switch (to)
+  {
+  case typeDouble:
+    Emit(c, regIntToDouble, t, r);
+    break;
+  case typeChar:
+    if (typeDouble == from)
+    {
+      Emit(c, regDoubleToInt, t, r);
+      r = t;
+    }
+    Emit(c, regIntToChar, t, r);
+    break;
+  case typeBool:
+    Emit(c, typeDouble == from ? regDoubleToBool : regIntToBool, t, r);
+    break;
+  default:
+    Emit(c, regDoubleToInt, t, r);
+    break;
+  }
+  return t;
+}
+
+static int32_t CompileExpression(TRegisterCompiler& c, TNodeIndex a);
+
+/* Operands of mixed types are computed as doubles, the result has the
+   type of the operator node */
+static int32_t CompileBinary(TRegisterCompiler& c, const TNode& node)
+{
+  SubexpressionValueTypeEnum leftType = NodeValueType(*c.tree, node.first);
+  SubexpressionValueTypeEnum rightType = NodeValueType(*c.tree, node.second);
+  bool arrays = IsArray(leftType) || IsArray(rightType);
+  bool doubles = !arrays && (typeDouble == leftType || typeDouble == rightType);
+
+  int32_t left = CompileExpression(c, node.first);
+  if (doubles)
+    left = CompileConversion(c, left, leftType, typeDouble);
+  int32_t right = CompileExpression(c, node.second);
+  if (doubles)
+    right = CompileConversion(c, right, rightType, typeDouble);
+  if (arrays)
+  {
+    EmitError(c, "arithmetic on an array");
+    return 0;
+  }
+
+  TOperatorEnum op = (TOperatorEnum) node.op;
+  int32_t t = NewTemporary(c);
+  Emit(c, doubles ? g_DoubleOperators[op] : g_IntOperators[op], t, left, right);
+  SubexpressionValueTypeEnum type = doubles && !IsComparison(op) ? typeDouble : typeInt;
+  return CompileConversion(c, t, type, (SubexpressionValueTypeEnum) node.valueType);
+}
+
+static int32_t CompileUnary(TRegisterCompiler& c, const TNode& node)
+{
+  SubexpressionValueTypeEnum type = NodeValueType(*c.tree, node.first);
+  int32_t r = CompileExpression(c, node.first);
+  if (IsArray(type))
+  {
+    EmitError(c, "arithmetic on an array");
+    return 0;
+  }
+  if (opToDouble == node.op)
+  {
+    r = CompileConversion(c, r, type, typeDouble);
+    type = typeDouble;
+  }
+  else
+  {
+    int32_t t = NewTemporary(c);
+    if (typeDouble == type)
+      Emit(c, regNegateDouble, t, r);
+    else
+    {
+      Emit(c, regNegateInt, t, r);
+      type = typeInt;
+    }
+    r = t;
+  }
+  return CompileConversion(c, r, type, (SubexpressionValueTypeEnum) node.valueType);
+}
+
+/* The register holding the value of the expression: constants and
+   variables are used where they are */
+static int32_t CompileExpression(TRegisterCompiler& c, TNodeIndex a)
+{
+  const TNode& node = c.tree->nodes[a];
+  switch (node.nodetype)
+  {
+  case typeConst:
+    return c.constants[a];
+
+  case typeIdentifier:
+    if (NO_SYMBOL == node.first)
+    {
+      EmitError(c, "reference to an undeclared variable");
+      return 0;
+    }
+    return node.first;
+
+  case typeBinaryOp:
+    return CompileBinary(c, node);
+
+  case typeUnaryOp:
+    return CompileUnary(c, node);
+
+  default:
+    EmitError(c, "bad expression");
+    return 0;
+  }
+}
+
+/* Evaluates the condition, returns the jump taken when it does not hold */
+static size_t CompileCondition(TRegisterCompiler& c, TNodeIndex a)
+{
+  SubexpressionValueTypeEnum type = NodeValueType(*c.tree, a);
+  int32_t r = CompileExpression(c, a);
+  if (IsArray(type))
+    EmitError(c, "an array is not a condition");
+  return Emit(c, typeDouble == type ? regJumpIfFalseDouble : regJumpIfFalseInt, 0, r);
+}
+
+static void CompileAssignment(TRegisterCompiler& c, const TNode& node)
+{
+  if (NO_SYMBOL == node.first)
+  {
+    EmitError(c, "assignment to an undeclared variable");
+    return;
+  }
+  int32_t r = CompileExpression(c, node.second);
+  r = CompileConversion(c, r, NodeValueType(*c.tree, node.second),
+                        SymbolRecord(c.tree->variables, node.first).valueType);
+  /* a temporary is the destination of the last instruction, which then
+     writes the variable instead */
+  TRegisterInstruction* last = c.code->code.empty() ? NULL : &c.code->code.back();
+  if (r >= c.firstTemporary && NULL != last && regError != last->opcode && last->a == r)
+    last->a = node.first;
+  else
+    Emit(c, regMove, node.first, r);
+}
+
+static void CompileStatement(TRegisterCompiler& c, TNodeIndex a);
+
+/* A while or for loop tests its condition at the top, a do loop after
+   its body */
+static void CompileLoop(TRegisterCompiler& c, const TNode& node)
+{
+  try
+  {
+    c.loops.push_back(TLoopLabels());
+  }
+  catch (std::bad_alloc& ba)
+  {
+    perror("out of space");
+    exit(0);
+  }
+  int32_t top = Here(c);
+  size_t end = 0;
+  if (loopDo != node.op)
+    end = CompileCondition(c, node.first);
+  CompileStatement(c, node.second);
+  for (size_t jump : c.loops.back().continues)
+    c.code->code[jump].a = Here(c);
+  if (loopDo == node.op)
+  {
+    c.nextTemporary = c.firstTemporary;
+    end = CompileCondition(c, node.first);
+  }
+  else
+    CompileStatement(c, node.third);
+  Emit(c, regJump, top);
+  c.code->code[end].a = Here(c);
+  for (size_t jump : c.loops.back().breaks)
+    c.code->code[jump].a = Here(c);
+  c.loops.pop_back();
+}
+
+static void CompileInput(TRegisterCompiler& c, const TNode& node)
+{
+  const TNode& variable = c.tree->nodes[node.first];
+  if (typeIdentifier != variable.nodetype || NO_SYMBOL == variable.first)
+  {
+    EmitError(c, "input needs a variable");
+    return;
+  }
+  switch (variable.valueType)
+  {
+  case typeInt:    Emit(c, regInputInt, variable.first); break;
+  case typeDouble: Emit(c, regInputDouble, variable.first); break;
+  case typeChar:   Emit(c, regInputChar, variable.first); break;
+  case typeBool:   Emit(c, regInputBool, variable.first); break;
+  default:         EmitError(c, "input of an array"); break;
+  }
+}
+
+static void CompileOutput(TRegisterCompiler& c, const TNode& node)
+{
+  SubexpressionValueTypeEnum type = NodeValueType(*c.tree, node.first);
+  int32_t r = CompileExpression(c, node.first);
+  switch (type)
+  {
+  case typeInt:    Emit(c, regPrintInt, r); break;
+  case typeDouble: Emit(c, regPrintDouble, r); break;
+  case typeChar:   Emit(c, regPrintChar, r); break;
+  case typeBool:   Emit(c, regPrintBool, r); break;
+  default:         EmitError(c, "output of an array"); break;
+  }
+}
+
+static void CompileStatement(TRegisterCompiler& c, TNodeIndex a)
+{
+  if (NO_NODE == a)
+    return;
+  const TNode& node = c.tree->nodes[a];
+  /* temporaries live within a statement */
+  c.nextTemporary = c.firstTemporary;
+  switch (node.nodetype)
+  {
+  case typeList:
+    for (auto i = 0u; i < node.second; ++i)
+      CompileStatement(c, c.tree->children[node.first + i]);
+    break;
+
+  case typeAssignmentOp:
+    CompileAssignment(c, node);
+    break;
+
+  case typeIfStatement:
+  {
+    size_t otherwise = CompileCondition(c, node.first);
+    CompileStatement(c, node.second);
+    if (NO_NODE == node.third)
+    {
+      c.code->code[otherwise].a = Here(c);
+      break;
+    }
+    size_t end = Emit(c, regJump);
+    c.code->code[otherwise].a = Here(c);
+    CompileStatement(c, node.third);
+    c.code->code[end].a = Here(c);
+    break;
+  }
+
+  case typeWhileStatement:
+    CompileLoop(c, node);
+    break;
+
+  case typeJumpStatement:
+    /* outside loops break and continue end the program, as return does */
+    if (jumpReturn == node.op || c.loops.empty())
+      Emit(c, regHalt);
+    else if (jumpContinue == node.op)
+      c.loops.back().continues.push_back(Emit(c, regJump));
+    else
+      c.loops.back().breaks.push_back(Emit(c, regJump));
+    break;
+
+  case typeInput:
+    CompileInput(c, node);
+    break;
+
+  case typeOutput:
+    CompileOutput(c, node);
+    break;
+
+  case typeFunctionStatment:
+    /* a definition, its body runs only when called */
+    break;
+
+  default:
+    /* an expression statement, only its errors are seen */
+    CompileExpression(c, a);
+    break;
+  }
+}
+
+void CompileRegisterCode(TRegisterCode& code, const TAst& tree, TNodeIndex program)
+{
+  code.code.clear();
+  code.constants.clear();
+  code.constantTypes.clear();
+  code.errors.clear();
+  code.firstConstant = (NULL != tree.variables ? tree.variables->data.size() : 0) + 1;
+
+  TRegisterCompiler c;
+  c.code = &code;
+  c.tree = &tree;
+  AllocateConstants(c);
+  c.firstTemporary = code.firstConstant + code.constants.size();
+  c.nextTemporary = c.firstTemporary;
+  code.registers = c.firstTemporary;
+  CompileStatement(c, program);
+  Emit(c, regHalt);
+}
+
+static void PrintValue(std::ostream& out, TValue value, SubexpressionValueTypeEnum type)
+{
+  switch (type)
+  {
+  case typeInt:    out << value.iNumber; break;
+  case typeDouble: out << value.dNumber; break;
+  case typeChar:   out << "'" << (char) value.iNumber << "'"; break;
+  case typeBool:   out << (value.iNumber != 0 ? "true" : "false"); break;
+  default:         out << value.array; break;
+  }
+}
+
+void PrintRegisterCode(const TRegisterCode& code, std::ostream& out)
+{
+  for (size_t i = 0; i < code.constants.size(); ++i)
+  {
+    out << "r" << code.firstConstant + i << " = ";
+    PrintValue(out, code.constants[i], code.constantTypes[i]);
+    out << std::endl;
+  }
+  for (size_t i = 0; i < code.code.size(); ++i)
+  {
+    const TRegisterInstruction& instruction = code.code[i];
+    const TRegisterOpcodeInfo& info = g_RegisterOpcodes[instruction.opcode];
+    out << i << "\t" << info.name;
+    switch (info.shape)
+    {
+    case shapeNone:
+      break;
+    case shapeUnary:
+      out << " r" << instruction.a << ", r" << instruction.b;
+      break;
+    case shapeBinary:
+      out << " r" << instruction.a << ", r" << instruction.b << ", r" << instruction.c;
+      break;
+    case shapeJump:
+      out << " " << instruction.a;
+      break;
+    case shapeBranch:
+      out << " " << instruction.a << ", r" << instruction.b;
+      break;
+    case shapeRegister:
+      out << " r" << instruction.a;
+      break;
+    case shapeError:
+      out << " \"" << code.errors[instruction.a] << "\"";
+      break;
+    }
+    out << std::endl;
+  }
+}
+
+void InitRegisterMachine(TRegisterMachine& vm, const TRegisterCode& code, std::istream& in, std::ostream& out)
+{
+  TValue zero;
+  memset(&zero, 0, sizeof(zero));
+  vm.code = &code;
+  try
+  {
+    vm.registers.assign(code.registers, zero);
+  }
+  catch (std::bad_alloc& ba)
+  {
+    perror("out of space");
+    exit(0);
+  }
+  std::copy(code.constants.begin(), code.constants.end(), vm.registers.begin() + code.firstConstant);
+  vm.in = &in;
+  vm.out = &out;
+  vm.failed = false;
+  vm.error.clear();
+  vm.dispatches = 0;
+}
+
+static bool Fail(TRegisterMachine& vm, unsigned long dispatches, const std::string& message)
+{
+  vm.dispatches = dispatches;
+  vm.failed = true;
+  vm.error = message;
+  return false;
+}
+
+#ifdef THREADED_DISPATCH
+#define HANDLER(opcode) handle_##opcode
+#define DISPATCH() do { instruction = *pc++; ++dispatches; goto *instruction.handler; } while (0)
+
+typedef struct
+{
+  const void* handler;
+  int32_t a;
+  int32_t b;
+  int32_t c;
+} TThreadedRegisterInstruction;
+#else
+#define HANDLER(opcode) case opcode
+#define DISPATCH() continue
+#endif
+
+bool RunRegisterCode(TRegisterMachine& vm)
+{
+  TValue* r = vm.registers.data();
+  std::istream& in = *vm.in;
+  std::ostream& out = *vm.out;
+  unsigned long dispatches = 0;
+
+#ifdef THREADED_DISPATCH
+  /* by TRegisterOpcodeEnum */
+  static const void* const handlers[] =
+  {
+    &&HANDLER(regHalt), &&HANDLER(regMove), &&HANDLER(regAddInt), &&HANDLER(regSubtractInt),
+    &&HANDLER(regMultiplyInt), &&HANDLER(regDivideInt), &&HANDLER(regNegateInt),
+    &&HANDLER(regLessInt), &&HANDLER(regGreaterInt), &&HANDLER(regLessEqualInt),
+    &&HANDLER(regGreaterEqualInt), &&HANDLER(regEqualInt), &&HANDLER(regNotEqualInt),
+    &&HANDLER(regAddDouble), &&HANDLER(regSubtractDouble), &&HANDLER(regMultiplyDouble),
+    &&HANDLER(regDivideDouble), &&HANDLER(regNegateDouble), &&HANDLER(regLessDouble),
+    &&HANDLER(regGreaterDouble), &&HANDLER(regLessEqualDouble), &&HANDLER(regGreaterEqualDouble),
+    &&HANDLER(regEqualDouble), &&HANDLER(regNotEqualDouble), &&HANDLER(regIntToDouble),
+    &&HANDLER(regDoubleToInt), &&HANDLER(regIntToChar), &&HANDLER(regIntToBool),
+    &&HANDLER(regDoubleToBool), &&HANDLER(regJump), &&HANDLER(regJumpIfFalseInt),
+    &&HANDLER(regJumpIfFalseDouble), &&HANDLER(regInputInt), &&HANDLER(regInputDouble),
+    &&HANDLER(regInputChar), &&HANDLER(regInputBool), &&HANDLER(regPrintInt),
+    &&HANDLER(regPrintDouble), &&HANDLER(regPrintChar), &&HANDLER(regPrintBool),
+    &&HANDLER(regError)
+  };
+  static_assert(sizeof(handlers) / sizeof(handlers[0]) == regError + 1,
+                "every opcode has a handler");
+
+  /* direct-threaded copy of the code, see RunBytecode */
+  const std::vector<TRegisterInstruction>& code = vm.code->code;
+  std::vector<TThreadedRegisterInstruction> threaded;
+  try
+  {
+    threaded.resize(code.size());
+  }
+  catch (std::bad_alloc& ba)
+  {
+    perror("out of space");
+    exit(0);
+  }
+  for (size_t i = 0; i < threaded.size(); ++i)
+  {
+    threaded[i].handler = handlers[code[i].opcode];
+    threaded[i].a = code[i].a;
+    threaded[i].b = code[i].b;
+    threaded[i].c = code[i].c;
+  }
+  const TThreadedRegisterInstruction* start = threaded.data();
+  const TThreadedRegisterInstruction* pc = start;
+  TThreadedRegisterInstruction instruction;
+  DISPATCH();
+  {
+#else
+  const TRegisterInstruction* start = vm.code->code.data();
+  const TRegisterInstruction* pc = start;
+  for (;;)
+  {
+    /* a copy: the stores to the registers could alias the code */
+    TRegisterInstruction instruction = *pc++;
+    ++dispatches;
+    switch (instruction.opcode)
+    {
+#endif
+    HANDLER(regHalt):
+      vm.dispatches = dispatches;
+      return true;
+
+    HANDLER(regMove):
+      r[instruction.a] = r[instruction.b];
+      DISPATCH();
+
+    /* ints wrap around */
+    HANDLER(regAddInt):
+      r[instruction.a].iNumber = (int) ((unsigned) r[instruction.b].iNumber + (unsigned) r[instruction.c].iNumber);
+      DISPATCH();
+    HANDLER(regSubtractInt):
+      r[instruction.a].iNumber = (int) ((unsigned) r[instruction.b].iNumber - (unsigned) r[instruction.c].iNumber);
+      DISPATCH();
+    HANDLER(regMultiplyInt):
+      r[instruction.a].iNumber = (int) ((unsigned) r[instruction.b].iNumber * (unsigned) r[instruction.c].iNumber);
+      DISPATCH();
+    HANDLER(regDivideInt):
+    {
+      int left = r[instruction.b].iNumber, right = r[instruction.c].iNumber;
+      if (0 == right)
+        return Fail(vm, dispatches, "division by zero");
+      r[instruction.a].iNumber = INT_MIN == left && -1 == right ? INT_MIN : left / right;
+      DISPATCH();
+    }
+    HANDLER(regNegateInt):
+      r[instruction.a].iNumber = (int) (0u - (unsigned) r[instruction.b].iNumber);
+      DISPATCH();
+    HANDLER(regLessInt):
+      r[instruction.a].iNumber = r[instruction.b].iNumber < r[instruction.c].iNumber;
+      DISPATCH();
+    HANDLER(regGreaterInt):
+      r[instruction.a].iNumber = r[instruction.b].iNumber > r[instruction.c].iNumber;
+      DISPATCH();
+    HANDLER(regLessEqualInt):
+      r[instruction.a].iNumber = r[instruction.b].iNumber <= r[instruction.c].iNumber;
+      DISPATCH();
+    HANDLER(regGreaterEqualInt):
+      r[instruction.a].iNumber = r[instruction.b].iNumber >= r[instruction.c].iNumber;
+      DISPATCH();
+    HANDLER(regEqualInt):
+      r[instruction.a].iNumber = r[instruction.b].iNumber == r[instruction.c].iNumber;
+      DISPATCH();
+    HANDLER(regNotEqualInt):
+      r[instruction.a].iNumber = r[instruction.b].iNumber != r[instruction.c].iNumber;
+      DISPATCH();
+
+    HANDLER(regAddDouble):
+      r[instruction.a].dNumber = r[instruction.b].dNumber + r[instruction.c].dNumber;
+      DISPATCH();
+    HANDLER(regSubtractDouble):
+      r[instruction.a].dNumber = r[instruction.b].dNumber - r[instruction.c].dNumber;
+      DISPATCH();
+    HANDLER(regMultiplyDouble):
+      r[instruction.a].dNumber = r[instruction.b].dNumber * r[instruction.c].dNumber;
+      DISPATCH();
+    HANDLER(regDivideDouble):
+      r[instruction.a].dNumber = r[instruction.b].dNumber / r[instruction.c].dNumber;
+      DISPATCH();
+    HANDLER(regNegateDouble):
+      r[instruction.a].dNumber = -r[instruction.b].dNumber;
+      DISPATCH();
+    HANDLER(regLessDouble):
+      r[instruction.a].iNumber = r[instruction.b].dNumber < r[instruction.c].dNumber;
+      DISPATCH();
+    HANDLER(regGreaterDouble):
+      r[instruction.a].iNumber = r[instruction.b].dNumber > r[instruction.c].dNumber;
+      DISPATCH();
+    HANDLER(regLessEqualDouble):
+      r[instruction.a].iNumber = r[instruction.b].dNumber <= r[instruction.c].dNumber;
+      DISPATCH();
+    HANDLER(regGreaterEqualDouble):
+      r[instruction.a].iNumber = r[instruction.b].dNumber >= r[instruction.c].dNumber;
+      DISPATCH();
+    HANDLER(regEqualDouble):
+      r[instruction.a].iNumber = r[instruction.b].dNumber == r[instruction.c].dNumber;
+      DISPATCH();
+    HANDLER(regNotEqualDouble):
+      r[instruction.a].iNumber = r[instruction.b].dNumber != r[instruction.c].dNumber;
+      DISPATCH();
+
+    HANDLER(regIntToDouble):
+      r[instruction.a].dNumber = r[instruction.b].iNumber;
+      DISPATCH();
+    HANDLER(regDoubleToInt):
+      r[instruction.a].iNumber = DoubleToInt(r[instruction.b].dNumber);
+      DISPATCH();
+    HANDLER(regIntToChar):
+      r[instruction.a].iNumber = (char) r[instruction.b].iNumber;
+      DISPATCH();
+    HANDLER(regIntToBool):
+      r[instruction.a].iNumber = r[instruction.b].iNumber != 0;
+      DISPATCH();
+    HANDLER(regDoubleToBool):
+      r[instruction.a].iNumber = r[instruction.b].dNumber != 0;
+      DISPATCH();
+
+    HANDLER(regJump):
+      pc = start + instruction.a;
+      DISPATCH();
+    HANDLER(regJumpIfFalseInt):
+      if (0 == r[instruction.b].iNumber)
+        pc = start + instruction.a;
+      DISPATCH();
+    HANDLER(regJumpIfFalseDouble):
+      if (0 == r[instruction.b].dNumber)
+        pc = start + instruction.a;
+      DISPATCH();
+
+    HANDLER(regInputInt):
+      if (!(in >> r[instruction.a].iNumber))
+        return Fail(vm, dispatches, "no value to input");
+      DISPATCH();
+    HANDLER(regInputDouble):
+      if (!(in >> r[instruction.a].dNumber))
+        return Fail(vm, dispatches, "no value to input");
+      DISPATCH();
+    HANDLER(regInputChar):
+    {
+      char ch = 0;
+      if (!(in >> ch))
+        return Fail(vm, dispatches, "no value to input");
+      r[instruction.a].iNumber = ch;
+      DISPATCH();
+    }
+    HANDLER(regInputBool):
+    {
+      int i = 0;
+      if (!(in >> i))
+        return Fail(vm, dispatches, "no value to input");
+      r[instruction.a].iNumber = i != 0;
+      DISPATCH();
+    }
+
+    HANDLER(regPrintInt):
+      out << r[instruction.a].iNumber << std::endl;
+      DISPATCH();
+    HANDLER(regPrintDouble):
+      out << r[instruction.a].dNumber << std::endl;
+      DISPATCH();
+    HANDLER(regPrintChar):
+      out << (char) r[instruction.a].iNumber << std::endl;
+      DISPATCH();
+    HANDLER(regPrintBool):
+      out << (r[instruction.a].iNumber != 0) << std::endl;
+      DISPATCH();
+
+#ifndef THREADED_DISPATCH
+    default:
+#endif
+    HANDLER(regError):
+      return Fail(vm, dispatches, vm.code->errors[instruction.a]);
+#ifndef THREADED_DISPATCH
+    }
+#endif
+  }
+}
+
+#undef HANDLER
+#undef DISPATCH
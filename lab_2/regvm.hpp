@@ -0,0 +1,106 @@
+/* Three-address code of Simpl programs and the register machine that runs it */
+
+#ifndef _REGVM_HPP
+#define _REGVM_HPP
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ast.hpp"
+#include "interpreter.hpp"
+
+/* Instructions name their registers: a is the destination, b and c the
+   sources; int, char and bool values are ints in the registers. */
+typedef enum
+{
+    regHalt,                  /* end of the program */
+    regMove,                  /* a = b */
+    regAddInt,                /* a = b + c */
+    regSubtractInt,
+    regMultiplyInt,
+    regDivideInt,
+    regNegateInt,             /* a = -b */
+    regLessInt,               /* comparisons give int 1 or 0 */
+    regGreaterInt,
+    regLessEqualInt,
+    regGreaterEqualInt,
+    regEqualInt,
+    regNotEqualInt,
+    regAddDouble,
+    regSubtractDouble,
+    regMultiplyDouble,
+    regDivideDouble,
+    regNegateDouble,
+    regLessDouble,
+    regGreaterDouble,
+    regLessEqualDouble,
+    regGreaterEqualDouble,
+    regEqualDouble,
+    regNotEqualDouble,
+    regIntToDouble,           /* a = b converted */
+    regDoubleToInt,           /* truncated, saturated */
+    regIntToChar,
+    regIntToBool,
+    regDoubleToBool,
+    regJump,                  /* to a */
+    regJumpIfFalseInt,        /* to a unless b */
+    regJumpIfFalseDouble,
+    regInputInt,              /* into a */
+    regInputDouble,
+    regInputChar,
+    regInputBool,
+    regPrintInt,              /* a */
+    regPrintDouble,
+    regPrintChar,
+    regPrintBool,
+    regError                  /* a = index in errors, stops the program */
+} TRegisterOpcodeEnum;
+
+typedef struct
+{
+  uint8_t opcode;     /* TRegisterOpcodeEnum */
+  int32_t a;          /* jump targets are instruction indices */
+  int32_t b;
+  int32_t c;
+} TRegisterInstruction;
+
+/* A compiled program. Its frame of registers holds the variables by
+   symbol (register 0 is unused), then the constants, then the
+   temporaries of the statements. */
+typedef struct
+{
+  std::vector<TRegisterInstruction> code;
+  std::vector<TValue> constants;                      /* from register firstConstant */
+  std::vector<SubexpressionValueTypeEnum> constantTypes;
+  std::vector<std::string> errors;                    /* messages of the error instructions */
+  unsigned firstConstant;
+  unsigned registers;                                 /* size of the frame */
+} TRegisterCode;
+
+/* Compile the program of the tree from its root; runtime errors are
+   reported as the tree-walker reports them, see CompileBytecode. */
+void CompileRegisterCode(TRegisterCode& code, const TAst& tree, TNodeIndex program);
+
+/* Listing of the constants and the instructions */
+void PrintRegisterCode(const TRegisterCode& code, std::ostream& out);
+
+/* State of a program running on the register machine */
+typedef struct
+{
+  const TRegisterCode* code;
+  std::vector<TValue> registers;
+  std::istream* in;
+  std::ostream* out;
+  bool failed;
+  std::string error;
+  unsigned long dispatches;     /* instructions executed */
+} TRegisterMachine;
+
+void InitRegisterMachine(TRegisterMachine& vm, const TRegisterCode& code, std::istream& in, std::ostream& out);
+
+/* Run the program to its end; false on a runtime error, which is
+   described in vm.error */
+bool RunRegisterCode(TRegisterMachine& vm);
+
+#endif
@@ -1,34 +1,178 @@
 #include "ast.hpp"
 #include "simpl-driver.hpp"
 #include "simpl-lang.hpp"
+#include "simpl-tokens.hpp"
 
 Simpl_driver::Simpl_driver()
-  : trace_scanning (false), trace_parsing (false)
+  : result (0), trace_scanning (false), mmap_input (true), fast_scanning (false), pipelined (false),
+    tokens (NULL), scanner (NULL), trace_parsing (false), streaming (false),
+    statement_handler (NULL), folding_constants (false), folded_nodes (),
+    keep_ast (false), ast (NO_NODE),
+    ast_symbols (NULL), AST_dumping (false), XML_dumping (false), symbols (NULL),
+    loop_nesting (0), out (&std::cout), err (&std::cerr)
 {
+  InitSourceBuffer(source);
+  InitLineTable(lines, NULL, 0);
+  InitAst(tree);
 }
 
 Simpl_driver::~Simpl_driver ()
 {
+  ReleaseAst(tree);
 }
 
 int Simpl_driver::parse(const std::string& f)
 {
   filename = f;
-  scan_begin();
-  yy::Parser parser(*this);
+  ClearIdentifierTable(identifiers);
+  ClearConstantPool(constants);
+  if (!scan_begin())
+    return 1;
+  if (streaming && XML_dumping)
+  {
+    xml_stream.open(XML_dumping_path);
+    *out << "Write XML into '" << XML_dumping_path << "'" << std::endl;
+  }
+  symbols = CreateSymbolTable();
+  loop_nesting = 0;
+  folded_nodes.removed = 0;
+  folded_nodes.unreachable = 0;
+  ResetAst(tree);
+  tree.variables = symbols;
+  ast = NO_NODE;
+  // Programs run to about a node per four bytes of source; reserving
+  // saves copying the tree as it grows, untouched pages cost nothing.
+  if (!streaming && NULL != source.data)
+    tree.nodes.reserve(source.size / 4 + 1);
+  if (pipelined && NULL != source.data)
+    StartTokenStream(*this);
+  yy::Parser parser(*this, scanner);
   parser.set_debug_level(trace_parsing);
+  parser.set_debug_stream(*err);
   int result = parser.parse();
+  if (NULL != tokens)
+  {
+    StopTokenStream(tokens);
+    tokens = NULL;
+  }
   scan_end();
+  // the prog rule takes the variables of a complete program, these are
+  // what is left of a failed parse
+  DestroyUserVariableTable(symbols);
+  symbols = NULL;
+  if (!keep_ast)
+    ResetAst(tree);
+  if (xml_stream.is_open())
+    xml_stream.close();
   return result;
 }
 
-void Simpl_driver::error(const yy::location& l, const std::string& m)
+long Simpl_driver::lex(const std::string& f)
 {
-  std::cerr << filename << ": " << l << ": " << m << std::endl;
+  filename = f;
+  if (!scan_begin())
+    return -1;
+  yy::Parser::semantic_type yylval;
+  TSourceSpan yylloc;
+  long tokens = 0;
+  ClearIdentifierTable(identifiers);
+  for (;;)
+  {
+    yy::Parser::token_type t = scan(&yylval, &yylloc);
+    if (t == yy::Parser::token::EOFILE)
+      break;
+    ++tokens;
+  }
+  scan_end();
+  return tokens;
+}
+
+yy::Parser::token_type yylex(yy::Parser::semantic_type* yylval,
+                             yy::Parser::location_type* yylloc,
+                             Simpl_driver& driver, void* yyscanner)
+{
+  if (NULL != driver.tokens)
+    return NextStreamToken(driver.tokens, yylval, yylloc, driver);
+  yy::Parser::token_type t = driver.scan(yylval, yylloc);
+  driver.location = *yylloc;
+  return t;
+}
+
+yy::Parser::token_type Simpl_driver::scan(yy::Parser::semantic_type* yylval,
+                                          yy::Parser::location_type* yylloc)
+{
+  if (fast_scanning && NULL != source.data)
+    return simpl_fast_scan(yylval, yylloc, *this, scanner);
+  return simpl_scan(yylval, yylloc, *this, scanner);
+}
+
+TNodeIndex Simpl_driver::add_statement(TNodeIndex program, TNodeIndex statement)
+{
+  if (streaming)
+  {
+    if (NULL != statement_handler)
+      statement_handler(statement, *this);
+    else
+    {
+      if (AST_dumping)
+        PrintAST(tree, statement, 0, *out);
+      if (xml_stream.is_open())
+        WriteXml(tree, statement, 0, xml_stream);
+    }
+    // The pooled literals are nodes of the tree and go with it, and the
+    // declarations of its closed scopes can go too.
+    ResetAst(tree);
+    ClearConstantPool(constants);
+    CompactSymbolTable(symbols);
+
+    // Nothing before the lookahead token is looked up again.
+    TrimLineTable(lines, location.begin);
+    return NO_NODE;
+  }
+
+  // The same flat list as stmtlist builds, closed by the prog rule
+  if (NO_NODE == program)
+    return CreateListNode(tree, statement);
+  return AppendListNode(tree, program, statement);
+}
+
+void Simpl_driver::error(const TSourceSpan& l, const std::string& m)
+{
+  *err << filename << ": " << FormatSourceSpan(lines, l) << ": " << m << std::endl;
 }
 
 void Simpl_driver::error(const std::string& m)
 {
-  extern yy::location loc;
-  std::cerr << filename << ": " << loc << ": " << m << std::endl;
+  error(location, m);
+}
+
+void Simpl_driver::scan_error(const TSourceSpan& l, const std::string& m)
+{
+  if (NULL == tokens)
+  {
+    error(l, m);
+    return;
+  }
+  // Reported by the parser when it reaches the offending token.
+  TScanError e;
+  e.index = 0;
+  e.location = l;
+  e.message = m;
+  tokens->pendingErrors.push_back(e);
+}
+
+int Simpl_driver::scan_integer(const char* text, size_t length, const TSourceSpan& l)
+{
+  int value;
+  if (!ConvertIntegerLiteral(text, length, value))
+    scan_error(l, "integer constant " + std::string(text, length) + " is out of range");
+  return value;
+}
+
+double Simpl_driver::scan_float(const char* text, size_t length, const TSourceSpan& l)
+{
+  double value;
+  if (!ConvertFloatLiteral(text, length, value))
+    scan_error(l, "floating point constant " + std::string(text, length) + " is out of range");
+  return value;
 }
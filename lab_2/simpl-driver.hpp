@@ -1,18 +1,43 @@
 #ifndef _SIMPL_DRIVER_HPP
 #define _SIMPL_DRIVER_HPP
+#include <fstream>
 #include <string>
 #include "ast.hpp"
+#include "constants.hpp"
+#include "fold.hpp"
 #include "simpl-lang.hpp"
+#include "simpl-source.hpp"
 
-// Tell Flex the lexer's prototype ...
+// Tell Flex the scanner's prototype ...
 #define YY_DECL \
-  yy::Parser::token_type yylex(yy::Parser::semantic_type* yylval, \
+  yy::Parser::token_type simpl_scan(yy::Parser::semantic_type* yylval, \
                  yy::Parser::location_type* yylloc, \
-                 Simpl_driver& driver)
+                 Simpl_driver& driver, void* yyscanner)
 
-// ... and declare it for the parser's sake.
+// ... and declare it for the driver's sake.
 YY_DECL;
 
+// The hand-written scanner of in-memory sources (simpl-fast-lexer.cpp),
+// a drop-in replacement for the flex one.
+#define YY_DECL_FAST \
+  yy::Parser::token_type simpl_fast_scan(yy::Parser::semantic_type* yylval, \
+                 yy::Parser::location_type* yylloc, \
+                 Simpl_driver& driver, void* yyscanner)
+
+YY_DECL_FAST;
+
+// The parser's lexer: the scanner itself, or the tokens it scanned ahead
+// on another thread when the driver runs pipelined.
+yy::Parser::token_type yylex(yy::Parser::semantic_type* yylval,
+                             yy::Parser::location_type* yylloc,
+                             Simpl_driver& driver, void* yyscanner);
+
+class Simpl_driver;
+
+// Consumer of the top-level statements of a streamed compilation, which
+// are in driver.tree. The statement is freed when the handler returns.
+typedef void (*TStatementHandler)(TNodeIndex statement, Simpl_driver& driver);
+
 class Simpl_driver
 {
 public:
@@ -23,14 +48,88 @@ public:
 
   bool trace_scanning;
 
-  void scan_begin();
+  // False when the file cannot be read, which has been reported.
+  bool scan_begin();
   void scan_end();
   
   int parse(const std::string& f);
 
+  // Scan the file without parsing it, returns the number of tokens.
+  long lex(const std::string& f);
+
+  // Next token of the file being scanned, from whichever scanner is in use.
+  yy::Parser::token_type scan(yy::Parser::semantic_type* yylval,
+                              yy::Parser::location_type* yylloc);
+
+  // Whether files are memory-mapped and scanned in place (default)
+  // instead of being read through stdio.
+  bool mmap_input;
+
+  // Whether in-memory sources are scanned by the hand-written scanner
+  // instead of the flex one.
+  bool fast_scanning;
+
+  // Text of the file being scanned when mmap_input is used.
+  TSourceBuffer source;
+
+  // Whether the scanner runs on its own thread ahead of the parser.
+  // Only in-memory sources (mmap_input) are scanned pipelined.
+  bool pipelined;
+
+  // Tokens scanned ahead, while a pipelined parse is running.
+  struct TokenStream* tokens;
+
+  // State of the reentrant scanner (yyscan_t) for the file being scanned.
+  void* scanner;
+
+  // The location of the current token.
+  TSourceSpan location;
+
+  // Offset of the next byte the scanner reads.
+  uint32_t scan_offset;
+
+  // Line starts of the file being parsed, for diagnostics.
+  TLineTable lines;
+
+  // Distinct identifiers of the current compilation.
+  TIdentifierTable identifiers;
+
+  // Distinct numeric literals of the current compilation.
+  TConstantPool constants;
+
   // Whether parser traces should be generated.
   bool trace_parsing;
   
+  // Whether each top-level statement is handed to statement_handler and
+  // freed as soon as it is parsed, keeping memory flat however long the
+  // program is. Standard input is then read through stdio, not slurped.
+  bool streaming;
+
+  // Where streamed statements go; NULL dumps them as -ast/-xml ask.
+  TStatementHandler statement_handler;
+
+  // Append a top-level statement, returns the program built so far.
+  TNodeIndex add_statement(TNodeIndex program, TNodeIndex statement);
+
+  // XML output of a streamed compilation.
+  std::ofstream xml_stream;
+
+  // The AST being built.
+  TAst tree;
+
+  // Whether operators of literals are folded into literals as they are
+  // parsed, and how many nodes that took out of the last parse.
+  bool folding_constants;
+  TFoldCount folded_nodes;
+
+  // Whether a parsed program is left to the caller instead of being
+  // freed: its root in ast, a node of tree valid until the next parse,
+  // and its variables in ast_symbols, to be released with
+  // DestroyUserVariableTable.
+  bool keep_ast;
+  TNodeIndex ast;
+  TSymbolTable* ast_symbols;
+
   // Whether AST nodes should be generated by parser.
   bool AST_dumping;
     
@@ -38,13 +137,31 @@ public:
   bool XML_dumping;
   std::string XML_dumping_path;
 
+  // Variables of the compilation, with the scopes open at the current
+  // token.
+  TSymbolTable* symbols;
+
+  // While and for loops enclosing the current token.
+  int loop_nesting;
+
+  // Where dumps and diagnostics of this compilation go (std::cout and
+  // std::cerr by default).
+  std::ostream* out;
+  std::ostream* err;
+
   // The name of the file being parsed.
   // Used later to pass the file name to the location tracker.
   std::string filename;
 
   // Error handling.
-  void error(const yy::location& l, const std::string& err_message);
+  void error(const TSourceSpan& l, const std::string& err_message);
   void error(const std::string& err_message);
+  // Errors found by the scanner, which may run ahead of the parser.
+  void scan_error(const TSourceSpan& l, const std::string& err_message);
+
+  // Values of INTCONST and NUMBER tokens, out of range ones are reported.
+  int scan_integer(const char* text, size_t length, const TSourceSpan& l);
+  double scan_float(const char* text, size_t length, const TSourceSpan& l);
 };
 
 #endif
@@ -0,0 +1,269 @@
+/*
+* Hand-written scanner for in-memory sources. It returns exactly the
+* tokens, values and locations the flex scanner of lexer.l returns, but
+* skips whitespace and classifies identifier and digit runs sixteen
+* bytes at a time with SSE2.
+*/
+#include <cstring>
+#include <string>
+
+#if defined __SSE2__ && defined __GNUC__
+#include <emmintrin.h>
+#define FAST_LEXER_SSE2 1
+#endif
+
+#include "ast.hpp"
+#include "simpl-lang.hpp"
+#include "simpl-driver.hpp"
+
+typedef yy::Parser::token token;
+typedef yy::Parser::token_type token_type;
+
+static inline bool IsDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+/* [[:alpha:]_] and [[:alnum:]_] of the C locale */
+static inline bool IsIdentifierStart(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static inline bool IsIdentifierChar(char c)
+{
+  return IsIdentifierStart(c) || IsDigit(c);
+}
+
+#ifdef FAST_LEXER_SSE2
+/* Bytes of the block within [low, high]; bytes >= 0x80 compare negative
+   and never fall in an ASCII range */
+static inline __m128i InRange(__m128i block, char low, char high)
+{
+  return _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(low - 1)),
+                       _mm_cmplt_epi8(block, _mm_set1_epi8(high + 1)));
+}
+#endif
+
+/* End of the run of blanks (space, tab, newline) starting at p */
+static const char* SkipBlanks(const char* p, const char* end)
+{
+#ifdef FAST_LEXER_SSE2
+  for (; p + 16 <= end; p += 16)
+  {
+    __m128i block = _mm_loadu_si128((const __m128i*) p);
+    __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+                    _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\t')),
+                                 _mm_cmpeq_epi8(block, _mm_set1_epi8('\n'))));
+    unsigned other = ~(unsigned) _mm_movemask_epi8(blank) & 0xffff;
+    if (other)
+      return p + __builtin_ctz(other);
+  }
+#endif
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\n'))
+    ++p;
+  return p;
+}
+
+/* End of the run of [[:alnum:]_] starting at p */
+static const char* SkipIdentifierChars(const char* p, const char* end)
+{
+#ifdef FAST_LEXER_SSE2
+  for (; p + 16 <= end; p += 16)
+  {
+    __m128i block = _mm_loadu_si128((const __m128i*) p);
+    __m128i word = _mm_or_si128(_mm_or_si128(InRange(block, 'a', 'z'), InRange(block, 'A', 'Z')),
+                   _mm_or_si128(InRange(block, '0', '9'), _mm_cmpeq_epi8(block, _mm_set1_epi8('_'))));
+    unsigned other = ~(unsigned) _mm_movemask_epi8(word) & 0xffff;
+    if (other)
+      return p + __builtin_ctz(other);
+  }
+#endif
+  while (p < end && IsIdentifierChar(*p))
+    ++p;
+  return p;
+}
+
+/* End of the run of [0-9] starting at p */
+static const char* SkipDigits(const char* p, const char* end)
+{
+#ifdef FAST_LEXER_SSE2
+  for (; p + 16 <= end; p += 16)
+  {
+    __m128i block = _mm_loadu_si128((const __m128i*) p);
+    unsigned other = ~(unsigned) _mm_movemask_epi8(InRange(block, '0', '9')) & 0xffff;
+    if (other)
+      return p + __builtin_ctz(other);
+  }
+#endif
+  while (p < end && IsDigit(*p))
+    ++p;
+  return p;
+}
+
+/* {EXP} at p: length of ([Ee][-+]?[0-9]+), 0 if there is none */
+static size_t ExponentLength(const char* p, const char* end)
+{
+  const char* q = p;
+  if (q == end || (*q != 'e' && *q != 'E'))
+    return 0;
+  ++q;
+  if (q < end && (*q == '+' || *q == '-'))
+    ++q;
+  const char* digits = SkipDigits(q, end);
+  return digits == q ? 0 : digits - p;
+}
+
+/* The keyword spelled by an identifier, VARIABLE if none */
+static token_type Keyword(const char* p, size_t length)
+{
+#define KEYWORD(text, kind) \
+  if (length == sizeof(text) - 1 && 0 == memcmp(p, text, length)) return kind
+
+  switch (*p)
+  {
+  case 'b': KEYWORD("bool", token::BOOL); KEYWORD("break", token::BREAK); break;
+  case 'c': KEYWORD("char", token::CHAR); KEYWORD("continue", token::CONTINUE); break;
+  case 'd': KEYWORD("do", token::DO); break;
+  case 'e': KEYWORD("else", token::ELSE); KEYWORD("echa", token::ECHA); break;
+  case 'f': KEYWORD("float", token::FLOAT); KEYWORD("for", token::FOR); KEYWORD("func", token::FUNC); break;
+  case 'i': KEYWORD("if", token::IF); KEYWORD("int", token::INT); KEYWORD("input", token::INPUT); break;
+  case 'm': KEYWORD("main", token::MAIN); break;
+  case 'r': KEYWORD("return", token::RETURN); break;
+  case 'w': KEYWORD("while", token::WHILE); break;
+  }
+  return token::VARIABLE;
+#undef KEYWORD
+}
+
+/* Number tokens at p (a digit or '.'), longest match of the flex rules
+     0|[1-9][0-9]*                             INTCONST
+     ([0-9]*\.[0-9]+|[0-9]+\.){EXP}?|[0-9]+{EXP}  NUMBER
+   Returns the length, 0 when nothing matches (a lone '.') */
+static size_t NumberLength(const char* p, const char* end, bool& isFloat)
+{
+  const char* digits = SkipDigits(p, end);
+  size_t intLength = (digits == p) ? 0 : (*p == '0' ? 1 : digits - p);
+  size_t floatLength = 0;
+  if (digits < end && *digits == '.')
+  {
+    const char* fraction = SkipDigits(digits + 1, end);
+    if (digits > p || fraction > digits + 1)
+      floatLength = fraction - p + ExponentLength(fraction, end);
+  }
+  else if (digits > p)
+  {
+    size_t exponent = ExponentLength(digits, end);
+    if (exponent)
+      floatLength = digits - p + exponent;
+  }
+  isFloat = floatLength > intLength;
+  return isFloat ? floatLength : intLength;
+}
+
+/* flex's "." rule: a character no other rule matches */
+static token_type StrayCharacter(const char* p, TSourceSpan* yylloc, Simpl_driver& driver)
+{
+  yylloc->end = yylloc->begin + 1;
+  driver.scan_offset = yylloc->end;
+  std::string tmp(p, *p ? 1 : 0);
+  driver.scan_error(*yylloc, "Magical mistery character " + tmp);
+  return static_cast<token_type>(*p);
+}
+
+YY_DECL_FAST
+{
+  (void) yyscanner;
+  const char* text = driver.source.data;
+  const char* end = text + driver.source.size;
+  const char* p = SkipBlanks(text + driver.scan_offset, end);
+  yylloc->begin = (uint32_t) (p - text);
+
+  if (p == end)
+  {
+    yylloc->end = yylloc->begin;
+    driver.scan_offset = yylloc->begin;
+    return token::EOFILE;
+  }
+
+  size_t length = 1;
+  token_type kind;
+  switch (*p)
+  {
+  case '*': case '/':
+    kind = token::MULOPERATOR;
+    break;
+  case '+': kind = token::PLUS; break;
+  case '-': kind = token::MINUS; break;
+  case '{': kind = token::OPENBRACE; break;
+  case '}': kind = token::CLOSEBRACE; break;
+  case '[': kind = token::OPENSQRBRACE; break;
+  case ']': kind = token::CLOSESQRBRACE; break;
+  case ';': kind = token::SEMICOLON; break;
+  case ',': kind = token::COMMA; break;
+  case '(': kind = token::OPENPAREN; break;
+  case ')': kind = token::CLOSEPAREN; break;
+  case '=':
+    if (p + 1 < end && p[1] == '=')
+    {
+      length = 2;
+      kind = token::RELOP;
+    }
+    else
+      kind = token::ASSIGN;
+    break;
+  case '<': case '>':
+    length = (p + 1 < end && p[1] == '=') ? 2 : 1;
+    kind = token::RELOP;
+    break;
+  case '!':
+    if (p + 1 < end && p[1] == '=')
+    {
+      length = 2;
+      kind = token::RELOP;
+      break;
+    }
+    return StrayCharacter(p, yylloc, driver);
+  default:
+    if (IsIdentifierStart(*p))
+    {
+      length = SkipIdentifierChars(p + 1, end) - p;
+      kind = Keyword(p, length);
+      if (kind == token::VARIABLE)
+        yylval->var = InternIdentifier(driver.identifiers, p, length);
+      break;
+    }
+    if (IsDigit(*p) || *p == '.')
+    {
+      bool isFloat;
+      size_t number = NumberLength(p, end, isFloat);
+      if (number)
+      {
+        length = number;
+        yylloc->end = yylloc->begin + (uint32_t) length;
+        if (isFloat)
+        {
+          kind = token::NUMBER;
+          yylval->d = driver.scan_float(p, length, *yylloc);
+        }
+        else
+        {
+          kind = token::INTCONST;
+          yylval->i = driver.scan_integer(p, length, *yylloc);
+        }
+        break;
+      }
+    }
+    return StrayCharacter(p, yylloc, driver);
+  }
+
+  yylloc->end = yylloc->begin + (uint32_t) length;
+  driver.scan_offset = yylloc->end;
+
+  if (kind == token::MULOPERATOR || kind == token::RELOP)
+  {
+    memcpy(yylval->s, p, length);
+    yylval->s[length] = '\0';
+  }
+  return kind;
+}
@@ -0,0 +1,390 @@
+/*
+* Synthetic Simpl program generator for scale and stress testing. The
+* programs it writes are valid and type-correct, and the same options
+* and seed always give the same program, byte for byte.
+*/
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef struct
+{
+    uint64_t seed;
+    long statements;        /* statements in total, nested ones included */
+    int depth;              /* deepest nesting of blocks, ifs and loops */
+    int variables;          /* variables declared at the top of each scope */
+    int expressionDepth;    /* deepest nesting of binary operators */
+    int arrays;             /* percentage of declarations that are arrays */
+} TGeneratorOptions;
+
+typedef enum
+{
+    valueInt,
+    valueFloat
+} TGeneratedType;
+
+typedef struct
+{
+    TGeneratorOptions options;
+    uint64_t state;         /* splitmix64, the same on every platform */
+    FILE* out;
+    long left;              /* statements still to generate */
+    unsigned nextName;
+    /* variables in scope, innermost last; scopes[i] is where scope i starts */
+    std::vector<std::string> ints;
+    std::vector<std::string> floats;
+    std::vector<std::pair<size_t, size_t> > scopes;
+} TGenerator;
+
+static uint64_t NextRandom(TGenerator& g)
+{
+    uint64_t z = (g.state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* Uniform enough in [0, n) for the small n used here */
+static unsigned Random(TGenerator& g, unsigned n)
+{
+    return (unsigned) (NextRandom(g) % n);
+}
+
+static void Indent(TGenerator& g, int level)
+{
+    for (int i = 0; i < level; ++i)
+        fputs("    ", g.out);
+}
+
+static std::vector<std::string>& Variables(TGenerator& g, TGeneratedType type)
+{
+    return type == valueInt ? g.ints : g.floats;
+}
+
+static void OpenScope(TGenerator& g)
+{
+    g.scopes.push_back(std::make_pair(g.ints.size(), g.floats.size()));
+}
+
+static void CloseScope(TGenerator& g)
+{
+    g.ints.resize(g.scopes.back().first);
+    g.floats.resize(g.scopes.back().second);
+    g.scopes.pop_back();
+}
+
+static void Literal(TGenerator& g, TGeneratedType type)
+{
+    /* never zero, so that generated divisions stay defined */
+    if (type == valueInt)
+        fprintf(g.out, "%u", 1 + Random(g, 999));
+    else
+        fprintf(g.out, "%u.%u", Random(g, 1000), 1 + Random(g, 99));
+}
+
+static void Expression(TGenerator& g, TGeneratedType type, int depth)
+{
+    std::vector<std::string>& names = Variables(g, type);
+    if (depth <= 0 || Random(g, 3) == 0)
+    {
+        if (!names.empty() && Random(g, 3) != 0)
+            fputs(names[Random(g, names.size())].c_str(), g.out);
+        else
+            Literal(g, type);
+        return;
+    }
+
+    switch (Random(g, 8))
+    {
+    case 0:
+        fputc('(', g.out);
+        Expression(g, type, depth - 1);
+        fputc(')', g.out);
+        break;
+    case 1:
+        fputs("-", g.out);
+        Expression(g, type, 0);
+        break;
+    default:
+    {
+        static const char* operators[] = {" + ", " - ", " * ", " / "};
+        Expression(g, type, depth - 1);
+        fputs(operators[Random(g, 4)], g.out);
+        Expression(g, type, depth - 1);
+        break;
+    }
+    }
+}
+
+static void Condition(TGenerator& g)
+{
+    static const char* relations[] = {" < ", " > ", " <= ", " >= ", " == ", " != "};
+    TGeneratedType type = Random(g, 4) ? valueInt : valueFloat;
+    Expression(g, type, g.options.expressionDepth > 1 ? 1 : 0);
+    fputs(relations[Random(g, 6)], g.out);
+    Expression(g, type, g.options.expressionDepth > 1 ? 1 : 0);
+}
+
+static std::string NewName(TGenerator& g, char prefix)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%c%u", prefix, g.nextName++);
+    return name;
+}
+
+static void Declaration(TGenerator& g, int level)
+{
+    TGeneratedType type = Random(g, 4) ? valueInt : valueFloat;
+    const char* keyword = type == valueInt ? "int" : "float";
+    Indent(g, level);
+    if ((int) Random(g, 100) < g.options.arrays)
+    {
+        /* arrays cannot be used in expressions, they are only declared;
+           the parser takes their size from an integer literal */
+        std::string name = NewName(g, 'a');
+        fprintf(g.out, "%s %s = %s[", keyword, name.c_str(), keyword);
+        Literal(g, valueInt);
+        fputs("]\n", g.out);
+    }
+    else
+    {
+        std::string name = NewName(g, type == valueInt ? 'i' : 'f');
+        fprintf(g.out, "%s %s = ", keyword, name.c_str());
+        Expression(g, type, g.options.expressionDepth);
+        fputc('\n', g.out);
+        Variables(g, type).push_back(name);
+    }
+    --g.left;
+}
+
+static void Declarations(TGenerator& g, int level)
+{
+    for (int i = 0; i < g.options.variables && g.left > 0; ++i)
+        Declaration(g, level);
+}
+
+static void Statement(TGenerator& g, int level, bool inLoop);
+
+/* A block of at least one statement in a scope of its own */
+static void Block(TGenerator& g, int level, bool inLoop)
+{
+    Indent(g, level);
+    fputs("{\n", g.out);
+    OpenScope(g);
+    Declarations(g, level + 1);
+    long count = 1 + Random(g, 6);
+    for (long i = 0; i == 0 || (i < count && g.left > 0); ++i)
+        Statement(g, level + 1, inLoop);
+    CloseScope(g);
+    Indent(g, level);
+    fputs("}\n", g.out);
+}
+
+/* The body of an if or a loop: a block, or a single statement when the
+   nesting limit is reached */
+static void Body(TGenerator& g, int level, bool inLoop)
+{
+    if (level < g.options.depth)
+        Block(g, level, inLoop);
+    else
+        Statement(g, level + 1, inLoop);
+}
+
+static void Assignment(TGenerator& g, int level)
+{
+    TGeneratedType type = Random(g, 4) ? valueInt : valueFloat;
+    std::vector<std::string>& names = Variables(g, type);
+    if (names.empty())
+    {
+        Declaration(g, level);
+        return;
+    }
+    Indent(g, level);
+    fprintf(g.out, "%s = ", names[Random(g, names.size())].c_str());
+    Expression(g, type, g.options.expressionDepth);
+    fputc('\n', g.out);
+    --g.left;
+}
+
+static void Statement(TGenerator& g, int level, bool inLoop)
+{
+    bool nest = level < g.options.depth && g.left > 1;
+    unsigned kind = Random(g, 20);
+    if (!nest && kind >= 12)
+        kind = Random(g, 12);
+
+    switch (kind)
+    {
+    default:
+        Assignment(g, level);
+        return;
+    case 8:
+        Declaration(g, level);
+        return;
+    case 9:
+        Indent(g, level);
+        fputs("echa(", g.out);
+        Expression(g, Random(g, 4) ? valueInt : valueFloat, g.options.expressionDepth);
+        fputs(")\n", g.out);
+        --g.left;
+        return;
+    case 10:
+        if (g.ints.empty())
+        {
+            Assignment(g, level);
+            return;
+        }
+        Indent(g, level);
+        fprintf(g.out, "input(%s)\n", g.ints[Random(g, g.ints.size())].c_str());
+        --g.left;
+        return;
+    case 11:
+        /* break and continue of the innermost loop */
+        if (!inLoop)
+        {
+            Assignment(g, level);
+            return;
+        }
+        Indent(g, level);
+        fputs(Random(g, 2) ? "break\n" : "continue\n", g.out);
+        --g.left;
+        return;
+    case 12:
+    case 13:
+    case 14:
+        --g.left;
+        Indent(g, level);
+        fputs("if (", g.out);
+        Condition(g);
+        fputs(")\n", g.out);
+        Body(g, level, inLoop);
+        if (Random(g, 2))
+        {
+            Indent(g, level);
+            fputs("else\n", g.out);
+            Body(g, level, inLoop);
+        }
+        return;
+    case 15:
+    case 16:
+        --g.left;
+        Indent(g, level);
+        fputs("while (", g.out);
+        Condition(g);
+        fputs(")\n", g.out);
+        Body(g, level, true);
+        return;
+    case 17:
+    {
+        --g.left;
+        TGeneratedType type = Random(g, 4) ? valueInt : valueFloat;
+        Indent(g, level);
+        fputs("for (", g.out);
+        Expression(g, type, 0);
+        fputs("; ", g.out);
+        Condition(g);
+        fputs("; ", g.out);
+        Expression(g, type, 1);
+        fputs(")\n", g.out);
+        Body(g, level, true);
+        return;
+    }
+    case 18:
+        --g.left;
+        Indent(g, level);
+        fputs("do\n", g.out);
+        Body(g, level, true);
+        Indent(g, level);
+        fputs("while (", g.out);
+        Condition(g);
+        fputs(")\n", g.out);
+        return;
+    case 19:
+        --g.left;
+        Block(g, level, inLoop);
+        return;
+    }
+}
+
+static void Generate(TGenerator& g)
+{
+    OpenScope(g);
+    Declarations(g, 0);
+    while (g.left > 0)
+        Statement(g, 0, false);
+    CloseScope(g);
+}
+
+static void Usage(const char* program)
+{
+    fprintf(stderr,
+            "usage: %s [options] [output]\n"
+            "  -seed N         random seed (1)\n"
+            "  -statements N   statements in total (1000)\n"
+            "  -depth N        nesting depth of blocks, ifs and loops (3)\n"
+            "  -vars N         variables declared at the top of each scope (4)\n"
+            "  -expr-depth N   nesting depth of expressions (3)\n"
+            "  -arrays N       percentage of declarations that are arrays (5)\n"
+            "The program is written to standard output when no file is given.\n",
+            program);
+}
+
+int main(int argc, char* argv[])
+{
+    TGeneratorOptions options;
+    options.seed = 1;
+    options.statements = 1000;
+    options.depth = 3;
+    options.variables = 4;
+    options.expressionDepth = 3;
+    options.arrays = 5;
+    const char* output = NULL;
+
+    for (auto i = 1; i < argc; ++i)
+    {
+        std::string option = argv[i];
+        bool hasValue = i < argc - 1;
+        if (option == "-seed" && hasValue)
+            options.seed = strtoull(argv[++i], NULL, 10);
+        else if (option == "-statements" && hasValue)
+            options.statements = atol(argv[++i]);
+        else if (option == "-depth" && hasValue)
+            options.depth = atoi(argv[++i]);
+        else if (option == "-vars" && hasValue)
+            options.variables = atoi(argv[++i]);
+        else if (option == "-expr-depth" && hasValue)
+            options.expressionDepth = atoi(argv[++i]);
+        else if (option == "-arrays" && hasValue)
+            options.arrays = atoi(argv[++i]);
+        else if (option[0] != '-' && NULL == output)
+            output = argv[i];
+        else
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    TGenerator g;
+    g.options = options;
+    g.state = options.seed;
+    g.left = options.statements > 0 ? options.statements : 1;
+    g.nextName = 0;
+    g.out = stdout;
+    if (NULL != output && NULL == (g.out = fopen(output, "w")))
+    {
+        perror(output);
+        return 1;
+    }
+
+    Generate(g);
+    if (ferror(g.out) || (g.out != stdout && fclose(g.out) != 0))
+    {
+        perror(output ? output : "stdout");
+        return 1;
+    }
+    return 0;
+}
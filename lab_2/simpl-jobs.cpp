@@ -0,0 +1,75 @@
+/*
+* Work-stealing job pool
+*/
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "simpl-jobs.hpp"
+
+static bool TakeJob(TJobQueue& queue, bool own, size_t& index)
+{
+  std::lock_guard<std::mutex> guard(queue.lock);
+  if (queue.jobs.empty())
+    return false;
+  if (own)
+  {
+    index = queue.jobs.front();
+    queue.jobs.pop_front();
+  }
+  else
+  {
+    index = queue.jobs.back();
+    queue.jobs.pop_back();
+  }
+  return true;
+}
+
+/* No job is ever added once the pool runs, so a worker that finds every
+   queue empty is done */
+static void Work(std::vector<TJobQueue>* queues, unsigned self, TJob job, void* context)
+{
+  size_t index;
+  for (;;)
+  {
+    bool found = TakeJob((*queues)[self], true, index);
+    for (auto i = 1u; !found && i < queues->size(); ++i)
+      found = TakeJob((*queues)[(self + i) % queues->size()], false, index);
+    if (!found)
+      return;
+    job(index, context);
+  }
+}
+
+void RunJobs(unsigned threads, size_t count, TJob job, void* context)
+{
+  if (threads < 1)
+    threads = 1;
+  if (threads > count)
+    threads = count ? (unsigned) count : 1;
+
+  std::vector<TJobQueue> queues(threads);
+  for (auto w = 0u; w < threads; ++w)
+  {
+    for (size_t i = count * w / threads; i < count * (w + 1) / threads; ++i)
+      queues[w].jobs.push_back(i);
+  }
+
+  /* the calling thread is worker 0 */
+  std::vector<std::thread> workers;
+  for (auto w = 1u; w < threads; ++w)
+  {
+    try
+    {
+      workers.push_back(std::thread(Work, &queues, w, job, context));
+    }
+    catch (std::system_error& se)
+    {
+      /* fewer threads: their jobs are stolen by the others */
+      break;
+    }
+  }
+  Work(&queues, 0, job, context);
+  for (auto i = 0u; i < workers.size(); ++i)
+    workers[i].join();
+}
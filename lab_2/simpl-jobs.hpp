@@ -0,0 +1,26 @@
+/* A work-stealing pool for independent jobs, such as the files of a
+   multi-file compilation */
+
+#ifndef _SIMPL_JOBS_HPP
+#define _SIMPL_JOBS_HPP
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+/* One job of the pool: job(index, context) */
+typedef void (*TJob)(size_t index, void* context);
+
+/* The jobs a worker owns; it takes from the front, thieves from the back */
+typedef struct
+{
+  std::mutex lock;
+  std::deque<size_t> jobs;
+} TJobQueue;
+
+/* Run job(i, context) for every i < count on the given number of threads
+   and return when all are done. Workers start with contiguous ranges of
+   indexes and steal from each other once their own range is exhausted. */
+void RunJobs(unsigned threads, size_t count, TJob job, void* context);
+
+#endif
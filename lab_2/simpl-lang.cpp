@@ -1,1912 +0,0 @@
-// A Bison parser, made by GNU Bison 3.5.1.
-
-// Skeleton implementation for Bison LALR(1) parsers in C++
-
-// Copyright (C) 2002-2015, 2018-2020 Free Software Foundation, Inc.
-
-// This program is free software: you can redistribute it and/or modify
-// it under the terms of the GNU General Public License as published by
-// the Free Software Foundation, either version 3 of the License, or
-// (at your option) any later version.
-
-// This program is distributed in the hope that it will be useful,
-// but WITHOUT ANY WARRANTY; without even the implied warranty of
-// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-// GNU General Public License for more details.
-
-// You should have received a copy of the GNU General Public License
-// along with this program.  If not, see <http://www.gnu.org/licenses/>.
-
-// As a special exception, you may create a larger work that contains
-// part or all of the Bison parser skeleton and distribute that work
-// under terms of your choice, so long as that work isn't itself a
-// parser generator using the skeleton or a modified version thereof
-// as a parser skeleton.  Alternatively, if you modify or redistribute
-// the parser skeleton itself, you may (at your option) remove this
-// special exception, which will cause the skeleton and the resulting
-// Bison output files to be licensed under the GNU General Public
-// License without this special exception.
-
-// This special exception was added by the Free Software Foundation in
-// version 2.2 of Bison.
-
-// Undocumented macros, especially those whose name start with YY_,
-// are private implementation details.  Do not rely on them.
-
-
-
-// First part of user prologue.
-
-/* Based on John Levine's book "flex&bison"*/
-#include <cstdio>
-#include <cstdlib>
-#include <string>
-#include <cstring>
-#include <algorithm>
-#include <fstream>
-#include <iostream>
-
-#include "ast.hpp"
-#include "symtable.hpp"
-#include "simpl-driver.hpp"
-
-
-
-#include "simpl-lang.hpp"
-
-
-// Unqualified %code blocks.
-
-#undef yyerror
-#define yyerror driver.error
-
-static std::string ErrorMessageVariableNotDeclared(std::string);
-static std::string ErrorMessageVariableDoublyDeclared(std::string);
-
-int g_LoopNestingCounter = 0;
-
-static TSymbolTable* g_TopLevelUserVariableTable = CreateUserVariableTable(NULL);
-static TSymbolTable* currentTable = g_TopLevelUserVariableTable;
-
-
-
-#ifndef YY_
-# if defined YYENABLE_NLS && YYENABLE_NLS
-#  if ENABLE_NLS
-#   include <libintl.h> // FIXME: INFRINGES ON USER NAME SPACE.
-#   define YY_(msgid) dgettext ("bison-runtime", msgid)
-#  endif
-# endif
-# ifndef YY_
-#  define YY_(msgid) msgid
-# endif
-#endif
-
-// Whether we are compiled with exception support.
-#ifndef YY_EXCEPTIONS
-# if defined __GNUC__ && !defined __EXCEPTIONS
-#  define YY_EXCEPTIONS 0
-# else
-#  define YY_EXCEPTIONS 1
-# endif
-#endif
-
-#define YYRHSLOC(Rhs, K) ((Rhs)[K].location)
-/* YYLLOC_DEFAULT -- Set CURRENT to span from RHS[1] to RHS[N].
-   If N is 0, then set CURRENT to the empty location which ends
-   the previous symbol: RHS[0] (always defined).  */
-
-# ifndef YYLLOC_DEFAULT
-#  define YYLLOC_DEFAULT(Current, Rhs, N)                               \
-    do                                                                  \
-      if (N)                                                            \
-        {                                                               \
-          (Current).begin  = YYRHSLOC (Rhs, 1).begin;                   \
-          (Current).end    = YYRHSLOC (Rhs, N).end;                     \
-        }                                                               \
-      else                                                              \
-        {                                                               \
-          (Current).begin = (Current).end = YYRHSLOC (Rhs, 0).end;      \
-        }                                                               \
-    while (false)
-# endif
-
-
-// Enable debugging if requested.
-#if YYDEBUG
-
-// A pseudo ostream that takes yydebug_ into account.
-# define YYCDEBUG if (yydebug_) (*yycdebug_)
-
-# define YY_SYMBOL_PRINT(Title, Symbol)         \
-  do {                                          \
-    if (yydebug_)                               \
-    {                                           \
-      *yycdebug_ << Title << ' ';               \
-      yy_print_ (*yycdebug_, Symbol);           \
-      *yycdebug_ << '\n';                       \
-    }                                           \
-  } while (false)
-
-# define YY_REDUCE_PRINT(Rule)          \
-  do {                                  \
-    if (yydebug_)                       \
-      yy_reduce_print_ (Rule);          \
-  } while (false)
-
-# define YY_STACK_PRINT()               \
-  do {                                  \
-    if (yydebug_)                       \
-      yystack_print_ ();                \
-  } while (false)
-
-#else // !YYDEBUG
-
-# define YYCDEBUG if (false) std::cerr
-# define YY_SYMBOL_PRINT(Title, Symbol)  YYUSE (Symbol)
-# define YY_REDUCE_PRINT(Rule)           static_cast<void> (0)
-# define YY_STACK_PRINT()                static_cast<void> (0)
-
-#endif // !YYDEBUG
-
-#define yyerrok         (yyerrstatus_ = 0)
-#define yyclearin       (yyla.clear ())
-
-#define YYACCEPT        goto yyacceptlab
-#define YYABORT         goto yyabortlab
-#define YYERROR         goto yyerrorlab
-#define YYRECOVERING()  (!!yyerrstatus_)
-
-namespace yy {
-
-
-  /* Return YYSTR after stripping away unnecessary quotes and
-     backslashes, so that it's suitable for yyerror.  The heuristic is
-     that double-quoting is unnecessary unless the string contains an
-     apostrophe, a comma, or backslash (other than backslash-backslash).
-     YYSTR is taken from yytname.  */
-  std::string
-  Parser::yytnamerr_ (const char *yystr)
-  {
-    if (*yystr == '"')
-      {
-        std::string yyr;
-        char const *yyp = yystr;
-
-        for (;;)
-          switch (*++yyp)
-            {
-            case '\'':
-            case ',':
-              goto do_not_strip_quotes;
-
-            case '\\':
-              if (*++yyp != '\\')
-                goto do_not_strip_quotes;
-              else
-                goto append;
-
-            append:
-            default:
-              yyr += *yyp;
-              break;
-
-            case '"':
-              return yyr;
-            }
-      do_not_strip_quotes: ;
-      }
-
-    return yystr;
-  }
-
-
-  /// Build a parser object.
-  Parser::Parser (Simpl_driver& driver_yyarg)
-#if YYDEBUG
-    : yydebug_ (false),
-      yycdebug_ (&std::cerr),
-#else
-    :
-#endif
-      driver (driver_yyarg)
-  {}
-
-  Parser::~Parser ()
-  {}
-
-  Parser::syntax_error::~syntax_error () YY_NOEXCEPT YY_NOTHROW
-  {}
-
-  /*---------------.
-  | Symbol types.  |
-  `---------------*/
-
-  // basic_symbol.
-#if 201103L <= YY_CPLUSPLUS
-  template <typename Base>
-  Parser::basic_symbol<Base>::basic_symbol (basic_symbol&& that)
-    : Base (std::move (that))
-    , value (std::move (that.value))
-    , location (std::move (that.location))
-  {}
-#endif
-
-  template <typename Base>
-  Parser::basic_symbol<Base>::basic_symbol (const basic_symbol& that)
-    : Base (that)
-    , value (that.value)
-    , location (that.location)
-  {}
-
-
-  /// Constructor for valueless symbols.
-  template <typename Base>
-  Parser::basic_symbol<Base>::basic_symbol (typename Base::kind_type t, YY_MOVE_REF (location_type) l)
-    : Base (t)
-    , value ()
-    , location (l)
-  {}
-
-  template <typename Base>
-  Parser::basic_symbol<Base>::basic_symbol (typename Base::kind_type t, YY_RVREF (semantic_type) v, YY_RVREF (location_type) l)
-    : Base (t)
-    , value (YY_MOVE (v))
-    , location (YY_MOVE (l))
-  {}
-
-  template <typename Base>
-  bool
-  Parser::basic_symbol<Base>::empty () const YY_NOEXCEPT
-  {
-    return Base::type_get () == empty_symbol;
-  }
-
-  template <typename Base>
-  void
-  Parser::basic_symbol<Base>::move (basic_symbol& s)
-  {
-    super_type::move (s);
-    value = YY_MOVE (s.value);
-    location = YY_MOVE (s.location);
-  }
-
-  // by_type.
-  Parser::by_type::by_type ()
-    : type (empty_symbol)
-  {}
-
-#if 201103L <= YY_CPLUSPLUS
-  Parser::by_type::by_type (by_type&& that)
-    : type (that.type)
-  {
-    that.clear ();
-  }
-#endif
-
-  Parser::by_type::by_type (const by_type& that)
-    : type (that.type)
-  {}
-
-  Parser::by_type::by_type (token_type t)
-    : type (yytranslate_ (t))
-  {}
-
-  void
-  Parser::by_type::clear ()
-  {
-    type = empty_symbol;
-  }
-
-  void
-  Parser::by_type::move (by_type& that)
-  {
-    type = that.type;
-    that.clear ();
-  }
-
-  int
-  Parser::by_type::type_get () const YY_NOEXCEPT
-  {
-    return type;
-  }
-
-
-  // by_state.
-  Parser::by_state::by_state () YY_NOEXCEPT
-    : state (empty_state)
-  {}
-
-  Parser::by_state::by_state (const by_state& that) YY_NOEXCEPT
-    : state (that.state)
-  {}
-
-  void
-  Parser::by_state::clear () YY_NOEXCEPT
-  {
-    state = empty_state;
-  }
-
-  void
-  Parser::by_state::move (by_state& that)
-  {
-    state = that.state;
-    that.clear ();
-  }
-
-  Parser::by_state::by_state (state_type s) YY_NOEXCEPT
-    : state (s)
-  {}
-
-  Parser::symbol_number_type
-  Parser::by_state::type_get () const YY_NOEXCEPT
-  {
-    if (state == empty_state)
-      return empty_symbol;
-    else
-      return yystos_[+state];
-  }
-
-  Parser::stack_symbol_type::stack_symbol_type ()
-  {}
-
-  Parser::stack_symbol_type::stack_symbol_type (YY_RVREF (stack_symbol_type) that)
-    : super_type (YY_MOVE (that.state), YY_MOVE (that.value), YY_MOVE (that.location))
-  {
-#if 201103L <= YY_CPLUSPLUS
-    // that is emptied.
-    that.state = empty_state;
-#endif
-  }
-
-  Parser::stack_symbol_type::stack_symbol_type (state_type s, YY_MOVE_REF (symbol_type) that)
-    : super_type (s, YY_MOVE (that.value), YY_MOVE (that.location))
-  {
-    // that is emptied.
-    that.type = empty_symbol;
-  }
-
-#if YY_CPLUSPLUS < 201103L
-  Parser::stack_symbol_type&
-  Parser::stack_symbol_type::operator= (const stack_symbol_type& that)
-  {
-    state = that.state;
-    value = that.value;
-    location = that.location;
-    return *this;
-  }
-
-  Parser::stack_symbol_type&
-  Parser::stack_symbol_type::operator= (stack_symbol_type& that)
-  {
-    state = that.state;
-    value = that.value;
-    location = that.location;
-    // that is emptied.
-    that.state = empty_state;
-    return *this;
-  }
-#endif
-
-  template <typename Base>
-  void
-  Parser::yy_destroy_ (const char* yymsg, basic_symbol<Base>& yysym) const
-  {
-    if (yymsg)
-      YY_SYMBOL_PRINT (yymsg, yysym);
-
-    // User destructor.
-    switch (yysym.type_get ())
-    {
-      case 5: // "name"
-                    { delete (yysym.value.var); }
-        break;
-
-      default:
-        break;
-    }
-  }
-
-#if YYDEBUG
-  template <typename Base>
-  void
-  Parser::yy_print_ (std::ostream& yyo,
-                                     const basic_symbol<Base>& yysym) const
-  {
-    std::ostream& yyoutput = yyo;
-    YYUSE (yyoutput);
-    symbol_number_type yytype = yysym.type_get ();
-#if defined __GNUC__ && ! defined __clang__ && ! defined __ICC && __GNUC__ * 100 + __GNUC_MINOR__ <= 408
-    // Avoid a (spurious) G++ 4.8 warning about "array subscript is
-    // below array bounds".
-    if (yysym.empty ())
-      std::abort ();
-#endif
-    yyo << (yytype < yyntokens_ ? "token" : "nterm")
-        << ' ' << yytname_[yytype] << " ("
-        << yysym.location << ": ";
-    switch (yytype)
-    {
-      case 3: // "floating point double precision"
-                 { yyoutput << (yysym.value.d); }
-        break;
-
-      case 4: // "integer"
-                 { yyoutput << (yysym.value.i); }
-        break;
-
-      case 5: // "name"
-                 { yyoutput << (yysym.value.var); }
-        break;
-
-      case 6: // "relop"
-                 { yyoutput << (yysym.value.s); }
-        break;
-
-      case 9: // "mulop"
-                 { yyoutput << (yysym.value.s); }
-        break;
-
-      case 39: // prog
-                 { yyoutput << (yysym.value.a); }
-        break;
-
-      case 40: // stmtlist
-                 { yyoutput << (yysym.value.a); }
-        break;
-
-      case 41: // stmtlist_tail
-                 { yyoutput << (yysym.value.a); }
-        break;
-
-      case 42: // statement
-                 { yyoutput << (yysym.value.a); }
-        break;
-
-      case 43: // compound_statement
-                 { yyoutput << (yysym.value.a); }
-        break;
-
-      case 45: // assignment
-                 { yyoutput << (yysym.value.a); }
-        break;
-
-      case 46: // declarations
-                 { yyoutput << (yysym.value.a); }
-        break;
-
-      case 47: // cond_stmt
-                 { yyoutput << (yysym.value.a); }
-        break;
-
-      case 48: // loop_stmt
-                 { yyoutput << (yysym.value.a); }
-        break;
-
-      case 49: // while_head
-                 { yyoutput << (yysym.value.a); }
-        break;
-
-      case 50: // for_head
-                 { yyoutput << (yysym.value.a); }
-        break;
-
-      case 51: // exp
-                 { yyoutput << (yysym.value.a); }
-        break;
-
-      case 52: // input
-                 { yyoutput << (yysym.value.a); }
-        break;
-
-      case 53: // echa
-                 { yyoutput << (yysym.value.a); }
-        break;
-
-      case 54: // type
-                 { yyoutput << (yysym.value.a); }
-        break;
-
-      case 56: // func
-                 { yyoutput << (yysym.value.a); }
-        break;
-
-      default:
-        break;
-    }
-    yyo << ')';
-  }
-#endif
-
-  void
-  Parser::yypush_ (const char* m, YY_MOVE_REF (stack_symbol_type) sym)
-  {
-    if (m)
-      YY_SYMBOL_PRINT (m, sym);
-    yystack_.push (YY_MOVE (sym));
-  }
-
-  void
-  Parser::yypush_ (const char* m, state_type s, YY_MOVE_REF (symbol_type) sym)
-  {
-#if 201103L <= YY_CPLUSPLUS
-    yypush_ (m, stack_symbol_type (s, std::move (sym)));
-#else
-    stack_symbol_type ss (s, sym);
-    yypush_ (m, ss);
-#endif
-  }
-
-  void
-  Parser::yypop_ (int n)
-  {
-    yystack_.pop (n);
-  }
-
-#if YYDEBUG
-  std::ostream&
-  Parser::debug_stream () const
-  {
-    return *yycdebug_;
-  }
-
-  void
-  Parser::set_debug_stream (std::ostream& o)
-  {
-    yycdebug_ = &o;
-  }
-
-
-  Parser::debug_level_type
-  Parser::debug_level () const
-  {
-    return yydebug_;
-  }
-
-  void
-  Parser::set_debug_level (debug_level_type l)
-  {
-    yydebug_ = l;
-  }
-#endif // YYDEBUG
-
-  Parser::state_type
-  Parser::yy_lr_goto_state_ (state_type yystate, int yysym)
-  {
-    int yyr = yypgoto_[yysym - yyntokens_] + yystate;
-    if (0 <= yyr && yyr <= yylast_ && yycheck_[yyr] == yystate)
-      return yytable_[yyr];
-    else
-      return yydefgoto_[yysym - yyntokens_];
-  }
-
-  bool
-  Parser::yy_pact_value_is_default_ (int yyvalue)
-  {
-    return yyvalue == yypact_ninf_;
-  }
-
-  bool
-  Parser::yy_table_value_is_error_ (int yyvalue)
-  {
-    return yyvalue == yytable_ninf_;
-  }
-
-  int
-  Parser::operator() ()
-  {
-    return parse ();
-  }
-
-  int
-  Parser::parse ()
-  {
-    int yyn;
-    /// Length of the RHS of the rule being reduced.
-    int yylen = 0;
-
-    // Error handling.
-    int yynerrs_ = 0;
-    int yyerrstatus_ = 0;
-
-    /// The lookahead symbol.
-    symbol_type yyla;
-
-    /// The locations where the error started and ended.
-    stack_symbol_type yyerror_range[3];
-
-    /// The return value of parse ().
-    int yyresult;
-
-#if YY_EXCEPTIONS
-    try
-#endif // YY_EXCEPTIONS
-      {
-    YYCDEBUG << "Starting parse\n";
-
-
-    // User initialization code.
-{
-  // Initialize the initial location.
-  yyla.location.begin.filename = yyla.location.end.filename = &driver.filename;
-}
-
-
-
-    /* Initialize the stack.  The initial state will be set in
-       yynewstate, since the latter expects the semantical and the
-       location values to have been already stored, initialize these
-       stacks with a primary value.  */
-    yystack_.clear ();
-    yypush_ (YY_NULLPTR, 0, YY_MOVE (yyla));
-
-  /*-----------------------------------------------.
-  | yynewstate -- push a new symbol on the stack.  |
-  `-----------------------------------------------*/
-  yynewstate:
-    YYCDEBUG << "Entering state " << int (yystack_[0].state) << '\n';
-
-    // Accept?
-    if (yystack_[0].state == yyfinal_)
-      YYACCEPT;
-
-    goto yybackup;
-
-
-  /*-----------.
-  | yybackup.  |
-  `-----------*/
-  yybackup:
-    // Try to take a decision without lookahead.
-    yyn = yypact_[+yystack_[0].state];
-    if (yy_pact_value_is_default_ (yyn))
-      goto yydefault;
-
-    // Read a lookahead token.
-    if (yyla.empty ())
-      {
-        YYCDEBUG << "Reading a token: ";
-#if YY_EXCEPTIONS
-        try
-#endif // YY_EXCEPTIONS
-          {
-            yyla.type = yytranslate_ (yylex (&yyla.value, &yyla.location, driver));
-          }
-#if YY_EXCEPTIONS
-        catch (const syntax_error& yyexc)
-          {
-            YYCDEBUG << "Caught exception: " << yyexc.what() << '\n';
-            error (yyexc);
-            goto yyerrlab1;
-          }
-#endif // YY_EXCEPTIONS
-      }
-    YY_SYMBOL_PRINT ("Next token is", yyla);
-
-    /* If the proper action on seeing token YYLA.TYPE is to reduce or
-       to detect an error, take that action.  */
-    yyn += yyla.type_get ();
-    if (yyn < 0 || yylast_ < yyn || yycheck_[yyn] != yyla.type_get ())
-      {
-        goto yydefault;
-      }
-
-    // Reduce or error.
-    yyn = yytable_[yyn];
-    if (yyn <= 0)
-      {
-        if (yy_table_value_is_error_ (yyn))
-          goto yyerrlab;
-        yyn = -yyn;
-        goto yyreduce;
-      }
-
-    // Count tokens shifted since error; after three, turn off error status.
-    if (yyerrstatus_)
-      --yyerrstatus_;
-
-    // Shift the lookahead token.
-    yypush_ ("Shifting", state_type (yyn), YY_MOVE (yyla));
-    goto yynewstate;
-
-
-  /*-----------------------------------------------------------.
-  | yydefault -- do the default action for the current state.  |
-  `-----------------------------------------------------------*/
-  yydefault:
-    yyn = yydefact_[+yystack_[0].state];
-    if (yyn == 0)
-      goto yyerrlab;
-    goto yyreduce;
-
-
-  /*-----------------------------.
-  | yyreduce -- do a reduction.  |
-  `-----------------------------*/
-  yyreduce:
-    yylen = yyr2_[yyn];
-    {
-      stack_symbol_type yylhs;
-      yylhs.state = yy_lr_goto_state_ (yystack_[yylen].state, yyr1_[yyn]);
-      /* If YYLEN is nonzero, implement the default value of the
-         action: '$$ = $1'.  Otherwise, use the top of the stack.
-
-         Otherwise, the following line sets YYLHS.VALUE to garbage.
-         This behavior is undocumented and Bison users should not rely
-         upon it.  */
-      if (yylen)
-        yylhs.value = yystack_[yylen - 1].value;
-      else
-        yylhs.value = yystack_[0].value;
-
-      // Default location.
-      {
-        stack_type::slice range (yystack_, yylen);
-        YYLLOC_DEFAULT (yylhs.location, range, yylen);
-        yyerror_range[1].location = yylhs.location;
-      }
-
-      // Perform the reduction.
-      YY_REDUCE_PRINT (yyn);
-#if YY_EXCEPTIONS
-      try
-#endif // YY_EXCEPTIONS
-        {
-          switch (yyn)
-            {
-  case 2:
-        {
-            if (driver.AST_dumping)
-            {
-                PrintAST((yystack_[0].value.a), 0);
-            }
-            if (driver.XML_dumping)
-            {
-                std::ofstream xmlFile;
-                xmlFile.open(driver.XML_dumping_path);
-                printf("Write XML into \'%s\'\n", driver.XML_dumping_path.c_str());
-                WriteXml((yystack_[0].value.a), 0, xmlFile);
-                xmlFile.close();
-            }
-            FreeAST((yystack_[0].value.a));
-            DestroyUserVariableTable(currentTable);
-            driver.result = 0;
-        }
-    break;
-
-  case 3:
-        {
-            if ((yystack_[0].value.a) == NULL)
-                (yylhs.value.a) = (yystack_[1].value.a);
-            else
-                (yylhs.value.a) = CreateNodeAST(typeList, "L", (yystack_[1].value.a), (yystack_[0].value.a));
-        }
-    break;
-
-  case 4:
-        {
-            (yylhs.value.a) = NULL;
-        }
-    break;
-
-  case 5:
-        {
-            (yylhs.value.a) = (yystack_[0].value.a);
-        }
-    break;
-
-  case 6:
-    { (yylhs.value.a) = (yystack_[0].value.a); }
-    break;
-
-  case 7:
-                 { (yylhs.value.a) = (yystack_[0].value.a); }
-    break;
-
-  case 8:
-                             { (yylhs.value.a) = (yystack_[0].value.a); }
-    break;
-
-  case 9:
-                                            { (yylhs.value.a) = (yystack_[0].value.a); }
-    break;
-
-  case 10:
-                                                                 { (yylhs.value.a) = (yystack_[0].value.a); }
-    break;
-
-  case 11:
-                                                                             { (yylhs.value.a) = (yystack_[0].value.a); }
-    break;
-
-  case 12:
-                                                                                    { (yylhs.value.a) = (yystack_[0].value.a); }
-    break;
-
-  case 13:
-                                                                                            { (yylhs.value.a) = (yystack_[0].value.a); }
-    break;
-
-  case 14:
-        {
-            (yylhs.value.a) = CreateControlFlowNode(typeJumpStatement, NULL, NULL, NULL);
-        }
-    break;
-
-  case 15:
-        {
-            if (g_LoopNestingCounter <= 0)
-                yyerror("'break' not inside loop");
-            (yylhs.value.a) = CreateControlFlowNode(typeJumpStatement, NULL, NULL, NULL);
-        }
-    break;
-
-  case 16:
-        {
-            if (g_LoopNestingCounter <= 0)
-                yyerror("'continue' not inside loop");
-            (yylhs.value.a) = CreateControlFlowNode(typeJumpStatement, NULL, NULL, NULL);
-        }
-    break;
-
-  case 17:
-        {
-            currentTable = CreateUserVariableTable(currentTable);
-        }
-    break;
-
-  case 18:
-    {
-        (yylhs.value.a) = (yystack_[1].value.a);
-        HideUserVariableTable(currentTable);
-        currentTable = currentTable->parentTable;
-    }
-    break;
-
-  case 19:
-    {
-        TSymbolTableElementPtr var = LookupUserVariableTableRecursive(currentTable, *(yystack_[2].value.var));
-        if (NULL == var)
-        {
-            yyerror(ErrorMessageVariableNotDeclared(*(yystack_[2].value.var)));
-        }
-        else if ((yystack_[0].value.a)->valueType != var->table->data[var->index].valueType)
-        {
-            yyerror("warning - types incompatible in assignment");
-        }
-        (yylhs.value.a) = CreateAssignmentNode(var, (yystack_[0].value.a));
-    }
-    break;
-
-  case 20:
-        {
-            TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *(yystack_[2].value.var));
-            if (NULL != var)
-            {
-                yyerror(ErrorMessageVariableDoublyDeclared(*(yystack_[2].value.var)));
-            }
-            else
-            {
-                bool kuku = InsertUserVariableTable(currentTable, *(yystack_[2].value.var), typeInt, var);
-                if (false == kuku)
-                    yyerror("Memory allocation or access error");
-            }
-            
-            if ((yystack_[0].value.a)->valueType != var->table->data[var->index].valueType)
-            {
-                yyerror("warning - types incompatible in assignment");
-                (yylhs.value.a) = CreateAssignmentNode(var, CreateNumberNode(0));
-            }
-            else
-            {
-                (yylhs.value.a) = CreateAssignmentNode(var, (yystack_[0].value.a));
-            }
-        }
-    break;
-
-  case 21:
-        {
-            TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *(yystack_[2].value.var));
-            if (NULL != var)
-            {
-                yyerror(ErrorMessageVariableDoublyDeclared(*(yystack_[2].value.var)));
-            }
-            else
-            {
-                bool kuku = InsertUserVariableTable(currentTable, *(yystack_[2].value.var), typeDouble, var);
-                if (false == kuku)
-                    yyerror("Memory allocation or access error");
-            }
-            
-            if ((yystack_[0].value.a)->valueType != var->table->data[var->index].valueType)
-            {
-                yyerror("warning - types incompatible in assignment");
-                (yylhs.value.a) = CreateAssignmentNode(var, CreateNumberNode(0.0f));
-            }
-            else
-            {
-                (yylhs.value.a) = CreateAssignmentNode(var, (yystack_[0].value.a));
-            }
-        }
-    break;
-
-  case 22:
-        {
-            TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *(yystack_[2].value.var));
-            if (NULL != var)
-            {
-                yyerror(ErrorMessageVariableDoublyDeclared(*(yystack_[2].value.var)));
-            }
-            else
-            {
-                bool kuku = InsertUserVariableTable(currentTable, *(yystack_[2].value.var), typeChar, var);
-                if (false == kuku)
-                    yyerror("Memory allocation or access error");
-            }
-            
-            if ((yystack_[0].value.a)->valueType != var->table->data[var->index].valueType)
-            {
-                yyerror("warning - types incompatible in assignment");
-                (yylhs.value.a) = CreateAssignmentNode(var, CreateNumberNode(0));
-            }
-            else
-            {
-                (yylhs.value.a) = CreateAssignmentNode(var, (yystack_[0].value.a));
-            }
-        }
-    break;
-
-  case 23:
-        {
-            TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *(yystack_[2].value.var));
-            if (NULL != var)
-            {
-                yyerror(ErrorMessageVariableDoublyDeclared(*(yystack_[2].value.var)));
-            }
-            else
-            {
-                bool kuku = InsertUserVariableTable(currentTable, *(yystack_[2].value.var), typeBool, var);
-                if (false == kuku)
-                    yyerror("Memory allocation or access error");
-            }
-            
-            if ((yystack_[0].value.a)->valueType != var->table->data[var->index].valueType)
-            {
-                yyerror("warning - types incompatible in assignment");
-                (yylhs.value.a) = CreateAssignmentNode(var, CreateNumberNode(0));
-            }
-            else
-            {
-                (yylhs.value.a) = CreateAssignmentNode(var, (yystack_[0].value.a));
-            }
-        }
-    break;
-
-  case 24:
-        {
-            TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *(yystack_[5].value.var));
-            if (NULL != var)
-            {
-                yyerror(ErrorMessageVariableDoublyDeclared(*(yystack_[5].value.var)));
-            }
-            else
-            {
-                bool kuku = InsertUserVariableTable(currentTable, *(yystack_[5].value.var), typeIntArray, var);
-                if (false == kuku)
-                    yyerror("Memory allocation or access error");
-            }
-            
-            if ((yystack_[1].value.a)->valueType != typeInt)
-            {
-                yyerror("warning - size of array must be const int");
-                (yylhs.value.a) = CreateAssignmentNode(var, CreateNumberNode(new int[0]));
-            }
-            else
-            {
-                (yylhs.value.a) = CreateAssignmentNode(var, CreateNumberNode(new int[reinterpret_cast<TNumericValueNode *>((yystack_[1].value.a))->iNumber]));
-            }
-        }
-    break;
-
-  case 25:
-        {
-            TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *(yystack_[5].value.var));
-            if (NULL != var)
-            {
-                yyerror(ErrorMessageVariableDoublyDeclared(*(yystack_[5].value.var)));
-            }
-            else
-            {
-                bool kuku = InsertUserVariableTable(currentTable, *(yystack_[5].value.var), typeDoubleArray, var);
-                if (false == kuku)
-                    yyerror("Memory allocation or access error");
-            }
-            
-            if ((yystack_[1].value.a)->valueType != typeInt)
-            {
-                yyerror("warning - size of array must be const int");
-                (yylhs.value.a) = CreateAssignmentNode(var, CreateNumberNode(new double[0]));
-            }
-            else
-            {
-                (yylhs.value.a) = CreateAssignmentNode(var, CreateNumberNode(new double[reinterpret_cast<TNumericValueNode *>((yystack_[1].value.a))->iNumber]));
-            }
-        }
-    break;
-
-  case 26:
-        {
-            TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *(yystack_[5].value.var));
-            if (NULL != var)
-            {
-                yyerror(ErrorMessageVariableDoublyDeclared(*(yystack_[5].value.var)));
-            }
-            else
-            {
-                bool kuku = InsertUserVariableTable(currentTable, *(yystack_[5].value.var), typeCharArray, var);
-                if (false == kuku)
-                    yyerror("Memory allocation or access error");
-            }
-            
-            if ((yystack_[1].value.a)->valueType != typeInt)
-            {
-                yyerror("warning - size of array must be const int");
-                (yylhs.value.a) = CreateAssignmentNode(var, CreateNumberNode(new char[0]));
-            }
-            else
-            {
-                (yylhs.value.a) = CreateAssignmentNode(var, CreateNumberNode(new char[reinterpret_cast<TNumericValueNode *>((yystack_[1].value.a))->iNumber]));
-            }
-        }
-    break;
-
-  case 27:
-        {
-            TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *(yystack_[5].value.var));
-            if (NULL != var)
-            {
-                yyerror(ErrorMessageVariableDoublyDeclared(*(yystack_[5].value.var)));
-            }
-            else
-            {
-                bool kuku = InsertUserVariableTable(currentTable, *(yystack_[5].value.var), typeBoolArray, var);
-                if (false == kuku)
-                    yyerror("Memory allocation or access error");
-            }
-            
-            if ((yystack_[1].value.a)->valueType != typeInt)
-            {
-                yyerror("warning - size of array must be const int");
-                (yylhs.value.a) = CreateAssignmentNode(var, CreateNumberNode(new bool[0]));
-            }
-            else
-            {
-                (yylhs.value.a) = CreateAssignmentNode(var, CreateNumberNode(new bool[reinterpret_cast<TNumericValueNode *>((yystack_[1].value.a))->iNumber]));
-            }
-        }
-    break;
-
-  case 28:
-        {
-            (yylhs.value.a) = CreateControlFlowNode(typeIfStatement, (yystack_[2].value.a), (yystack_[0].value.a), NULL);
-        }
-    break;
-
-  case 29:
-        {
-            (yylhs.value.a) = CreateControlFlowNode(typeIfStatement, (yystack_[4].value.a), (yystack_[2].value.a), (yystack_[0].value.a));
-        }
-    break;
-
-  case 30:
-        {
-            (yylhs.value.a) = CreateControlFlowNode(typeWhileStatement, (yystack_[1].value.a), (yystack_[0].value.a), NULL);
-            --g_LoopNestingCounter;
-        }
-    break;
-
-  case 31:
-        {
-            (yylhs.value.a) = CreateControlFlowNode(typeWhileStatement, (yystack_[1].value.a), (yystack_[0].value.a), NULL);
-            --g_LoopNestingCounter;
-        }
-    break;
-
-  case 32:
-        {
-            (yylhs.value.a) = CreateControlFlowNode(typeWhileStatement, (yystack_[0].value.a), (yystack_[1].value.a), NULL);
-            --g_LoopNestingCounter;
-        }
-    break;
-
-  case 33:
-        {
-            (yylhs.value.a) = (yystack_[1].value.a);
-            ++g_LoopNestingCounter;
-        }
-    break;
-
-  case 34:
-        {
-            (yylhs.value.a) = (yystack_[7].value.a);
-            ++g_LoopNestingCounter;
-        }
-    break;
-
-  case 35:
-        {
-            if ((yystack_[2].value.a)->valueType != (yystack_[0].value.a)->valueType)
-            {
-                yyerror("warning - types in relop incompatible");
-                if ((yystack_[2].value.a)->valueType == typeInt)
-                    (yylhs.value.a) = CreateNodeAST(typeBinaryOp, "+", CreateNodeAST(typeUnaryOp, "td", (yystack_[2].value.a), NULL), (yystack_[0].value.a));
-                else
-                    (yylhs.value.a) = CreateNodeAST(typeBinaryOp, "+", (yystack_[2].value.a), CreateNodeAST(typeUnaryOp, "td", (yystack_[0].value.a), NULL));
-            }
-            else
-                (yylhs.value.a) = CreateNodeAST(typeBinaryOp, (yystack_[1].value.s), (yystack_[2].value.a), (yystack_[0].value.a));
-        }
-    break;
-
-  case 36:
-        {
-            if ((yystack_[2].value.a)->valueType != (yystack_[0].value.a)->valueType)
-            {
-                yyerror("warning - types in addop incompatible");
-                if ((yystack_[2].value.a)->valueType == typeInt)
-                    (yylhs.value.a) = CreateNodeAST(typeBinaryOp, "+", CreateNodeAST(typeUnaryOp, "td", (yystack_[2].value.a), NULL), (yystack_[0].value.a));
-                else
-                    (yylhs.value.a) = CreateNodeAST(typeBinaryOp, "+", (yystack_[2].value.a), CreateNodeAST(typeUnaryOp, "td", (yystack_[0].value.a), NULL));
-            }
-            else
-                (yylhs.value.a) = CreateNodeAST(typeBinaryOp, "+", (yystack_[2].value.a), (yystack_[0].value.a));
-        }
-    break;
-
-  case 37:
-        {
-            if ((yystack_[2].value.a)->valueType != (yystack_[0].value.a)->valueType)
-            {
-                yyerror("warning - types in subop incompatible");
-                if ((yystack_[2].value.a)->valueType == typeInt)
-                    (yylhs.value.a) = CreateNodeAST(typeBinaryOp, "+", CreateNodeAST(typeUnaryOp, "td", (yystack_[2].value.a), NULL), (yystack_[0].value.a));
-                else
-                (yylhs.value.a) = CreateNodeAST(typeBinaryOp, "+", (yystack_[2].value.a), CreateNodeAST(typeUnaryOp, "td", (yystack_[0].value.a), NULL));
-            }
-            else
-                (yylhs.value.a) = CreateNodeAST(typeBinaryOp, "-", (yystack_[2].value.a), (yystack_[0].value.a));
-        }
-    break;
-
-  case 38:
-        {
-            if ((yystack_[2].value.a)->valueType != (yystack_[0].value.a)->valueType)
-            {
-                yyerror("warning - types in mulop incompatible");
-                if ((yystack_[2].value.a)->valueType == typeInt)
-                    (yylhs.value.a) = CreateNodeAST(typeBinaryOp, "+", CreateNodeAST(typeUnaryOp, "td", (yystack_[2].value.a), NULL), (yystack_[0].value.a));
-                else
-                    (yylhs.value.a) = CreateNodeAST(typeBinaryOp, "+", (yystack_[2].value.a), CreateNodeAST(typeUnaryOp, "td", (yystack_[0].value.a), NULL));
-            }
-            else
-                (yylhs.value.a) = CreateNodeAST(typeBinaryOp, (yystack_[1].value.s), (yystack_[2].value.a), (yystack_[0].value.a));
-        }
-    break;
-
-  case 39:
-        {
-            (yylhs.value.a) = (yystack_[1].value.a);
-        }
-    break;
-
-  case 40:
-        {
-            (yylhs.value.a) = CreateNodeAST(typeUnaryOp, "-", (yystack_[0].value.a), NULL);
-        }
-    break;
-
-  case 41:
-        {
-            (yylhs.value.a) = CreateNumberNode((yystack_[0].value.d));
-        }
-    break;
-
-  case 42:
-        {
-            (yylhs.value.a) = CreateNumberNode((yystack_[0].value.i));
-        }
-    break;
-
-  case 43:
-        {
-            TSymbolTableElementPtr var = LookupUserVariableTableRecursive(currentTable, *(yystack_[0].value.var));
-            if (NULL == var)
-            {
-                yyerror(ErrorMessageVariableNotDeclared(*(yystack_[0].value.var)));
-            }
-            (yylhs.value.a) = CreateReferenceNode(var);
-        }
-    break;
-
-  case 44:
-        {
-            (yylhs.value.a) = CreateNodeAST(typeInput, "input", (yystack_[1].value.a), NULL);
-        }
-    break;
-
-  case 45:
-        {
-            (yylhs.value.a) = CreateNodeAST(typeOutput, "output", (yystack_[1].value.a), NULL);
-        }
-    break;
-
-  case 46:
-        { (yylhs.value.a) = CreateNumberNode(1);}
-    break;
-
-  case 47:
-            {(yylhs.value.a) = CreateNumberNode(1.1);}
-    break;
-
-  case 48:
-           {(yylhs.value.a) = CreateNumberNode('1');}
-    break;
-
-  case 49:
-           {(yylhs.value.a) = CreateNumberNode(true);}
-    break;
-
-  case 50:
-                                     {(yylhs.value.a) = CreateNumberNode(1);}
-    break;
-
-  case 51:
-                                       {(yylhs.value.a) = CreateNumberNode(1.1);}
-    break;
-
-  case 52:
-                                      {(yylhs.value.a) = CreateNumberNode('1');}
-    break;
-
-  case 53:
-                                      {(yylhs.value.a) = CreateNumberNode(true);}
-    break;
-
-  case 54:
-    {
-	    TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *(yystack_[0].value.var));
-            if (NULL != var)
-            {
-                yyerror(ErrorMessageVariableDoublyDeclared(*(yystack_[0].value.var)));
-            }
-            else
-            {
-                bool kuku = InsertUserVariableTable(currentTable, *(yystack_[0].value.var), (yystack_[1].value.a)->valueType, var);
-                if (false == kuku)
-                    yyerror("Memory allocation or access error");
-            }
-    }
-    break;
-
-  case 55:
-    {
-    	TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *(yystack_[0].value.var));
-        if (NULL != var)
-        {
-            yyerror(ErrorMessageVariableDoublyDeclared(*(yystack_[0].value.var)));
-        }
-        else
-        {
-            bool kuku = InsertUserVariableTable(currentTable, *(yystack_[0].value.var), (yystack_[1].value.a)->valueType, var);
-            if (false == kuku)
-                yyerror("Memory allocation or access error");
-        }
-    }
-    break;
-
-  case 56:
-                             {
-            currentTable = CreateUserVariableTable(currentTable);
-        }
-    break;
-
-  case 57:
-        {
-        	TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *(yystack_[8].value.var));
-            if (NULL != var)
-            {
-                yyerror(ErrorMessageVariableDoublyDeclared(*(yystack_[8].value.var)));
-            }
-            else
-            {
-                bool kuku = InsertUserVariableTable(currentTable, *(yystack_[8].value.var), (yystack_[3].value.a)->valueType, var);
-                if (false == kuku)
-                    yyerror("Memory allocation or access error");
-            }
-            (yylhs.value.a) = CreateControlFlowNode(typeFunctionStatment, NULL, (yystack_[1].value.a), NULL);
-            HideUserVariableTable(currentTable);
-        	currentTable = currentTable->parentTable;
-        }
-    break;
-
-  case 58:
-                              {
-            currentTable = CreateUserVariableTable(currentTable);
-        }
-    break;
-
-  case 59:
-        {
-        	TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *(yystack_[9].value.var));
-            if (NULL != var)
-            {
-                yyerror(ErrorMessageVariableDoublyDeclared(*(yystack_[9].value.var)));
-            }
-            else
-            {
-                bool kuku = InsertUserVariableTable(currentTable, *(yystack_[9].value.var), (yystack_[3].value.a)->valueType, var);
-                if (false == kuku)
-                    yyerror("Memory allocation or access error");
-            }
-            (yylhs.value.a) = CreateControlFlowNode(typeFunctionStatment, NULL, (yystack_[1].value.a), NULL);
-            HideUserVariableTable(currentTable);
-        	currentTable = currentTable->parentTable;
-        }
-    break;
-
-
-
-            default:
-              break;
-            }
-        }
-#if YY_EXCEPTIONS
-      catch (const syntax_error& yyexc)
-        {
-          YYCDEBUG << "Caught exception: " << yyexc.what() << '\n';
-          error (yyexc);
-          YYERROR;
-        }
-#endif // YY_EXCEPTIONS
-      YY_SYMBOL_PRINT ("-> $$ =", yylhs);
-      yypop_ (yylen);
-      yylen = 0;
-      YY_STACK_PRINT ();
-
-      // Shift the result of the reduction.
-      yypush_ (YY_NULLPTR, YY_MOVE (yylhs));
-    }
-    goto yynewstate;
-
-
-  /*--------------------------------------.
-  | yyerrlab -- here on detecting error.  |
-  `--------------------------------------*/
-  yyerrlab:
-    // If not already recovering from an error, report this error.
-    if (!yyerrstatus_)
-      {
-        ++yynerrs_;
-        error (yyla.location, yysyntax_error_ (yystack_[0].state, yyla));
-      }
-
-
-    yyerror_range[1].location = yyla.location;
-    if (yyerrstatus_ == 3)
-      {
-        /* If just tried and failed to reuse lookahead token after an
-           error, discard it.  */
-
-        // Return failure if at end of input.
-        if (yyla.type_get () == yyeof_)
-          YYABORT;
-        else if (!yyla.empty ())
-          {
-            yy_destroy_ ("Error: discarding", yyla);
-            yyla.clear ();
-          }
-      }
-
-    // Else will try to reuse lookahead token after shifting the error token.
-    goto yyerrlab1;
-
-
-  /*---------------------------------------------------.
-  | yyerrorlab -- error raised explicitly by YYERROR.  |
-  `---------------------------------------------------*/
-  yyerrorlab:
-    /* Pacify compilers when the user code never invokes YYERROR and
-       the label yyerrorlab therefore never appears in user code.  */
-    if (false)
-      YYERROR;
-
-    /* Do not reclaim the symbols of the rule whose action triggered
-       this YYERROR.  */
-    yypop_ (yylen);
-    yylen = 0;
-    goto yyerrlab1;
-
-
-  /*-------------------------------------------------------------.
-  | yyerrlab1 -- common code for both syntax error and YYERROR.  |
-  `-------------------------------------------------------------*/
-  yyerrlab1:
-    yyerrstatus_ = 3;   // Each real token shifted decrements this.
-    {
-      stack_symbol_type error_token;
-      for (;;)
-        {
-          yyn = yypact_[+yystack_[0].state];
-          if (!yy_pact_value_is_default_ (yyn))
-            {
-              yyn += yy_error_token_;
-              if (0 <= yyn && yyn <= yylast_ && yycheck_[yyn] == yy_error_token_)
-                {
-                  yyn = yytable_[yyn];
-                  if (0 < yyn)
-                    break;
-                }
-            }
-
-          // Pop the current state because it cannot handle the error token.
-          if (yystack_.size () == 1)
-            YYABORT;
-
-          yyerror_range[1].location = yystack_[0].location;
-          yy_destroy_ ("Error: popping", yystack_[0]);
-          yypop_ ();
-          YY_STACK_PRINT ();
-        }
-
-      yyerror_range[2].location = yyla.location;
-      YYLLOC_DEFAULT (error_token.location, yyerror_range, 2);
-
-      // Shift the error token.
-      error_token.state = state_type (yyn);
-      yypush_ ("Shifting", YY_MOVE (error_token));
-    }
-    goto yynewstate;
-
-
-  /*-------------------------------------.
-  | yyacceptlab -- YYACCEPT comes here.  |
-  `-------------------------------------*/
-  yyacceptlab:
-    yyresult = 0;
-    goto yyreturn;
-
-
-  /*-----------------------------------.
-  | yyabortlab -- YYABORT comes here.  |
-  `-----------------------------------*/
-  yyabortlab:
-    yyresult = 1;
-    goto yyreturn;
-
-
-  /*-----------------------------------------------------.
-  | yyreturn -- parsing is finished, return the result.  |
-  `-----------------------------------------------------*/
-  yyreturn:
-    if (!yyla.empty ())
-      yy_destroy_ ("Cleanup: discarding lookahead", yyla);
-
-    /* Do not reclaim the symbols of the rule whose action triggered
-       this YYABORT or YYACCEPT.  */
-    yypop_ (yylen);
-    while (1 < yystack_.size ())
-      {
-        yy_destroy_ ("Cleanup: popping", yystack_[0]);
-        yypop_ ();
-      }
-
-    return yyresult;
-  }
-#if YY_EXCEPTIONS
-    catch (...)
-      {
-        YYCDEBUG << "Exception caught: cleaning lookahead and stack\n";
-        // Do not try to display the values of the reclaimed symbols,
-        // as their printers might throw an exception.
-        if (!yyla.empty ())
-          yy_destroy_ (YY_NULLPTR, yyla);
-
-        while (1 < yystack_.size ())
-          {
-            yy_destroy_ (YY_NULLPTR, yystack_[0]);
-            yypop_ ();
-          }
-        throw;
-      }
-#endif // YY_EXCEPTIONS
-  }
-
-  void
-  Parser::error (const syntax_error& yyexc)
-  {
-    error (yyexc.location, yyexc.what ());
-  }
-
-  // Generate an error message.
-  std::string
-  Parser::yysyntax_error_ (state_type yystate, const symbol_type& yyla) const
-  {
-    // Number of reported tokens (one for the "unexpected", one per
-    // "expected").
-    std::ptrdiff_t yycount = 0;
-    // Its maximum.
-    enum { YYERROR_VERBOSE_ARGS_MAXIMUM = 5 };
-    // Arguments of yyformat.
-    char const *yyarg[YYERROR_VERBOSE_ARGS_MAXIMUM];
-
-    /* There are many possibilities here to consider:
-       - If this state is a consistent state with a default action, then
-         the only way this function was invoked is if the default action
-         is an error action.  In that case, don't check for expected
-         tokens because there are none.
-       - The only way there can be no lookahead present (in yyla) is
-         if this state is a consistent state with a default action.
-         Thus, detecting the absence of a lookahead is sufficient to
-         determine that there is no unexpected or expected token to
-         report.  In that case, just report a simple "syntax error".
-       - Don't assume there isn't a lookahead just because this state is
-         a consistent state with a default action.  There might have
-         been a previous inconsistent state, consistent state with a
-         non-default action, or user semantic action that manipulated
-         yyla.  (However, yyla is currently not documented for users.)
-       - Of course, the expected token list depends on states to have
-         correct lookahead information, and it depends on the parser not
-         to perform extra reductions after fetching a lookahead from the
-         scanner and before detecting a syntax error.  Thus, state merging
-         (from LALR or IELR) and default reductions corrupt the expected
-         token list.  However, the list is correct for canonical LR with
-         one exception: it will still contain any token that will not be
-         accepted due to an error action in a later state.
-    */
-    if (!yyla.empty ())
-      {
-        symbol_number_type yytoken = yyla.type_get ();
-        yyarg[yycount++] = yytname_[yytoken];
-
-        int yyn = yypact_[+yystate];
-        if (!yy_pact_value_is_default_ (yyn))
-          {
-            /* Start YYX at -YYN if negative to avoid negative indexes in
-               YYCHECK.  In other words, skip the first -YYN actions for
-               this state because they are default actions.  */
-            int yyxbegin = yyn < 0 ? -yyn : 0;
-            // Stay within bounds of both yycheck and yytname.
-            int yychecklim = yylast_ - yyn + 1;
-            int yyxend = yychecklim < yyntokens_ ? yychecklim : yyntokens_;
-            for (int yyx = yyxbegin; yyx < yyxend; ++yyx)
-              if (yycheck_[yyx + yyn] == yyx && yyx != yy_error_token_
-                  && !yy_table_value_is_error_ (yytable_[yyx + yyn]))
-                {
-                  if (yycount == YYERROR_VERBOSE_ARGS_MAXIMUM)
-                    {
-                      yycount = 1;
-                      break;
-                    }
-                  else
-                    yyarg[yycount++] = yytname_[yyx];
-                }
-          }
-      }
-
-    char const* yyformat = YY_NULLPTR;
-    switch (yycount)
-      {
-#define YYCASE_(N, S)                         \
-        case N:                               \
-          yyformat = S;                       \
-        break
-      default: // Avoid compiler warnings.
-        YYCASE_ (0, YY_("syntax error"));
-        YYCASE_ (1, YY_("syntax error, unexpected %s"));
-        YYCASE_ (2, YY_("syntax error, unexpected %s, expecting %s"));
-        YYCASE_ (3, YY_("syntax error, unexpected %s, expecting %s or %s"));
-        YYCASE_ (4, YY_("syntax error, unexpected %s, expecting %s or %s or %s"));
-        YYCASE_ (5, YY_("syntax error, unexpected %s, expecting %s or %s or %s or %s"));
-#undef YYCASE_
-      }
-
-    std::string yyres;
-    // Argument number.
-    std::ptrdiff_t yyi = 0;
-    for (char const* yyp = yyformat; *yyp; ++yyp)
-      if (yyp[0] == '%' && yyp[1] == 's' && yyi < yycount)
-        {
-          yyres += yytnamerr_ (yyarg[yyi++]);
-          ++yyp;
-        }
-      else
-        yyres += *yyp;
-    return yyres;
-  }
-
-
-  const signed char Parser::yypact_ninf_ = -84;
-
-  const signed char Parser::yytable_ninf_ = -57;
-
-  const short
-  Parser::yypact_[] =
-  {
-      62,   -14,   -84,   -10,     6,    11,    12,    14,    62,    19,
-      31,   -84,   -84,   -84,    32,    35,    46,    60,   -84,    62,
-     -84,   -84,   -84,   -84,   -84,    62,    62,   -84,   -84,   -84,
-      96,    62,    96,    53,    55,    57,    58,    56,    96,    96,
-      96,    96,    81,   -84,   -84,   -84,   -84,   -84,   -84,   -84,
-     -84,    96,    96,    70,    86,   116,    54,    39,    27,    10,
-     -84,   120,    99,   130,   134,    83,   -84,   144,    96,    96,
-      96,    96,   -84,    62,    97,    70,   102,    70,   105,    70,
-     106,    70,   -84,    96,   -84,   -84,   115,   175,   -84,    47,
-     110,   110,   -84,   112,    96,    96,    96,    96,   194,   100,
-     122,   132,   135,   136,   141,   -12,    62,   158,   166,   174,
-     182,    96,   175,   145,   147,   149,   155,   -84,   128,   175,
-     -84,   -84,   -84,   -84,   -84,   104,   159,   -84,   -84,   -84,
-     -84,   175,   165,    96,    62,   167,   -84,   148,   173,    62,
-     -84,   -84,   181,   -84
-  };
-
-  const signed char
-  Parser::yydefact_[] =
-  {
-       0,     0,    17,     0,     0,     0,     0,     0,     0,     0,
-       0,    15,    16,    14,     0,     0,     0,     0,     2,     4,
-       9,     6,     8,     7,    10,     0,     0,    12,    11,    13,
-       0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
-       0,     0,     0,     1,     5,     3,    30,    31,    41,    42,
-      43,     0,     0,    19,     0,     0,     0,     0,     0,     0,
-      32,     0,     0,     0,     0,    58,    40,     0,     0,     0,
-       0,     0,    18,     0,     0,    20,     0,    21,     0,    22,
-       0,    23,    33,     0,    44,    45,     0,     0,    39,    35,
-      36,    37,    38,    28,     0,     0,     0,     0,     0,     0,
-      46,    47,    48,    49,     0,     0,     0,     0,     0,     0,
-       0,     0,     0,     0,     0,     0,     0,    54,     0,     0,
-      29,    24,    25,    26,    27,    35,     0,    50,    51,    52,
-      53,     0,     0,     0,     0,     0,    55,     0,     0,     0,
-      34,    57,     0,    59
-  };
-
-  const short
-  Parser::yypgoto_[] =
-  {
-     -84,   -84,   -19,   -84,    -3,   -84,   -84,   -84,   -84,   -84,
-     -84,   139,   -84,   -31,   -84,   -84,   -83,   -84,   -84,   -84,
-     -84
-  };
-
-  const signed char
-  Parser::yydefgoto_[] =
-  {
-      -1,    17,    18,    45,    19,    20,    31,    21,    22,    23,
-      24,    25,    26,    53,    27,    28,   104,   105,    29,    86,
-      87
-  };
-
-  const short
-  Parser::yytable_[] =
-  {
-      44,    55,    30,   118,    32,    37,   119,    61,    62,    63,
-      64,    33,    54,    48,    49,    50,    34,    35,    51,    36,
-      66,    67,    46,    47,    52,    75,    77,    79,    81,   126,
-      48,    49,    50,    38,    80,    51,   132,    89,    90,    91,
-      92,    52,    48,    49,    50,    39,    40,    51,   135,    41,
-      78,    42,    98,    52,    69,    70,    71,    48,    49,    50,
-      43,    76,    51,   107,   108,   109,   110,     1,    52,    56,
-      93,    57,     2,    58,    59,    74,    68,    69,    70,    71,
-     125,     3,     9,     4,     5,     6,     7,     8,     9,    10,
-      11,    12,    13,    14,    15,    65,    16,    72,   -56,    48,
-      49,    50,   137,   120,    51,    68,    69,    70,    71,    94,
-      52,    69,    70,    71,    95,   138,    83,    96,    97,    71,
-     142,   133,    68,    69,    70,    71,    68,    69,    70,    71,
-      99,    73,   106,   112,   113,    82,    68,    69,    70,    71,
-      68,    69,    70,    71,   114,    84,   117,   115,   116,    85,
-      68,    69,    70,    71,    68,    69,    70,    71,   127,    88,
-     128,   131,   129,   140,    68,    69,    70,    71,   130,   134,
-     136,   121,    68,    69,    70,    71,    60,   139,     0,   122,
-      68,    69,    70,    71,   141,     0,     0,   123,    68,    69,
-      70,    71,   143,     0,     0,   124,   100,   101,   102,   103,
-     111,    69,    70,    71
-  };
-
-  const short
-  Parser::yycheck_[] =
-  {
-      19,    32,    16,    15,    14,     8,    18,    38,    39,    40,
-      41,     5,    31,     3,     4,     5,     5,     5,     8,     5,
-      51,    52,    25,    26,    14,    56,    57,    58,    59,   112,
-       3,     4,     5,    14,    24,     8,   119,    68,    69,    70,
-      71,    14,     3,     4,     5,    14,    14,     8,   131,    14,
-      23,     5,    83,    14,     7,     8,     9,     3,     4,     5,
-       0,    22,     8,    94,    95,    96,    97,     5,    14,    16,
-      73,    16,    10,    16,    16,    21,     6,     7,     8,     9,
-     111,    19,    26,    21,    22,    23,    24,    25,    26,    27,
-      28,    29,    30,    31,    32,    14,    34,    11,    15,     3,
-       4,     5,   133,   106,     8,     6,     7,     8,     9,    12,
-      14,     7,     8,     9,    12,   134,    17,    12,    12,     9,
-     139,    17,     6,     7,     8,     9,     6,     7,     8,     9,
-      15,    15,    20,    33,    12,    15,     6,     7,     8,     9,
-       6,     7,     8,     9,    12,    15,     5,    12,    12,    15,
-       6,     7,     8,     9,     6,     7,     8,     9,    13,    15,
-      13,    33,    13,    15,     6,     7,     8,     9,    13,    10,
-       5,    13,     6,     7,     8,     9,    37,    10,    -1,    13,
-       6,     7,     8,     9,    11,    -1,    -1,    13,     6,     7,
-       8,     9,    11,    -1,    -1,    13,    21,    22,    23,    24,
-       6,     7,     8,     9
-  };
-
-  const signed char
-  Parser::yystos_[] =
-  {
-       0,     5,    10,    19,    21,    22,    23,    24,    25,    26,
-      27,    28,    29,    30,    31,    32,    34,    39,    40,    42,
-      43,    45,    46,    47,    48,    49,    50,    52,    53,    56,
-      16,    44,    14,     5,     5,     5,     5,    42,    14,    14,
-      14,    14,     5,     0,    40,    41,    42,    42,     3,     4,
-       5,     8,    14,    51,    40,    51,    16,    16,    16,    16,
-      49,    51,    51,    51,    51,    14,    51,    51,     6,     7,
-       8,     9,    11,    15,    21,    51,    22,    51,    23,    51,
-      24,    51,    15,    17,    15,    15,    57,    58,    15,    51,
-      51,    51,    51,    42,    12,    12,    12,    12,    51,    15,
-      21,    22,    23,    24,    54,    55,    20,    51,    51,    51,
-      51,     6,    33,    12,    12,    12,    12,     5,    15,    18,
-      42,    13,    13,    13,    13,    51,    54,    13,    13,    13,
-      13,    33,    54,    17,    10,    54,     5,    51,    40,    10,
-      15,    11,    40,    11
-  };
-
-  const signed char
-  Parser::yyr1_[] =
-  {
-       0,    38,    39,    40,    41,    41,    42,    42,    42,    42,
-      42,    42,    42,    42,    42,    42,    42,    44,    43,    45,
-      46,    46,    46,    46,    46,    46,    46,    46,    47,    47,
-      48,    48,    48,    49,    50,    51,    51,    51,    51,    51,
-      51,    51,    51,    51,    52,    53,    54,    54,    54,    54,
-      54,    54,    54,    54,    55,    55,    57,    56,    58,    56
-  };
-
-  const signed char
-  Parser::yyr2_[] =
-  {
-       0,     2,     1,     2,     0,     1,     1,     1,     1,     1,
-       1,     1,     1,     1,     1,     1,     1,     0,     4,     3,
-       4,     4,     4,     4,     7,     7,     7,     7,     5,     7,
-       2,     2,     3,     4,    10,     3,     3,     3,     3,     3,
-       2,     1,     1,     1,     4,     4,     1,     1,     1,     1,
-       3,     3,     3,     3,     2,     4,     0,    10,     0,    11
-  };
-
-
-
-  // YYTNAME[SYMBOL-NUM] -- String name of the symbol SYMBOL-NUM.
-  // First, the terminals, then, starting at \a yyntokens_, nonterminals.
-  const char*
-  const Parser::yytname_[] =
-  {
-  "\"end of file\"", "error", "$undefined",
-  "\"floating point double precision\"", "\"integer\"", "\"name\"",
-  "\"relop\"", "\"plus\"", "\"minus\"", "\"mulop\"", "\"{\"", "\"}\"",
-  "\"[\"", "\"]\"", "\"(\"", "\")\"", "\"=\"", "\";\"", "\",\"", "\"if\"",
-  "\"else\"", "\"int\"", "\"float\"", "\"char\"", "\"bool\"", "\"do\"",
-  "\"while\"", "\"for\"", "\"break\"", "\"continue\"", "\"return\"",
-  "\"input\"", "\"echa\"", "\"->\"", "\"func\"", "\"main\"", "IFX",
-  "UMINUS", "$accept", "prog", "stmtlist", "stmtlist_tail", "statement",
-  "compound_statement", "$@1", "assignment", "declarations", "cond_stmt",
-  "loop_stmt", "while_head", "for_head", "exp", "input", "echa", "type",
-  "func_params", "func", "$@2", "$@3", YY_NULLPTR
-  };
-
-#if YYDEBUG
-  const short
-  Parser::yyrline_[] =
-  {
-       0,   121,   121,   142,   152,   156,   163,   163,   163,   163,
-     163,   163,   163,   163,   163,   167,   173,   183,   182,   197,
-     214,   238,   262,   286,   311,   335,   359,   383,   411,   415,
-     423,   428,   433,   441,   449,   458,   471,   484,   497,   510,
-     514,   518,   522,   526,   539,   547,   555,   556,   557,   558,
-     559,   560,   561,   562,   566,   580,   597,   597,   617,   617
-  };
-
-  // Print the state stack on the debug stream.
-  void
-  Parser::yystack_print_ ()
-  {
-    *yycdebug_ << "Stack now";
-    for (stack_type::const_iterator
-           i = yystack_.begin (),
-           i_end = yystack_.end ();
-         i != i_end; ++i)
-      *yycdebug_ << ' ' << int (i->state);
-    *yycdebug_ << '\n';
-  }
-
-  // Report on the debug stream that the rule \a yyrule is going to be reduced.
-  void
-  Parser::yy_reduce_print_ (int yyrule)
-  {
-    int yylno = yyrline_[yyrule];
-    int yynrhs = yyr2_[yyrule];
-    // Print the symbols being reduced, and their result.
-    *yycdebug_ << "Reducing stack by rule " << yyrule - 1
-               << " (line " << yylno << "):\n";
-    // The symbols being reduced.
-    for (int yyi = 0; yyi < yynrhs; yyi++)
-      YY_SYMBOL_PRINT ("   $" << yyi + 1 << " =",
-                       yystack_[(yynrhs) - (yyi + 1)]);
-  }
-#endif // YYDEBUG
-
-  Parser::token_number_type
-  Parser::yytranslate_ (int t)
-  {
-    // YYTRANSLATE[TOKEN-NUM] -- Symbol number corresponding to
-    // TOKEN-NUM as returned by yylex.
-    static
-    const token_number_type
-    translate_table[] =
-    {
-       0,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
-       5,     6,     7,     8,     9,    10,    11,    12,    13,    14,
-      15,    16,    17,    18,    19,    20,    21,    22,    23,    24,
-      25,    26,    27,    28,    29,    30,    31,    32,    33,    34,
-      35,    36,    37
-    };
-    const int user_token_number_max_ = 292;
-
-    if (t <= 0)
-      return yyeof_;
-    else if (t <= user_token_number_max_)
-      return translate_table[t];
-    else
-      return yy_undef_token_;
-  }
-
-} // yy
-
-
-void yy::Parser::error(const location_type& l, const std::string& m)
-{
-    driver.error(l, m);
-}
-
-static std::string ErrorMessageVariableNotDeclared(std::string name)
-{
-    std::string errorDeclaration = "warning - Variable " + name + " isn't declared";
-    return errorDeclaration;
-}
-
-static std::string ErrorMessageVariableDoublyDeclared(std::string name)
-{
-    std::string errorDeclaration = "warning - Variable " + name + " is already declared";
-        return errorDeclaration;
-}
-
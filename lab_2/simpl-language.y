@@ -23,17 +23,21 @@
 
 %code requires
 {
+  #include "simpl-source.hpp"
   class Simpl_driver;
 }
 
-// The parsing context
+// The parsing context and the reentrant scanner it reads from
 %param { Simpl_driver& driver }
+%param { void* yyscanner }
 
+// Locations are source offsets, resolved to lines only for diagnostics
 %locations
+%define api.location.type {TSourceSpan}
 %initial-action
 {
   // Initialize the initial location.
-  @$.begin.filename = @$.end.filename = &driver.filename;
+  @$.begin = @$.end = 0;
 };
 
 %define parse.trace
@@ -46,19 +50,17 @@
 
 static std::string ErrorMessageVariableNotDeclared(std::string);
 static std::string ErrorMessageVariableDoublyDeclared(std::string);
+static TNodeIndex FoldExpression(Simpl_driver& driver, TNodeIndex a);
+static int ArraySize(Simpl_driver& driver, TNodeIndex size);
 
-int g_LoopNestingCounter = 0;
-
-static TSymbolTable* g_TopLevelUserVariableTable = CreateUserVariableTable(NULL);
-static TSymbolTable* currentTable = g_TopLevelUserVariableTable;
 }
 
 %union
 {
-  NodeAST* a;
+  TNodeIndex a;
   double d;
   int i;
-  std::string* var;
+  const TIdentifier* var;
   char s[3];
 }
 
@@ -99,7 +101,7 @@ static TSymbolTable* currentTable = g_TopLevelUserVariableTable;
 %token          MAIN            "main"
 %token IFX
 
-%type <a> exp cond_stmt assignment statement compound_statement stmtlist stmtlist_tail prog declarations loop_stmt for_head while_head echa input func main_func type
+%type <a> exp cond_stmt assignment statement compound_statement stmtlist prog program declarations loop_stmt for_clause while_head echa input func main_func type
 
 %nonassoc IFX
 %nonassoc ELSE
@@ -114,81 +116,92 @@ static TSymbolTable* currentTable = g_TopLevelUserVariableTable;
 
 %printer { yyoutput << $$; } <*>;
 
-%destructor { delete $$; } VARIABLE
 %%
 /*------------------------------------------------------------*/
 prog :
-    stmtlist
+    program
         {
-            if (driver.AST_dumping)
+            $1 = CloseListNode(driver.tree, $1);
+            /* a streamed program has been dumped statement by statement */
+            if (driver.AST_dumping && !driver.streaming)
             {
-                PrintAST($1, 0);
+                PrintAST(driver.tree, $1, 0, *driver.out);
             }
-            if (driver.XML_dumping)
+            if (driver.XML_dumping && !driver.streaming)
             {
                 std::ofstream xmlFile;
                 xmlFile.open(driver.XML_dumping_path);
-                printf("Write XML into \'%s\'\n", driver.XML_dumping_path.c_str());
-                WriteXml($1, 0, xmlFile);
+                *driver.out << "Write XML into '" << driver.XML_dumping_path << "'" << std::endl;
+                WriteXml(driver.tree, $1, 0, xmlFile);
                 xmlFile.close();
             }
-            FreeAST($1);
-            DestroyUserVariableTable(currentTable);
+            if (driver.keep_ast)
+            {
+                driver.ast = $1;
+                driver.ast_symbols = driver.symbols;
+            }
+            else
+            {
+                DestroyUserVariableTable(driver.symbols);
+            }
+            driver.symbols = NULL;
             driver.result = 0;
         }
 ;
 
-stmtlist :
-    statement stmtlist_tail
+/* Top-level statements, left-recursive so that the parser stack stays
+   shallow and each statement is complete as soon as it is reduced */
+program :
+    statement
         {
-            if ($2 == NULL)
-                $$ = $1;
-            else
-                $$ = CreateNodeAST(typeList, "L", $1, $2);
+            $$ = driver.add_statement(NO_NODE, $1);
+        }
+    | program statement
+        {
+            $$ = driver.add_statement($1, $2);
         }
 ;
 
-stmtlist_tail :
-    %empty
+stmtlist :
+    statement
         {
-            $$ = NULL;
+            $$ = CreateListNode(driver.tree, $1);
         }
-    | stmtlist
+    | stmtlist statement
         {
-            $$ = $1;
+            $$ = AppendListNode(driver.tree, $1, $2);
         }
 ;
 
 statement :
     assignment | cond_stmt | declarations | compound_statement | loop_stmt | echa | input | func | RETURN
         {
-            $$ = CreateControlFlowNode(typeJumpStatement, NULL, NULL, NULL);
+            $$ = CreateJumpNode(driver.tree, jumpReturn);
         }
     | BREAK
         {
-            if (g_LoopNestingCounter <= 0)
+            if (driver.loop_nesting <= 0)
                 yyerror("'break' not inside loop");
-            $$ = CreateControlFlowNode(typeJumpStatement, NULL, NULL, NULL);
+            $$ = CreateJumpNode(driver.tree, jumpBreak);
         }
     | CONTINUE
         {
-            if (g_LoopNestingCounter <= 0)
+            if (driver.loop_nesting <= 0)
                 yyerror("'continue' not inside loop");
-            $$ = CreateControlFlowNode(typeJumpStatement, NULL, NULL, NULL);
+            $$ = CreateJumpNode(driver.tree, jumpContinue);
         }
 ;
 
 compound_statement :
     OPENBRACE
         {
-            currentTable = CreateUserVariableTable(currentTable);
+            EnterScope(driver.symbols);
         }
     stmtlist
     CLOSEBRACE
     {
-        $$ = $3;
-        HideUserVariableTable(currentTable);
-        currentTable = currentTable->parentTable;
+        $$ = CloseListNode(driver.tree, $3);
+        ExitScope(driver.symbols);
     }
 ;
 
@@ -196,16 +209,16 @@ compound_statement :
 assignment :
     VARIABLE ASSIGN exp
     {
-        TSymbolTableElementPtr var = LookupUserVariableTableRecursive(currentTable, *$1);
-        if (NULL == var)
+        TSymbolId var = LookupSymbolRecursive(driver.symbols, $1);
+        if (NO_SYMBOL == var)
         {
-            yyerror(ErrorMessageVariableNotDeclared(*$1));
+            yyerror(ErrorMessageVariableNotDeclared($1->name));
         }
-        else if ($3->valueType != var->table->data[var->index].valueType)
+        else if (NodeValueType(driver.tree, $3) != SymbolRecord(driver.symbols, var).valueType)
         {
             yyerror("warning - types incompatible in assignment");
         }
-        $$ = CreateAssignmentNode(var, $3);
+        $$ = CreateAssignmentNode(driver.tree, var, $3);
     }
 ;
 
@@ -213,195 +226,215 @@ assignment :
 declarations :
     INT VARIABLE ASSIGN exp
         {
-            TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *$2);
-            if (NULL != var)
+            TSymbolId var = LookupSymbol(driver.symbols, $2);
+            if (NO_SYMBOL != var)
             {
-                yyerror(ErrorMessageVariableDoublyDeclared(*$2));
+                yyerror(ErrorMessageVariableDoublyDeclared($2->name));
             }
             else
             {
-                bool kuku = InsertUserVariableTable(currentTable, *$2, typeInt, var);
-                if (false == kuku)
+                var = DeclareSymbol(driver.symbols, $2, typeInt);
+                if (NO_SYMBOL == var)
                     yyerror("Memory allocation or access error");
             }
             
-            if ($4->valueType != var->table->data[var->index].valueType)
+            if (NO_SYMBOL == var)
+            {
+                /* nothing was declared, its error has been reported */
+                $$ = CreateAssignmentNode(driver.tree, var, $4);
+            }
+            else if (NodeValueType(driver.tree, $4) != SymbolRecord(driver.symbols, var).valueType)
             {
                 yyerror("warning - types incompatible in assignment");
-                $$ = CreateAssignmentNode(var, CreateNumberNode(0));
+                $$ = CreateAssignmentNode(driver.tree, var, CreateNumberNode(driver.tree, 0));
             }
             else
             {
-                $$ = CreateAssignmentNode(var, $4);
+                $$ = CreateAssignmentNode(driver.tree, var, $4);
             }
         }
     | FLOAT VARIABLE ASSIGN exp
         {
-            TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *$2);
-            if (NULL != var)
+            TSymbolId var = LookupSymbol(driver.symbols, $2);
+            if (NO_SYMBOL != var)
             {
-                yyerror(ErrorMessageVariableDoublyDeclared(*$2));
+                yyerror(ErrorMessageVariableDoublyDeclared($2->name));
             }
             else
             {
-                bool kuku = InsertUserVariableTable(currentTable, *$2, typeDouble, var);
-                if (false == kuku)
+                var = DeclareSymbol(driver.symbols, $2, typeDouble);
+                if (NO_SYMBOL == var)
                     yyerror("Memory allocation or access error");
             }
             
-            if ($4->valueType != var->table->data[var->index].valueType)
+            if (NO_SYMBOL == var)
+            {
+                /* nothing was declared, its error has been reported */
+                $$ = CreateAssignmentNode(driver.tree, var, $4);
+            }
+            else if (NodeValueType(driver.tree, $4) != SymbolRecord(driver.symbols, var).valueType)
             {
                 yyerror("warning - types incompatible in assignment");
-                $$ = CreateAssignmentNode(var, CreateNumberNode(0.0f));
+                $$ = CreateAssignmentNode(driver.tree, var, CreateNumberNode(driver.tree, 0.0f));
             }
             else
             {
-                $$ = CreateAssignmentNode(var, $4);
+                $$ = CreateAssignmentNode(driver.tree, var, $4);
             }
         }
     | CHAR VARIABLE ASSIGN exp
         {
-            TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *$2);
-            if (NULL != var)
+            TSymbolId var = LookupSymbol(driver.symbols, $2);
+            if (NO_SYMBOL != var)
             {
-                yyerror(ErrorMessageVariableDoublyDeclared(*$2));
+                yyerror(ErrorMessageVariableDoublyDeclared($2->name));
             }
             else
             {
-                bool kuku = InsertUserVariableTable(currentTable, *$2, typeChar, var);
-                if (false == kuku)
+                var = DeclareSymbol(driver.symbols, $2, typeChar);
+                if (NO_SYMBOL == var)
                     yyerror("Memory allocation or access error");
             }
             
-            if ($4->valueType != var->table->data[var->index].valueType)
+            if (NO_SYMBOL == var)
+            {
+                /* nothing was declared, its error has been reported */
+                $$ = CreateAssignmentNode(driver.tree, var, $4);
+            }
+            else if (NodeValueType(driver.tree, $4) != SymbolRecord(driver.symbols, var).valueType)
             {
                 yyerror("warning - types incompatible in assignment");
-                $$ = CreateAssignmentNode(var, CreateNumberNode(0));
+                $$ = CreateAssignmentNode(driver.tree, var, CreateNumberNode(driver.tree, 0));
             }
             else
             {
-                $$ = CreateAssignmentNode(var, $4);
+                $$ = CreateAssignmentNode(driver.tree, var, $4);
             }
         }
     | BOOL VARIABLE ASSIGN exp
         {
-            TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *$2);
-            if (NULL != var)
+            TSymbolId var = LookupSymbol(driver.symbols, $2);
+            if (NO_SYMBOL != var)
             {
-                yyerror(ErrorMessageVariableDoublyDeclared(*$2));
+                yyerror(ErrorMessageVariableDoublyDeclared($2->name));
             }
             else
             {
-                bool kuku = InsertUserVariableTable(currentTable, *$2, typeBool, var);
-                if (false == kuku)
+                var = DeclareSymbol(driver.symbols, $2, typeBool);
+                if (NO_SYMBOL == var)
                     yyerror("Memory allocation or access error");
             }
             
-            if ($4->valueType != var->table->data[var->index].valueType)
+            if (NO_SYMBOL == var)
+            {
+                /* nothing was declared, its error has been reported */
+                $$ = CreateAssignmentNode(driver.tree, var, $4);
+            }
+            else if (NodeValueType(driver.tree, $4) != SymbolRecord(driver.symbols, var).valueType)
             {
                 yyerror("warning - types incompatible in assignment");
-                $$ = CreateAssignmentNode(var, CreateNumberNode(0));
+                $$ = CreateAssignmentNode(driver.tree, var, CreateNumberNode(driver.tree, 0));
             }
             else
             {
-                $$ = CreateAssignmentNode(var, $4);
+                $$ = CreateAssignmentNode(driver.tree, var, $4);
             }
         }
 // arrays
     | INT VARIABLE ASSIGN INT OPENSQRBRACE exp CLOSESQRBRACE
         {
-            TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *$2);
-            if (NULL != var)
+            TSymbolId var = LookupSymbol(driver.symbols, $2);
+            if (NO_SYMBOL != var)
             {
-                yyerror(ErrorMessageVariableDoublyDeclared(*$2));
+                yyerror(ErrorMessageVariableDoublyDeclared($2->name));
             }
             else
             {
-                bool kuku = InsertUserVariableTable(currentTable, *$2, typeIntArray, var);
-                if (false == kuku)
+                var = DeclareSymbol(driver.symbols, $2, typeIntArray);
+                if (NO_SYMBOL == var)
                     yyerror("Memory allocation or access error");
             }
             
-            if ($6->valueType != typeInt)
+            if (NodeValueType(driver.tree, $6) != typeInt)
             {
                 yyerror("warning - size of array must be const int");
-                $$ = CreateAssignmentNode(var, CreateNumberNode(new int[0]));
+                $$ = CreateAssignmentNode(driver.tree, var, CreateNumberNode(driver.tree, (int *) AllocateArray(driver.tree, 0)));
             }
             else
             {
-                $$ = CreateAssignmentNode(var, CreateNumberNode(new int[reinterpret_cast<TNumericValueNode *>($6)->iNumber]));
+                $$ = CreateAssignmentNode(driver.tree, var, CreateNumberNode(driver.tree, (int *) AllocateArray(driver.tree, ArraySize(driver, $6) * sizeof(int))));
             }
         }
     | FLOAT VARIABLE ASSIGN FLOAT OPENSQRBRACE exp CLOSESQRBRACE
         {
-            TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *$2);
-            if (NULL != var)
+            TSymbolId var = LookupSymbol(driver.symbols, $2);
+            if (NO_SYMBOL != var)
             {
-                yyerror(ErrorMessageVariableDoublyDeclared(*$2));
+                yyerror(ErrorMessageVariableDoublyDeclared($2->name));
             }
             else
             {
-                bool kuku = InsertUserVariableTable(currentTable, *$2, typeDoubleArray, var);
-                if (false == kuku)
+                var = DeclareSymbol(driver.symbols, $2, typeDoubleArray);
+                if (NO_SYMBOL == var)
                     yyerror("Memory allocation or access error");
             }
             
-            if ($6->valueType != typeInt)
+            if (NodeValueType(driver.tree, $6) != typeInt)
             {
                 yyerror("warning - size of array must be const int");
-                $$ = CreateAssignmentNode(var, CreateNumberNode(new double[0]));
+                $$ = CreateAssignmentNode(driver.tree, var, CreateNumberNode(driver.tree, (double *) AllocateArray(driver.tree, 0)));
             }
             else
             {
-                $$ = CreateAssignmentNode(var, CreateNumberNode(new double[reinterpret_cast<TNumericValueNode *>($6)->iNumber]));
+                $$ = CreateAssignmentNode(driver.tree, var, CreateNumberNode(driver.tree, (double *) AllocateArray(driver.tree, ArraySize(driver, $6) * sizeof(double))));
             }
         }
     | CHAR VARIABLE ASSIGN CHAR OPENSQRBRACE exp CLOSESQRBRACE
         {
-            TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *$2);
-            if (NULL != var)
+            TSymbolId var = LookupSymbol(driver.symbols, $2);
+            if (NO_SYMBOL != var)
             {
-                yyerror(ErrorMessageVariableDoublyDeclared(*$2));
+                yyerror(ErrorMessageVariableDoublyDeclared($2->name));
             }
             else
             {
-                bool kuku = InsertUserVariableTable(currentTable, *$2, typeCharArray, var);
-                if (false == kuku)
+                var = DeclareSymbol(driver.symbols, $2, typeCharArray);
+                if (NO_SYMBOL == var)
                     yyerror("Memory allocation or access error");
             }
             
-            if ($6->valueType != typeInt)
+            if (NodeValueType(driver.tree, $6) != typeInt)
             {
                 yyerror("warning - size of array must be const int");
-                $$ = CreateAssignmentNode(var, CreateNumberNode(new char[0]));
+                $$ = CreateAssignmentNode(driver.tree, var, CreateNumberNode(driver.tree, (char *) AllocateArray(driver.tree, 0)));
             }
             else
             {
-                $$ = CreateAssignmentNode(var, CreateNumberNode(new char[reinterpret_cast<TNumericValueNode *>($6)->iNumber]));
+                $$ = CreateAssignmentNode(driver.tree, var, CreateNumberNode(driver.tree, (char *) AllocateArray(driver.tree, ArraySize(driver, $6) * sizeof(char))));
             }
         }
     | BOOL VARIABLE ASSIGN BOOL OPENSQRBRACE exp CLOSESQRBRACE
         {
-            TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *$2);
-            if (NULL != var)
+            TSymbolId var = LookupSymbol(driver.symbols, $2);
+            if (NO_SYMBOL != var)
             {
-                yyerror(ErrorMessageVariableDoublyDeclared(*$2));
+                yyerror(ErrorMessageVariableDoublyDeclared($2->name));
             }
             else
             {
-                bool kuku = InsertUserVariableTable(currentTable, *$2, typeBoolArray, var);
-                if (false == kuku)
+                var = DeclareSymbol(driver.symbols, $2, typeBoolArray);
+                if (NO_SYMBOL == var)
                     yyerror("Memory allocation or access error");
             }
             
-            if ($6->valueType != typeInt)
+            if (NodeValueType(driver.tree, $6) != typeInt)
             {
                 yyerror("warning - size of array must be const int");
-                $$ = CreateAssignmentNode(var, CreateNumberNode(new bool[0]));
+                $$ = CreateAssignmentNode(driver.tree, var, CreateNumberNode(driver.tree, (bool *) AllocateArray(driver.tree, 0)));
             }
             else
             {
-                $$ = CreateAssignmentNode(var, CreateNumberNode(new bool[reinterpret_cast<TNumericValueNode *>($6)->iNumber]));
+                $$ = CreateAssignmentNode(driver.tree, var, CreateNumberNode(driver.tree, (bool *) AllocateArray(driver.tree, ArraySize(driver, $6) * sizeof(bool))));
             }
         }
   ;
@@ -410,11 +443,11 @@ declarations :
 cond_stmt:
     IF OPENPAREN exp CLOSEPAREN statement %prec IFX
         {
-            $$ = CreateControlFlowNode(typeIfStatement, $3, $5, NULL);
+            $$ = CreateControlFlowNode(driver.tree, typeIfStatement, $3, $5, NO_NODE);
         }
     | IF OPENPAREN exp CLOSEPAREN statement ELSE statement
         {
-            $$ = CreateControlFlowNode(typeIfStatement, $3, $5, $7);
+            $$ = CreateControlFlowNode(driver.tree, typeIfStatement, $3, $5, $7);
         }
 ;
 
@@ -422,18 +455,28 @@ cond_stmt:
 loop_stmt :
     while_head statement
         {
-            $$ = CreateControlFlowNode(typeWhileStatement, $1, $2, NULL);
-            --g_LoopNestingCounter;
+            $$ = CreateLoopNode(driver.tree, loopWhile, $1, $2, NO_NODE);
+            --driver.loop_nesting;
+        }
+    | FOR OPENPAREN for_clause SEMICOLON exp SEMICOLON for_clause CLOSEPAREN
+        {
+            ++driver.loop_nesting;
+        }
+    statement
+        {
+            /* the initialization runs once, before the loop */
+            TNodeIndex loop = CreateLoopNode(driver.tree, loopFor, $5, $10, $7);
+            $$ = CloseListNode(driver.tree, AppendListNode(driver.tree, CreateListNode(driver.tree, $3), loop));
+            --driver.loop_nesting;
         }
-    | for_head statement
+    | DO
         {
-            $$ = CreateControlFlowNode(typeWhileStatement, $1, $2, NULL);
-            --g_LoopNestingCounter;
+            ++driver.loop_nesting;
         }
-    | DO statement while_head
+    statement WHILE OPENPAREN exp CLOSEPAREN
         {
-            $$ = CreateControlFlowNode(typeWhileStatement, $3, $2, NULL);
-            --g_LoopNestingCounter;
+            $$ = CreateLoopNode(driver.tree, loopDo, $6, $3, NO_NODE);
+            --driver.loop_nesting;
         }
 ;
 
@@ -441,71 +484,68 @@ while_head :
     WHILE OPENPAREN exp CLOSEPAREN
         {
             $$ = $3;
-            ++g_LoopNestingCounter;
+            ++driver.loop_nesting;
         }
 ;
 
-for_head :
-    FOR OPENPAREN exp SEMICOLON exp RELOP exp SEMICOLON exp CLOSEPAREN
-        {
-            $$ = $3;
-            ++g_LoopNestingCounter;
-        }
+/* Initialization and step of a for loop */
+for_clause :
+    assignment | exp
 ;
 
 /* EXPRESSIONS */
 exp :
     exp RELOP exp
         {
-            if ($1->valueType != $3->valueType)
+            if (NodeValueType(driver.tree, $1) != NodeValueType(driver.tree, $3))
             {
                 yyerror("warning - types in relop incompatible");
-                if ($1->valueType == typeInt)
-                    $$ = CreateNodeAST(typeBinaryOp, "+", CreateNodeAST(typeUnaryOp, "td", $1, NULL), $3);
+                if (NodeValueType(driver.tree, $1) == typeInt)
+                    $$ = FoldExpression(driver, CreateNodeAST(driver.tree, typeBinaryOp, OperatorFromText($2), CreateNodeAST(driver.tree, typeUnaryOp, opToDouble, $1, NO_NODE), $3));
                 else
-                    $$ = CreateNodeAST(typeBinaryOp, "+", $1, CreateNodeAST(typeUnaryOp, "td", $3, NULL));
+                    $$ = FoldExpression(driver, CreateNodeAST(driver.tree, typeBinaryOp, OperatorFromText($2), $1, CreateNodeAST(driver.tree, typeUnaryOp, opToDouble, $3, NO_NODE)));
             }
             else
-                $$ = CreateNodeAST(typeBinaryOp, $2, $1, $3);
+                $$ = FoldExpression(driver, CreateNodeAST(driver.tree, typeBinaryOp, OperatorFromText($2), $1, $3));
         }
     | exp PLUS exp
         {
-            if ($1->valueType != $3->valueType)
+            if (NodeValueType(driver.tree, $1) != NodeValueType(driver.tree, $3))
             {
                 yyerror("warning - types in addop incompatible");
-                if ($1->valueType == typeInt)
-                    $$ = CreateNodeAST(typeBinaryOp, "+", CreateNodeAST(typeUnaryOp, "td", $1, NULL), $3);
+                if (NodeValueType(driver.tree, $1) == typeInt)
+                    $$ = FoldExpression(driver, CreateNodeAST(driver.tree, typeBinaryOp, opAdd, CreateNodeAST(driver.tree, typeUnaryOp, opToDouble, $1, NO_NODE), $3));
                 else
-                    $$ = CreateNodeAST(typeBinaryOp, "+", $1, CreateNodeAST(typeUnaryOp, "td", $3, NULL));
+                    $$ = FoldExpression(driver, CreateNodeAST(driver.tree, typeBinaryOp, opAdd, $1, CreateNodeAST(driver.tree, typeUnaryOp, opToDouble, $3, NO_NODE)));
             }
             else
-                $$ = CreateNodeAST(typeBinaryOp, "+", $1, $3);
+                $$ = FoldExpression(driver, CreateNodeAST(driver.tree, typeBinaryOp, opAdd, $1, $3));
         }
     | exp MINUS exp
         {
-            if ($1->valueType != $3->valueType)
+            if (NodeValueType(driver.tree, $1) != NodeValueType(driver.tree, $3))
             {
                 yyerror("warning - types in subop incompatible");
-                if ($1->valueType == typeInt)
-                    $$ = CreateNodeAST(typeBinaryOp, "+", CreateNodeAST(typeUnaryOp, "td", $1, NULL), $3);
+                if (NodeValueType(driver.tree, $1) == typeInt)
+                    $$ = FoldExpression(driver, CreateNodeAST(driver.tree, typeBinaryOp, opSubtract, CreateNodeAST(driver.tree, typeUnaryOp, opToDouble, $1, NO_NODE), $3));
                 else
-                $$ = CreateNodeAST(typeBinaryOp, "+", $1, CreateNodeAST(typeUnaryOp, "td", $3, NULL));
+                    $$ = FoldExpression(driver, CreateNodeAST(driver.tree, typeBinaryOp, opSubtract, $1, CreateNodeAST(driver.tree, typeUnaryOp, opToDouble, $3, NO_NODE)));
             }
             else
-                $$ = CreateNodeAST(typeBinaryOp, "-", $1, $3);
+                $$ = FoldExpression(driver, CreateNodeAST(driver.tree, typeBinaryOp, opSubtract, $1, $3));
         }
     | exp MULOPERATOR exp
         {
-            if ($1->valueType != $3->valueType)
+            if (NodeValueType(driver.tree, $1) != NodeValueType(driver.tree, $3))
             {
                 yyerror("warning - types in mulop incompatible");
-                if ($1->valueType == typeInt)
-                    $$ = CreateNodeAST(typeBinaryOp, "+", CreateNodeAST(typeUnaryOp, "td", $1, NULL), $3);
+                if (NodeValueType(driver.tree, $1) == typeInt)
+                    $$ = FoldExpression(driver, CreateNodeAST(driver.tree, typeBinaryOp, OperatorFromText($2), CreateNodeAST(driver.tree, typeUnaryOp, opToDouble, $1, NO_NODE), $3));
                 else
-                    $$ = CreateNodeAST(typeBinaryOp, "+", $1, CreateNodeAST(typeUnaryOp, "td", $3, NULL));
+                    $$ = FoldExpression(driver, CreateNodeAST(driver.tree, typeBinaryOp, OperatorFromText($2), $1, CreateNodeAST(driver.tree, typeUnaryOp, opToDouble, $3, NO_NODE)));
             }
             else
-                $$ = CreateNodeAST(typeBinaryOp, $2, $1, $3);
+                $$ = FoldExpression(driver, CreateNodeAST(driver.tree, typeBinaryOp, OperatorFromText($2), $1, $3));
         }
     | OPENPAREN exp CLOSEPAREN
         {
@@ -513,24 +553,24 @@ exp :
         }
     | MINUS exp %prec UMINUS
         {
-            $$ = CreateNodeAST(typeUnaryOp, "-", $2, NULL);
+            $$ = FoldExpression(driver, CreateNodeAST(driver.tree, typeUnaryOp, opNegate, $2, NO_NODE));
         }
     | NUMBER
         {
-            $$ = CreateNumberNode($1);
+            $$ = InternConstant(driver.constants, driver.tree, $1);
         }
     | INTCONST
         {
-            $$ = CreateNumberNode($1);
+            $$ = InternConstant(driver.constants, driver.tree, $1);
         }
     | VARIABLE
         {
-            TSymbolTableElementPtr var = LookupUserVariableTableRecursive(currentTable, *$1);
-            if (NULL == var)
+            TSymbolId var = LookupSymbolRecursive(driver.symbols, $1);
+            if (NO_SYMBOL == var)
             {
-                yyerror(ErrorMessageVariableNotDeclared(*$1));
+                yyerror(ErrorMessageVariableNotDeclared($1->name));
             }
-            $$ = CreateReferenceNode(var);
+            $$ = CreateReferenceNode(driver.tree, var);
         }
 ;
 
@@ -538,7 +578,7 @@ exp :
 input :
     INPUT OPENPAREN exp CLOSEPAREN
         {
-            $$ = CreateNodeAST(typeInput, "input", $3, NULL);
+            $$ = CreateNodeAST(driver.tree, typeInput, opNone, $3, NO_NODE);
         }
 ;
 
@@ -546,48 +586,48 @@ input :
 echa :
     ECHA OPENPAREN exp CLOSEPAREN
         {
-            $$ = CreateNodeAST(typeOutput, "output", $3, NULL);
+            $$ = CreateNodeAST(driver.tree, typeOutput, opNone, $3, NO_NODE);
         }
 ;
 
 /* FUNCTIONS */
 type:
-    INT { $$ = CreateNumberNode(1);}
-    | FLOAT {$$ = CreateNumberNode(1.1);}
-    | CHAR {$$ = CreateNumberNode('1');}
-    | BOOL {$$ = CreateNumberNode(true);}
-    | INT OPENSQRBRACE CLOSESQRBRACE {$$ = CreateNumberNode(1);}
-    | FLOAT OPENSQRBRACE CLOSESQRBRACE {$$ = CreateNumberNode(1.1);}
-    | CHAR OPENSQRBRACE CLOSESQRBRACE {$$ = CreateNumberNode('1');}
-    | BOOL OPENSQRBRACE CLOSESQRBRACE {$$ = CreateNumberNode(true);}
+    INT { $$ = CreateNumberNode(driver.tree, 1);}
+    | FLOAT {$$ = CreateNumberNode(driver.tree, 1.1);}
+    | CHAR {$$ = CreateNumberNode(driver.tree, '1');}
+    | BOOL {$$ = CreateNumberNode(driver.tree, true);}
+    | INT OPENSQRBRACE CLOSESQRBRACE {$$ = CreateNumberNode(driver.tree, 1);}
+    | FLOAT OPENSQRBRACE CLOSESQRBRACE {$$ = CreateNumberNode(driver.tree, 1.1);}
+    | CHAR OPENSQRBRACE CLOSESQRBRACE {$$ = CreateNumberNode(driver.tree, '1');}
+    | BOOL OPENSQRBRACE CLOSESQRBRACE {$$ = CreateNumberNode(driver.tree, true);}
 ;
 
 func_params :
     type VARIABLE 
     {
-	    TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *$2);
-            if (NULL != var)
+	    TSymbolId var = LookupSymbol(driver.symbols, $2);
+            if (NO_SYMBOL != var)
             {
-                yyerror(ErrorMessageVariableDoublyDeclared(*$2));
+                yyerror(ErrorMessageVariableDoublyDeclared($2->name));
             }
             else
             {
-                bool kuku = InsertUserVariableTable(currentTable, *$2, $1->valueType, var);
-                if (false == kuku)
+                var = DeclareSymbol(driver.symbols, $2, NodeValueType(driver.tree, $1));
+                if (NO_SYMBOL == var)
                     yyerror("Memory allocation or access error");
             }
     }
     | func_params COMMA type VARIABLE 
     {
-    	TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *$4);
-        if (NULL != var)
+    	TSymbolId var = LookupSymbol(driver.symbols, $4);
+        if (NO_SYMBOL != var)
         {
-            yyerror(ErrorMessageVariableDoublyDeclared(*$4));
+            yyerror(ErrorMessageVariableDoublyDeclared($4->name));
         }
         else
         {
-            bool kuku = InsertUserVariableTable(currentTable, *$4, $3->valueType, var);
-            if (false == kuku)
+            var = DeclareSymbol(driver.symbols, $4, NodeValueType(driver.tree, $3));
+            if (NO_SYMBOL == var)
                 yyerror("Memory allocation or access error");
         }
     }
@@ -595,51 +635,49 @@ func_params :
 
 func :
     FUNC VARIABLE OPENPAREN  {
-            currentTable = CreateUserVariableTable(currentTable);
+            EnterScope(driver.symbols);
         }
         CLOSEPAREN FUNCRETURN type  OPENBRACE stmtlist CLOSEBRACE
         {
-        	TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *$2);
-            if (NULL != var)
+        	TSymbolId var = LookupSymbol(driver.symbols, $2);
+            if (NO_SYMBOL != var)
             {
-                yyerror(ErrorMessageVariableDoublyDeclared(*$2));
+                yyerror(ErrorMessageVariableDoublyDeclared($2->name));
             }
             else
             {
-                bool kuku = InsertUserVariableTable(currentTable, *$2, $7->valueType, var);
-                if (false == kuku)
+                var = DeclareSymbol(driver.symbols, $2, NodeValueType(driver.tree, $7));
+                if (NO_SYMBOL == var)
                     yyerror("Memory allocation or access error");
             }
-            $$ = CreateControlFlowNode(typeFunctionStatment, NULL, $9, NULL);
-            HideUserVariableTable(currentTable);
-        	currentTable = currentTable->parentTable;
+            $$ = CreateControlFlowNode(driver.tree, typeFunctionStatment, NO_NODE, CloseListNode(driver.tree, $9), NO_NODE);
+            ExitScope(driver.symbols);
         }
     | FUNC VARIABLE OPENPAREN {
-            currentTable = CreateUserVariableTable(currentTable);
+            EnterScope(driver.symbols);
         } 
         func_params CLOSEPAREN FUNCRETURN type OPENBRACE stmtlist CLOSEBRACE
         {
-        	TSymbolTableElementPtr var = LookupUserVariableTable(currentTable, *$2);
-            if (NULL != var)
+        	TSymbolId var = LookupSymbol(driver.symbols, $2);
+            if (NO_SYMBOL != var)
             {
-                yyerror(ErrorMessageVariableDoublyDeclared(*$2));
+                yyerror(ErrorMessageVariableDoublyDeclared($2->name));
             }
             else
             {
-                bool kuku = InsertUserVariableTable(currentTable, *$2, $8->valueType, var);
-                if (false == kuku)
+                var = DeclareSymbol(driver.symbols, $2, NodeValueType(driver.tree, $8));
+                if (NO_SYMBOL == var)
                     yyerror("Memory allocation or access error");
             }
-            $$ = CreateControlFlowNode(typeFunctionStatment, NULL, $10, NULL);
-            HideUserVariableTable(currentTable);
-        	currentTable = currentTable->parentTable;
+            $$ = CreateControlFlowNode(driver.tree, typeFunctionStatment, NO_NODE, CloseListNode(driver.tree, $10), NO_NODE);
+            ExitScope(driver.symbols);
         }
 ;
 
 main_func :
     FUNC MAIN OPENPAREN CLOSEPAREN FUNCRETURN type compound_statement
         {
-            $$ = CreateControlFlowNode(typeFunctionStatment, NULL, $7, NULL);
+            $$ = CreateControlFlowNode(driver.tree, typeFunctionStatment, NO_NODE, $7, NO_NODE);
         }
 ;
 /*------------------------------------------------------------*/
@@ -649,6 +687,34 @@ void yy::Parser::error(const location_type& l, const std::string& m)
     driver.error(l, m);
 }
 
+/* The expression a with its literal operators folded, if asked to */
+static TNodeIndex FoldExpression(Simpl_driver& driver, TNodeIndex a)
+{
+    if (!driver.folding_constants)
+        return a;
+    return FoldConstantNode(driver.tree, driver.constants, a, driver.folded_nodes);
+}
+
+/* Length of an array given by an int expression, which must fold to a
+   literal that is not negative */
+static int ArraySize(Simpl_driver& driver, TNodeIndex size)
+{
+    /* the expression is not part of the tree, so not counted */
+    TFoldCount folded = {0, 0};
+    size = FoldConstants(driver.tree, driver.constants, size, folded);
+    if (typeConst != driver.tree.nodes[size].nodetype)
+    {
+        driver.error("warning - size of array must be const int");
+        return 0;
+    }
+    if (driver.tree.nodes[size].iNumber < 0)
+    {
+        driver.error("warning - size of array is negative");
+        return 0;
+    }
+    return driver.tree.nodes[size].iNumber;
+}
+
 static std::string ErrorMessageVariableNotDeclared(std::string name)
 {
     std::string errorDeclaration = "warning - Variable " + name + " isn't declared";
@@ -0,0 +1,253 @@
+/*
+* Source buffers: zero-copy file mapping with a chunked-read fallback
+*/
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <ostream>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#if defined _WIN32 || defined _WIN64
+#include <io.h>
+#define open _open
+#define read _read
+#define close _close
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined __SSE2__ && defined __GNUC__
+#include <emmintrin.h>
+#endif
+
+#include "simpl-source.hpp"
+
+/* Size of a single read() while slurping a stream */
+#define SOURCE_READ_CHUNK (1u << 20)
+
+void InitSourceBuffer(TSourceBuffer& buffer)
+{
+  buffer.data = NULL;
+  buffer.size = 0;
+  buffer.capacity = 0;
+  buffer.isMapped = false;
+}
+
+void ReleaseSourceBuffer(TSourceBuffer& buffer)
+{
+  if (NULL == buffer.data)
+    return;
+#if !defined _WIN32 && !defined _WIN64
+  if (buffer.isMapped)
+    munmap(buffer.data, buffer.capacity);
+  else
+#endif
+    free(buffer.data);
+  InitSourceBuffer(buffer);
+}
+
+bool LoadSourceStream(TSourceBuffer& buffer, int fd, std::string& errorMessage)
+{
+  size_t capacity = 64 * 1024;
+  char* data = (char *) malloc(capacity);
+  size_t size = 0;
+  if (NULL == data)
+  {
+    errorMessage = "out of space";
+    return false;
+  }
+
+  for (;;)
+  {
+    /* keep room for the two end-of-buffer NULs */
+    if (capacity - size < 2 + 4096)
+    {
+      char* grown = (char *) realloc(data, capacity * 2);
+      if (NULL == grown)
+      {
+        free(data);
+        errorMessage = "out of space";
+        return false;
+      }
+      data = grown;
+      capacity *= 2;
+    }
+
+    size_t room = capacity - size - 2;
+    if (room > SOURCE_READ_CHUNK)
+      room = SOURCE_READ_CHUNK;
+    long got = (long) read(fd, data + size, room);
+    if (got < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      errorMessage = strerror(errno);
+      free(data);
+      return false;
+    }
+    if (got == 0)
+      break;
+    size += (size_t) got;
+    if (size > SOURCE_BUFFER_MAX_SIZE)
+    {
+      free(data);
+      errorMessage = "input is too large";
+      return false;
+    }
+  }
+
+  data[size] = data[size + 1] = '\0';
+  buffer.data = data;
+  buffer.size = size;
+  buffer.capacity = capacity;
+  buffer.isMapped = false;
+  return true;
+}
+
+bool LoadSourceFile(TSourceBuffer& buffer, const std::string& path, std::string& errorMessage)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    errorMessage = strerror(errno);
+    return false;
+  }
+
+#if !defined _WIN32 && !defined _WIN64
+  struct stat info;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+  {
+    size_t size = (size_t) info.st_size;
+    if (size > SOURCE_BUFFER_MAX_SIZE)
+    {
+      close(fd);
+      errorMessage = "input is too large";
+      return false;
+    }
+
+    /* Reserve zero-filled anonymous pages one byte pair longer than the
+       file, then map the file over their start. Whatever the file size,
+       the two bytes after the text are zero: either the kernel's zero fill
+       of the last file page or the anonymous tail page. */
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t capacity = (size + 2 + page - 1) / page * page;
+    void* area = mmap(NULL, capacity, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED != area)
+    {
+      void* text = mmap(area, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_FIXED, fd, 0);
+      if (MAP_FAILED != text)
+      {
+        close(fd);
+        madvise(text, size, MADV_SEQUENTIAL);
+        buffer.data = (char *) text;
+        buffer.size = size;
+        buffer.capacity = capacity;
+        buffer.isMapped = true;
+        return true;
+      }
+      munmap(area, capacity);
+    }
+    /* mapping is not possible here, read the file instead */
+  }
+#endif
+
+  bool loaded = LoadSourceStream(buffer, fd, errorMessage);
+  close(fd);
+  return loaded;
+}
+
+void InitLineTable(TLineTable& table, const char* text, size_t size)
+{
+  table.text = text;
+  table.size = size;
+  table.lineStarts.assign(1, 0);
+  table.firstLine = 1;
+  table.isBuilt = (NULL == text);
+}
+
+void AddLineBreaks(TLineTable& table, uint32_t offset, size_t count)
+{
+  for (size_t i = 1; i <= count; ++i)
+    table.lineStarts.push_back(offset + (uint32_t) i);
+}
+
+/* Index of the line holding an offset */
+static size_t FindLine(const TLineTable& table, uint32_t offset)
+{
+  uint32_t base = table.lineStarts[0];
+  auto next = std::upper_bound(table.lineStarts.begin(), table.lineStarts.end(), offset,
+                               [base](uint32_t a, uint32_t b) { return a - base < b - base; });
+  return next - table.lineStarts.begin() - 1;
+}
+
+void TrimLineTable(TLineTable& table, uint32_t offset)
+{
+  if (NULL != table.text)
+    return;
+  size_t line = FindLine(table, offset);
+  /* erase in batches, not on every call */
+  if (line < 4096)
+    return;
+  table.lineStarts.erase(table.lineStarts.begin(), table.lineStarts.begin() + line);
+  table.firstLine += (unsigned) line;
+}
+
+/* One pass over the whole text, sixteen bytes at a time where SSE2 is there */
+void BuildLineTable(TLineTable& table)
+{
+  const char* text = table.text;
+  size_t size = table.size;
+  size_t i = 0;
+#if defined __SSE2__ && defined __GNUC__
+  const __m128i newline = _mm_set1_epi8('\n');
+  for (; i + 16 <= size; i += 16)
+  {
+    __m128i block = _mm_loadu_si128((const __m128i*) (text + i));
+    unsigned mask = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+    while (mask)
+    {
+      table.lineStarts.push_back((uint32_t) (i + __builtin_ctz(mask) + 1));
+      mask &= mask - 1;
+    }
+  }
+#endif
+  for (const char* p = text + i; NULL != (p = (const char*) memchr(p, '\n', text + size - p)); )
+    table.lineStarts.push_back((uint32_t) (++p - text));
+  table.isBuilt = true;
+}
+
+void ResolveOffset(TLineTable& table, uint32_t offset, unsigned& line, unsigned& column)
+{
+  if (!table.isBuilt)
+    BuildLineTable(table);
+  size_t index = FindLine(table, offset);
+  line = table.firstLine + (unsigned) index;
+  column = offset - table.lineStarts[index] + 1;
+}
+
+std::string FormatSourceSpan(TLineTable& table, const TSourceSpan& span)
+{
+  unsigned line, column, endLine, endColumn;
+  ResolveOffset(table, span.begin, line, column);
+  ResolveOffset(table, span.end, endLine, endColumn);
+
+  /* the end is exclusive, show the last column of the span */
+  if (endColumn > 0)
+    --endColumn;
+  std::string text = std::to_string(line) + "." + std::to_string(column);
+  if (line < endLine)
+    text += "-" + std::to_string(endLine) + "." + std::to_string(endColumn);
+  else if (column < endColumn)
+    text += "-" + std::to_string(endColumn);
+  return text;
+}
+
+std::ostream& operator<<(std::ostream& out, const TSourceSpan& span)
+{
+  return out << span.begin << "-" << span.end;
+}
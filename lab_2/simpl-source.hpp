@@ -0,0 +1,71 @@
+/* In-memory source text for the scanner */
+
+#ifndef _SIMPL_SOURCE_HPP
+#define _SIMPL_SOURCE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/* The whole source text followed by two NUL bytes, the layout flex's
+   yy_scan_buffer() scans in place without copying. The text is writable:
+   flex temporarily stores a NUL after the current token. */
+typedef struct
+{
+  char* data;        /* first byte of the text, NULL when nothing is loaded */
+  size_t size;       /* text length, without the two trailing NULs */
+  size_t capacity;   /* bytes owned by the buffer (mapping or heap block) */
+  bool isMapped;     /* private file mapping vs heap block */
+} TSourceBuffer;
+
+/* Largest text flex can scan from a single buffer (its sizes are int) */
+#define SOURCE_BUFFER_MAX_SIZE ((size_t) 0x7ffffff0)
+
+void InitSourceBuffer(TSourceBuffer& buffer);
+/* Regular files are memory-mapped, anything else goes through LoadSourceStream */
+bool LoadSourceFile(TSourceBuffer& buffer, const std::string& path, std::string& errorMessage);
+/* Chunked reads until end of input, for stdin and pipes */
+bool LoadSourceStream(TSourceBuffer& buffer, int fd, std::string& errorMessage);
+void ReleaseSourceBuffer(TSourceBuffer& buffer);
+
+/* Location of a token or a phrase: byte offsets into the source text.
+   This is the parser's location type; lines and columns are worked out
+   from a TLineTable only when a diagnostic is printed. */
+typedef struct
+{
+  uint32_t begin;    /* first byte */
+  uint32_t end;      /* one past the last byte */
+} TSourceSpan;
+
+/* Offsets of line starts. Text held in memory is indexed on the first
+   lookup; streamed text is indexed by the scanner as it goes, and only
+   the lines that can still be looked up are kept. Offsets of a stream
+   longer than 4 GiB wrap around, lookups compare them relative to the
+   first line kept. */
+typedef struct
+{
+  const char* text;      /* whole source text, NULL when streamed */
+  size_t size;
+  bool isBuilt;
+  unsigned firstLine;    /* number of the line lineStarts[0] begins */
+  std::vector<uint32_t> lineStarts;
+} TLineTable;
+
+void InitLineTable(TLineTable& table, const char* text, size_t size);
+/* Index text held in memory now rather than on the first lookup */
+void BuildLineTable(TLineTable& table);
+/* Streamed text: a run of `count` newlines starting at `offset` */
+void AddLineBreaks(TLineTable& table, uint32_t offset, size_t count);
+/* Streamed text: forget the lines before the one holding `offset` */
+void TrimLineTable(TLineTable& table, uint32_t offset);
+/* 1-based line and column (in bytes) of an offset */
+void ResolveOffset(TLineTable& table, uint32_t offset, unsigned& line, unsigned& column);
+/* "line.column", with the last column or line of a longer span appended */
+std::string FormatSourceSpan(TLineTable& table, const TSourceSpan& span);
+
+/* Raw offsets, for the parser's traces */
+std::ostream& operator<<(std::ostream& out, const TSourceSpan& span);
+
+#endif
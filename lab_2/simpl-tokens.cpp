@@ -0,0 +1,164 @@
+/*
+* Pipelined scanning: the flex scanner runs on a lexer thread and
+* publishes chunks of tokens that the parser consumes on its own thread
+*/
+#include <system_error>
+
+#include "simpl-tokens.hpp"
+#include "simpl-driver.hpp"
+
+typedef yy::Parser::token token;
+
+/* Spins this many times before yielding the processor to the other side */
+#define TOKEN_RING_SPINS 64
+
+static void InitTokenRing(TTokenRing& ring)
+{
+  ring.head.store(0, std::memory_order_relaxed);
+  ring.tail.store(0, std::memory_order_relaxed);
+}
+
+static bool PushTokenRing(TTokenRing& ring, TTokenChunk* chunk)
+{
+  unsigned tail = ring.tail.load(std::memory_order_relaxed);
+  if (tail - ring.head.load(std::memory_order_acquire) == TOKEN_CHUNK_COUNT)
+    return false;
+  ring.slots[tail % TOKEN_CHUNK_COUNT] = chunk;
+  ring.tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+static TTokenChunk* PopTokenRing(TTokenRing& ring)
+{
+  unsigned head = ring.head.load(std::memory_order_relaxed);
+  if (ring.tail.load(std::memory_order_acquire) == head)
+    return NULL;
+  TTokenChunk* chunk = ring.slots[head % TOKEN_CHUNK_COUNT];
+  ring.head.store(head + 1, std::memory_order_release);
+  return chunk;
+}
+
+/* Waits for a chunk; NULL when the stream was stopped meanwhile */
+static TTokenChunk* WaitTokenRing(TTokenRing& ring, const std::atomic<bool>& stopped)
+{
+  for (unsigned spins = 0; ; ++spins)
+  {
+    TTokenChunk* chunk = PopTokenRing(ring);
+    if (NULL != chunk)
+      return chunk;
+    if (stopped.load(std::memory_order_relaxed))
+      return NULL;
+    if (spins >= TOKEN_RING_SPINS)
+      std::this_thread::yield();
+  }
+}
+
+/* Lexer thread: fill chunks until the end of file */
+static void ProduceTokens(TTokenStream* stream, Simpl_driver* driver)
+{
+  bool done = false;
+  while (!done)
+  {
+    TTokenChunk* chunk = WaitTokenRing(stream->empty, stream->stopped);
+    if (NULL == chunk)
+      return;
+    chunk->count = 0;
+    chunk->errors.clear();
+
+    while (!done && chunk->count < TOKEN_CHUNK_SIZE)
+    {
+      unsigned i = chunk->count++;
+      TSourceSpan span;
+      yy::Parser::token_type t = driver->scan(&chunk->value[i], &span);
+      chunk->kind[i] = (int16_t) t;
+      chunk->offset[i] = span.begin;
+      chunk->length[i] = span.end - span.begin;
+      done = (t == token::EOFILE);
+
+      for (auto j = 0u; j < stream->pendingErrors.size(); ++j)
+      {
+        stream->pendingErrors[j].index = i;
+        chunk->errors.push_back(stream->pendingErrors[j]);
+      }
+      stream->pendingErrors.clear();
+    }
+
+    /* there are as many slots as chunks, the filled ring is never full */
+    PushTokenRing(stream->filled, chunk);
+  }
+}
+
+TTokenStream* StartTokenStream(Simpl_driver& driver)
+{
+  TTokenStream* stream;
+  try
+  {
+    stream = new TTokenStream;
+  }
+  catch (std::bad_alloc& ba)
+  {
+    return NULL;
+  }
+
+  InitTokenRing(stream->filled);
+  InitTokenRing(stream->empty);
+  for (auto i = 0u; i < TOKEN_CHUNK_COUNT; ++i)
+    PushTokenRing(stream->empty, &stream->chunks[i]);
+  stream->stopped.store(false);
+  stream->current = NULL;
+  stream->next = 0;
+  stream->nextError = 0;
+
+  driver.tokens = stream;
+  try
+  {
+    stream->lexer = std::thread(ProduceTokens, stream, &driver);
+  }
+  catch (std::system_error& se)
+  {
+    /* no thread to spare: scan on the parser's thread */
+    driver.tokens = NULL;
+    delete stream;
+    return NULL;
+  }
+  return stream;
+}
+
+yy::Parser::token_type NextStreamToken(TTokenStream* stream,
+                                       yy::Parser::semantic_type* yylval,
+                                       TSourceSpan* yylloc,
+                                       Simpl_driver& driver)
+{
+  if (NULL == stream->current || stream->next == stream->current->count)
+  {
+    if (NULL != stream->current)
+      PushTokenRing(stream->empty, stream->current);
+    stream->current = WaitTokenRing(stream->filled, stream->stopped);
+    stream->next = 0;
+    stream->nextError = 0;
+  }
+
+  TTokenChunk* chunk = stream->current;
+  unsigned i = stream->next++;
+  *yylval = chunk->value[i];
+  if (chunk->kind[i] == token::EOFILE)
+    stream->next = i;       /* the lexer thread is gone, repeat the end of file */
+  yylloc->begin = chunk->offset[i];
+  yylloc->end = chunk->offset[i] + chunk->length[i];
+  driver.location = *yylloc;
+
+  while (stream->nextError < chunk->errors.size() &&
+         chunk->errors[stream->nextError].index == i)
+  {
+    const TScanError& e = chunk->errors[stream->nextError++];
+    driver.error(e.location, e.message);
+  }
+  return (yy::Parser::token_type) chunk->kind[i];
+}
+
+void StopTokenStream(TTokenStream* stream)
+{
+  stream->stopped.store(true);
+  stream->lexer.join();
+  delete stream;
+}
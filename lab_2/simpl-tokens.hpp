@@ -0,0 +1,76 @@
+/* Tokens scanned ahead of the parser on a separate thread */
+
+#ifndef _SIMPL_TOKENS_HPP
+#define _SIMPL_TOKENS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ast.hpp"
+#include "simpl-lang.hpp"
+
+class Simpl_driver;
+
+/* Tokens per chunk and chunks in flight between the two threads */
+#define TOKEN_CHUNK_SIZE 4096
+#define TOKEN_CHUNK_COUNT 8
+
+/* A diagnostic of the scanner, reported when the parser reaches its token */
+typedef struct
+{
+  unsigned index;
+  TSourceSpan location;
+  std::string message;
+} TScanError;
+
+/* A run of tokens stored as a structure of arrays */
+typedef struct
+{
+  unsigned count;
+  int16_t kind[TOKEN_CHUNK_SIZE];                   /* yy::Parser::token_type, negative
+                                                       for a stray byte >= 0x80 */
+  uint32_t offset[TOKEN_CHUNK_SIZE];                /* first byte in the source */
+  uint32_t length[TOKEN_CHUNK_SIZE];                /* bytes */
+  yy::Parser::semantic_type value[TOKEN_CHUNK_SIZE]; /* literal, operator or identifier */
+  std::vector<TScanError> errors;
+} TTokenChunk;
+
+/* Lock-free single-producer/single-consumer queue of chunks */
+typedef struct
+{
+  TTokenChunk* slots[TOKEN_CHUNK_COUNT];
+  std::atomic<unsigned> head;   /* next slot to take, owned by the consumer */
+  char padding[64];             /* keeps the two ends on separate cache lines */
+  std::atomic<unsigned> tail;   /* next slot to fill, owned by the producer */
+} TTokenRing;
+
+typedef struct TokenStream
+{
+  TTokenRing filled;     /* lexer thread -> parser */
+  TTokenRing empty;      /* parser -> lexer thread, for reuse */
+  TTokenChunk chunks[TOKEN_CHUNK_COUNT];
+  std::atomic<bool> stopped;   /* the parser is done, the lexer thread must quit */
+  std::thread lexer;
+
+  /* lexer thread side */
+  std::vector<TScanError> pendingErrors;
+
+  /* parser side */
+  TTokenChunk* current;
+  unsigned next;
+  unsigned nextError;
+} TTokenStream;
+
+/* Start scanning the driver's in-memory source on a lexer thread and
+   hand the stream to the driver; NULL if it could not be set up */
+TTokenStream* StartTokenStream(Simpl_driver& driver);
+/* Hand the parser the next token, in the same way as the scanner does */
+yy::Parser::token_type NextStreamToken(TTokenStream* stream,
+                                       yy::Parser::semantic_type* yylval,
+                                       TSourceSpan* yylloc,
+                                       Simpl_driver& driver);
+void StopTokenStream(TTokenStream* stream);
+
+#endif
@@ -1,7 +1,10 @@
+#include <cstdio>
+#include <cstdlib>
+
 #include "symtable.hpp"
 
 /* symbol table helpers */
-TSymbolTable* CreateUserVariableTable(TSymbolTable* parentTable)
+TSymbolTable* CreateSymbolTable()
 {
   TSymbolTable* table = NULL;
   try
@@ -12,131 +15,185 @@ TSymbolTable* CreateUserVariableTable(TSymbolTable* parentTable)
   {
     return NULL;
   }
-  table->parentTable = parentTable;
-  table->isHidden = false;
-  if (NULL != parentTable)
-    parentTable->childTables.push_back(table);
-  table->childTables.clear();
-  table->data.clear();
+  EnterScope(table);
   return table;
 }
 
-void DestroyUserVariableTable(TSymbolTable* table)
+void EnterScope(TSymbolTable* table)
 {
   if (table == NULL)
     return;
-  
-  auto childTablesNumber = table->childTables.size();
-  for(auto i = 0u; i < childTablesNumber; ++i)
+  try
   {
-    DestroyUserVariableTable(table->childTables[i]);
+    table->scopeData.push_back(table->data.size());
+    table->scopeUndo.push_back(table->undo.size());
+  }
+  catch (std::bad_alloc& ba)
+  {
+    perror("out of space");
+    exit(0);
   }
-  table->childTables.clear();
-  
-  for(auto j = 0u; j < table->data.size(); ++j)
-    delete table->data[j].name;
-  table->data.clear();
-  delete table;
-  return;
 }
 
-bool HideUserVariableTable(TSymbolTable* table)
+bool ExitScope(TSymbolTable* table)
 {
-  if (table == NULL)
+  if (table == NULL || table->scopeUndo.empty())
     return false;
-  table->isHidden = true;
+  unsigned mark = table->scopeUndo.back();
+  while (table->undo.size() > mark)
+  {
+    const TShadowedBinding& shadowed = table->undo.back();
+    table->bindings[shadowed.identifier] = shadowed.binding;
+    table->undo.pop_back();
+  }
+  table->scopeData.pop_back();
+  table->scopeUndo.pop_back();
   return true;
 }
 
-// linear searching
-TSymbolTableElementPtr LookupUserVariableTable(TSymbolTable* table, std::string varName)
+void CompactSymbolTable(TSymbolTable* table)
 {
-  if (NULL == table || varName.empty() || table->data.empty() || table->isHidden)
+  if (table == NULL || table->scopeData.size() != 1)
+    return;
+  /* each live record was declared in the outermost scope, and logged
+     there once */
+  size_t live = table->undo.size();
+  size_t closed = table->data.size() - live;
+  if (closed < live || closed < SYMBOL_COMPACT_MIN)
+    return;
+  std::vector<TSymbolId> renumbered;
+  try
   {
-    return NULL;
+    renumbered.resize(table->data.size() + 1, NO_SYMBOL);
   }
-  for (auto i = 0u; i < table->data.size(); ++i)
-  {
-    if (varName == *table->data[i].name)
-    {
-      TSymbolTableElementPtr tableRow = NULL;
-      try
-      {
-        tableRow = new TSymbolTableElement;
-      }
-      catch (std::bad_alloc& ba)
-      {
-        return NULL;
-      }
-      tableRow->table = table;
-      tableRow->index = i;
-      return tableRow;
-    }
-  }
-  return NULL;
+  catch (std::bad_alloc& ba)
+  {
+    return;
+  }
+  /* a record is live while its name is bound to it */
+  unsigned kept = 0;
+  for (unsigned i = 0; i < table->data.size(); ++i)
+  {
+    if (table->bindings[table->data[i].identifier->id] != i + 1)
+      continue;
+    table->data[kept] = table->data[i];
+    renumbered[i + 1] = ++kept;
+  }
+  table->data.resize(kept);
+  for (TSymbolId& binding : table->bindings)
+    binding = renumbered[binding];
+  for (TShadowedBinding& shadowed : table->undo)
+    shadowed.binding = renumbered[shadowed.binding];
+}
+
+void DestroyUserVariableTable(TSymbolTable* table)
+{
+  delete table;
+}
+
+TSymbolTable* CreateUserVariableTable(TSymbolTable* parentTable)
+{
+  if (NULL == parentTable)
+    return CreateSymbolTable();
+  EnterScope(parentTable);
+  return parentTable;
+}
+
+bool HideUserVariableTable(TSymbolTable* table)
+{
+  return ExitScope(table);
 }
 
-TSymbolTableElementPtr LookupUserVariableTableRecursive(TSymbolTable* table, std::string varName)
+TSymbolId LookupSymbolRecursive(const TSymbolTable* table, const TIdentifier* varName)
 {
-  if (NULL == table || varName.empty() || table->isHidden)
+  /* interned names have dense ids */
+  if (NULL == table || NULL == varName || varName->id >= table->bindings.size())
   {
-    return NULL;
+    return NO_SYMBOL;
   }
+  return table->bindings[varName->id];
+}
 
-  for (auto i = 0u; i < table->data.size(); ++i)
-  {
-    if (varName == *table->data[i].name)
-    {
-      TSymbolTableElementPtr tableRow = NULL;
-      try
-      {
-	tableRow = new (TSymbolTableElement);
-      }
-      catch (std::bad_alloc& ba)
-      {
-        return NULL;
-      }
-      tableRow->table = table;
-      tableRow->index = i;
-      return tableRow;
-    }
-  }
-  return LookupUserVariableTableRecursive(table->parentTable, varName);
+TSymbolId LookupSymbol(const TSymbolTable* table, const TIdentifier* varName)
+{
+  if (NULL == table || table->scopeData.empty())
+  {
+    return NO_SYMBOL;
+  }
+  TSymbolId symbol = LookupSymbolRecursive(table, varName);
+  /* declarations of enclosing scopes come before the innermost one's */
+  if (symbol <= table->scopeData.back())
+    return NO_SYMBOL;
+  return symbol;
 }
 
-bool InsertUserVariableTable(TSymbolTable* table, std::string varName, SubexpressionValueTypeEnum type, TSymbolTableElementPtr& tableRow)
+TSymbolId DeclareSymbol(TSymbolTable* table, const TIdentifier* varName, SubexpressionValueTypeEnum type)
 {
-  if (NULL == table || varName.empty() || table->isHidden)
+  if (NULL == table || NULL == varName || table->scopeData.empty())
   {
-    return false;
+    return NO_SYMBOL;
   }
   TSymbolTableRecord newrecord;
+  newrecord.identifier = varName;
+  newrecord.valueType = type;
+  newrecord.value = 0;
+  TShadowedBinding shadowed;
+  shadowed.identifier = varName->id;
   try
   {
-    newrecord.name = new std::string(varName);
+    if (varName->id >= table->bindings.size())
+      table->bindings.resize(varName->id + 1, NO_SYMBOL);
+    shadowed.binding = table->bindings[varName->id];
+    table->data.push_back(newrecord);
+    table->undo.push_back(shadowed);
   }
   catch (std::bad_alloc& ba)
   {
-    return false;
+    return NO_SYMBOL;
   }
-  newrecord.valueType = type;
-  table->data.push_back(newrecord);
+  TSymbolId symbol = (TSymbolId) table->data.size();
+  table->bindings[varName->id] = symbol;
+  return symbol;
+}
 
-  auto i = table->data.size() - 1;
+static TSymbolTableElementPtr NewTableRow(TSymbolTable* table, TSymbolId symbol)
+{
+  if (NO_SYMBOL == symbol)
+    return NULL;
+  TSymbolTableElementPtr tableRow = NULL;
+  try
+  {
+    tableRow = new TSymbolTableElement;
+  }
+  catch (std::bad_alloc& ba)
+  {
+    return NULL;
+  }
+  tableRow->table = table;
+  tableRow->index = symbol - 1;
+  return tableRow;
+}
+
+TSymbolTableElementPtr LookupUserVariableTable(TSymbolTable* table, const TIdentifier* varName)
+{
+  return NewTableRow(table, LookupSymbol(table, varName));
+}
+
+TSymbolTableElementPtr LookupUserVariableTableRecursive(TSymbolTable* table, const TIdentifier* varName)
+{
+  return NewTableRow(table, LookupSymbolRecursive(table, varName));
+}
 
+bool InsertUserVariableTable(TSymbolTable* table, const TIdentifier* varName, SubexpressionValueTypeEnum type, TSymbolTableElementPtr& tableRow)
+{
+  TSymbolId symbol = DeclareSymbol(table, varName, type);
+  if (NO_SYMBOL == symbol)
+    return false;
   if (NULL == tableRow)
   {
-    try
-    {
-      tableRow = new TSymbolTableElement;
-    }
-    catch (std::bad_alloc& ba)
-    {
+    tableRow = NewTableRow(table, symbol);
+    if (NULL == tableRow)
       return false;
-    } 
-
-  tableRow->table = table;
-  tableRow->index = i;
   }
   return true;
 }
@@ -3,37 +3,90 @@
 #ifndef _SYMBOL_TABLE_HPP
 #define _SYMBOL_TABLE_HPP
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include "subexpression.hpp"
+#include "identifiers.hpp"
 
 /* Symbols table record definition */
 typedef struct
 {
-  std::string* name;      /* Multiple character variable name */
+  const TIdentifier* identifier;  /* Interned variable name */
   SubexpressionValueTypeEnum valueType; /* Type of a variable or expression */
   double value;   /* Currently not used, reserved to the future */
 } TSymbolTableRecord;
 
+/* Handle of a declaration: its index in the data of its table + 1,
+   NO_SYMBOL (0) if there is none */
+typedef uint32_t TSymbolId;
+
+#define NO_SYMBOL 0
+
+/* A binding an inner declaration replaced, restored when its scope ends */
+typedef struct
+{
+  unsigned identifier;   /* TIdentifier::id */
+  TSymbolId binding;     /* the previous binding */
+} TShadowedBinding;
+
+/* The variables of a compilation: one binding per identifier and a stack
+   of open scopes. A declaration records the binding it replaces in an
+   undo log, closing a scope replays the log back to the scope's mark. */
 typedef struct SymbolTable
 {
-  struct SymbolTable* parentTable;
-  bool isHidden;
+  /* every declaration so far, in order; records outlive their scope,
+     since the AST refers to them by index, until CompactSymbolTable */
   std::vector <TSymbolTableRecord> data;
-  std::vector <struct SymbolTable*> childTables;
+  /* by identifier id: the visible declaration of the name */
+  std::vector <TSymbolId> bindings;
+  std::vector <TShadowedBinding> undo;
+  /* per open scope: size of data when it was opened, the first of its
+     own declarations, and of the undo log */
+  std::vector <unsigned> scopeData;
+  std::vector <unsigned> scopeUndo;
 } TSymbolTable;
 
 typedef struct
 {
   TSymbolTable* table;
-  unsigned index;
+  unsigned index;        /* in table->data */
 } TSymbolTableElement, *TSymbolTableElementPtr;
 
-TSymbolTableElementPtr LookupUserVariableTable(TSymbolTable*, std::string);
-TSymbolTableElementPtr LookupUserVariableTableRecursive(TSymbolTable*, std::string);
-bool InsertUserVariableTable(TSymbolTable*, std::string, SubexpressionValueTypeEnum, TSymbolTableElementPtr&);
+/* A table with its outermost scope open */
+TSymbolTable* CreateSymbolTable();
+void EnterScope(TSymbolTable*);
+/* Forgets the declarations of the innermost scope, false if none is open */
+bool ExitScope(TSymbolTable*);
+/* With only the outermost scope open, drops the records of closed scopes
+   and renumbers the others, once there are at least as many of them as
+   live ones and SYMBOL_COMPACT_MIN. Only for callers that hold no ids of
+   closed scopes, such as a streamed parse between statements. */
+void CompactSymbolTable(TSymbolTable*);
+
+#define SYMBOL_COMPACT_MIN 4096
+
+/* The declaration of the name in the innermost scope only, or the
+   visible one of any scope */
+TSymbolId LookupSymbol(const TSymbolTable*, const TIdentifier*);
+TSymbolId LookupSymbolRecursive(const TSymbolTable*, const TIdentifier*);
+/* Declares the name in the innermost scope, NO_SYMBOL if it cannot */
+TSymbolId DeclareSymbol(TSymbolTable*, const TIdentifier*, SubexpressionValueTypeEnum);
+void DestroyUserVariableTable(TSymbolTable*);
+
+inline const TSymbolTableRecord& SymbolRecord(const TSymbolTable* table, TSymbolId symbol)
+{
+  return table->data[symbol - 1];
+}
+
+/* Compatibility with the former tree of tables: a scope is opened in the
+   table of its parent (a new table for NULL), which is returned, and
+   hiding the table closes its innermost scope. Elements are heap copies
+   for the caller to delete. */
 TSymbolTable* CreateUserVariableTable(TSymbolTable*);
 bool HideUserVariableTable(TSymbolTable*);
-void DestroyUserVariableTable(TSymbolTable*);
+TSymbolTableElementPtr LookupUserVariableTable(TSymbolTable*, const TIdentifier*);
+TSymbolTableElementPtr LookupUserVariableTableRecursive(TSymbolTable*, const TIdentifier*);
+bool InsertUserVariableTable(TSymbolTable*, const TIdentifier*, SubexpressionValueTypeEnum, TSymbolTableElementPtr&);
 
 #endif